@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <citygml/vecs.hpp>
+#include <libplateau_api.h>
+#include "geo_coordinate.h"
+
+namespace plateau::geometry {
+
+    /**
+     * 複数の Extent の和集合について、点が含まれるかどうかを高速に判定するための索引です。
+     * 判定結果は、各 Extent について Extent::contains (高さは無視) を呼んだ結果の論理和と同じになります。
+     *
+     * 全 Extent の緯度と経度の境界値を座標として並べ、境界値そのものと境界値の間の区間からなる格子を作り、
+     * 格子の各マスについて、それを含む最初の Extent の番号を保持します。
+     * 点の判定は緯度と経度それぞれの二分探索と格子の参照で済むため、計算量は Extent の数にほぼ依存しません。
+     * 隣接するメッシュコードの範囲を多数指定した場合でも、境界値が共有されるため格子は小さくなります。
+     */
+    class LIBPLATEAU_EXPORT ExtentIndex {
+    public:
+        explicit ExtentIndex(const std::vector<Extent>& extents);
+
+        /// 点 (x:緯度, y:経度) がいずれかの Extent に含まれるかどうかを返します。高さは無視します。
+        bool contains(const TVec3d& lat_lon) const;
+
+        /**
+         * 点 (x:緯度, y:経度) を含む Extent のうち、コンストラクタに渡した順で最初のものの番号を返します。
+         * どの Extent にも含まれなければ -1 を返します。
+         */
+        int find(const TVec3d& lat_lon) const;
+
+        /**
+         * 緯度・経度の範囲 [min, max] が、すべての Extent の外接矩形と交わるかどうかを返します。
+         * false のとき、その範囲内の点はどの Extent にも含まれません。
+         */
+        bool mayIntersect(const TVec3d& min_lat_lon, const TVec3d& max_lat_lon) const;
+
+        /// vertices の緯度・経度の外接矩形について mayIntersect を返します。
+        bool mayIntersect(const std::vector<TVec3d>& vertices) const;
+
+        /**
+         * vertices のうち1つでもいずれかの Extent に含まれる頂点があるかどうかを返します。
+         * 頂点群の外接矩形が Extent 全体の外接矩形と交わらなければ、各頂点を調べずに false を返します。
+         */
+        bool containsAny(const std::vector<TVec3d>& vertices) const;
+
+        bool empty() const;
+
+    private:
+        /**
+         * value が breakpoints の何番目の要素区間に属するかを返します。
+         * 境界値 breakpoints[k] そのものは 2k、 breakpoints[k] と breakpoints[k+1] の間は 2k+1 です。
+         * 範囲外であれば -1 を返します。
+         */
+        static long long segmentOf(const std::vector<double>& breakpoints, double value);
+
+        std::vector<double> lat_breakpoints_;
+        std::vector<double> lon_breakpoints_;
+        /// 緯度方向の要素区間の数 × 経度方向の要素区間の数 の格子です。値はそのマスを含む最初の Extent の番号であり、なければ -1 です。
+        std::vector<int> first_extent_indices_;
+        size_t lon_segment_count_;
+        Extent bounds_;
+    };
+}
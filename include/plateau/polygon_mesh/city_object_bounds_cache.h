@@ -0,0 +1,62 @@
+#pragma once
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include <citygml/vecs.hpp>
+#include <libplateau_api.h>
+
+namespace citygml {
+    class CityObject;
+}
+
+namespace plateau::polygonMesh {
+    class ThreadPool;
+
+    /// CityObject の位置と、緯度・経度・高さの外接直方体です。座標は GML ファイル中の座標系のままです。
+    struct CityObjectBounds {
+        /// PolygonMeshUtils::cityObjPos と同じ方法で求めた、CityObject の位置を表す1点です。
+        TVec3d position;
+        TVec3d min;
+        TVec3d max;
+    };
+
+    /**
+     * CityObject ごとの位置と外接直方体を、1回だけ計算して保持するキャッシュです。
+     * 範囲による地物の除外とグリッドへの分類は、どちらも CityObject の位置を必要としますが、
+     * PolygonMeshUtils::cityObjPos は呼ぶたびに Geometry を走査し、位置が不明なときに例外を投げます。
+     * このキャッシュでは Geometry の走査を CityObject ごとに1回で済ませ、位置が不明な場合は例外ではなく std::nullopt で表します。
+     *
+     * 構築後は複数スレッドから同時に読み取ることができます。
+     */
+    class LIBPLATEAU_EXPORT CityObjectBoundsCache {
+    public:
+        /**
+         * 引数の各 CityObject について位置と外接直方体を求めて記録します。
+         * thread_count は MeshExtractOptions::thread_count と同じ意味です。
+         */
+        void build(const std::vector<const citygml::CityObject*>& city_objects, unsigned thread_count = 1);
+
+        /// build と同じですが、スレッドを作る代わりに呼び出し元の thread_pool で並列に処理します。
+        void build(const std::vector<const citygml::CityObject*>& city_objects, const ThreadPool& thread_pool);
+
+        /**
+         * city_obj の位置と外接直方体を返します。位置が不明であれば std::nullopt を返します。
+         * キャッシュにない CityObject についてはその場で計算します。
+         */
+        std::optional<CityObjectBounds> find(const citygml::CityObject& city_obj) const;
+
+        /// find の結果のうち位置だけを返します。
+        std::optional<TVec3d> findPosition(const citygml::CityObject& city_obj) const;
+
+        /**
+         * city_obj の位置と外接直方体を計算します。
+         * Envelope が GML ファイルに記載されていればそれを使い、なければ city_obj とその子孫の全LODのポリゴンの頂点から求めます。
+         * ポリゴンの頂点が1つもなければ std::nullopt を返します。
+         */
+        static std::optional<CityObjectBounds> compute(const citygml::CityObject& city_obj);
+
+    private:
+        std::unordered_map<const citygml::CityObject*, std::optional<CityObjectBounds>> entries_;
+    };
+}
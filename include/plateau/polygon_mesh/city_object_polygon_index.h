@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+#include <libplateau_api.h>
+#include <plateau/polygon_mesh/polygon_mesh_utils.h>
+
+namespace plateau::polygonMesh {
+    class ThreadPool;
+
+    /// 1つの CityObject が持つポリゴンのうち、あるLODに属するものの一覧です。
+    struct LodPolygons {
+        std::vector<const citygml::Polygon*> polygons;
+        /// polygons の頂点数の合計です。
+        long long vertex_count = 0;
+        /// polygons のインデックス数の合計です。
+        long long index_count = 0;
+    };
+
+    /**
+     * CityObject ごとに、その Geometry に含まれるポリゴンを LOD 別に分類した索引です。
+     * Geometry の木構造を1回だけ走査して全LODのポリゴンを集め、頂点数とインデックス数も事前に数えておきます。
+     * メッシュ抽出では、CityObject と LOD の組ごとに Geometry を再帰的に走査する代わりにこの索引を参照します。
+     *
+     * 構築後は複数スレッドから同時に読み取ることができます。
+     */
+    class LIBPLATEAU_EXPORT CityObjectPolygonIndex {
+    public:
+        using LodBuckets = std::array<LodPolygons, PolygonMeshUtils::max_lod_in_specification_ + 1>;
+        /// LOD i のポリゴンが存在するとき、下から i 番目のビットが立つビットマスクです。
+        using LodMask = unsigned;
+
+        static constexpr bool lodMaskContains(const LodMask mask, const unsigned lod) {
+            return (mask >> lod & 1u) != 0;
+        }
+
+        /**
+         * 引数の各 CityObject とその子孫について索引を作ります。
+         * thread_count は MeshExtractOptions::thread_count と同じ意味です。
+         */
+        void build(const std::vector<const citygml::CityObject*>& city_objects, unsigned thread_count = 1);
+
+        /// build と同じですが、スレッドを作る代わりに呼び出し元の thread_pool で並列に処理します。
+        void build(const std::vector<const citygml::CityObject*>& city_objects, const ThreadPool& thread_pool);
+
+        /**
+         * city_obj 自身の Geometry に含まれる、指定LODのポリゴンの一覧を返します。子の CityObject のポリゴンは含みません。
+         * 索引にない CityObject の場合、または LOD が仕様上の範囲外の場合は nullptr を返します。
+         */
+        const LodPolygons* find(const citygml::CityObject& city_obj, unsigned lod) const;
+
+        /**
+         * city_obj またはその子孫が、指定LODで頂点を1つ以上もつポリゴンを持つかどうかを返します。
+         * 索引にない CityObject については Geometry を走査して判定します。
+         */
+        bool hasPolygonsRecursive(const citygml::CityObject& city_obj, unsigned lod) const;
+
+        /**
+         * city_obj とその子孫のうち、頂点を1つ以上もつポリゴンが存在するLODをビットマスクで返します。
+         * 索引にある CityObject については build 時に計算済みの値を返すため、木構造の走査は発生しません。
+         * 索引にない CityObject については全LODについて Geometry を走査して求めます。
+         */
+        LodMask getLodMaskRecursive(const citygml::CityObject& city_obj) const;
+
+        /**
+         * city_obj の Geometry を1回だけ走査し、全LODのポリゴンを LOD 別に分類して返します。
+         * 子の CityObject は走査しません。子の Geometry は再帰的に走査します。
+         * 各LODのポリゴンの順番は、LODを指定して Geometry を走査した場合と同じです。
+         */
+        static LodBuckets collect(const citygml::CityObject& city_obj);
+
+        /**
+         * collect と同じ結果を out_buckets に格納します。
+         * out_buckets の元の内容は消去しますが、確保済みの容量は保つため、同じ out_buckets を使い回せばメモリを確保し直しません。
+         */
+        static void collect(const citygml::CityObject& city_obj, LodBuckets& out_buckets);
+
+    private:
+        struct Entry {
+            LodBuckets buckets;
+            /// 子孫を含めたLODのビットマスクです。
+            LodMask lod_mask_recursive = 0;
+        };
+
+        /// 索引にある city_obj について、子孫を含めたLODのビットマスクを求めて entries_ に記録します。
+        LodMask computeLodMaskRecursive(const citygml::CityObject& city_obj);
+
+        std::unordered_map<const citygml::CityObject*, Entry> entries_;
+    };
+}
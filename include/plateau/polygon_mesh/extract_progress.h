@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <libplateau_api.h>
+
+namespace plateau::polygonMesh {
+
+    /// メッシュ抽出の処理段階です。
+    enum class ExtractStage : int {
+        /// 地物からメッシュを生成する段階です。
+        Geometry = 0,
+        /// テクスチャを結合する段階です。
+        TexturePacking = 1,
+        /// 地形に地図タイルを貼り付ける段階です。
+        MapAttach = 2
+    };
+
+    /// ExtractProgress::cancel によってメッシュ抽出が中断されたときに投げられる例外です。
+    class LIBPLATEAU_EXPORT ExtractCancelledException : public std::runtime_error {
+    public:
+        ExtractCancelledException();
+    };
+
+    /**
+     * メッシュ抽出の進捗の通知先と、抽出を中断するためのフラグをまとめたものです。
+     * MeshExtractor に渡すと、抽出処理は地物またはメッシュを1つ処理するたびに進捗を通知し、中断が要求されていないか確認します。
+     * 中断が要求されていれば ExtractCancelledException を投げて抽出を打ち切ります。
+     *
+     * 抽出処理は複数のスレッドから進捗を通知しますが、コールバックが同時に複数呼ばれることはありません。
+     * cancel はどのスレッドからでも、いつでも呼ぶことができます。
+     */
+    class LIBPLATEAU_EXPORT ExtractProgress {
+    public:
+        /// LODの区別がない進捗であることを示す lod の値です。
+        static constexpr unsigned no_lod = std::numeric_limits<unsigned>::max();
+
+        /**
+         * 処理段階 stage について、処理済みの数 processed と全体の数 total を受け取る関数です。
+         * 段階ごとの lod と数の意味は次のとおりです。
+         * - Geometry: lod はそのLODであり、数は lod で処理する主要地物の数です。
+         *   ただし HLOD (MeshExtractOptions::build_hlod) を作るときは、1つのメッシュに複数のLODが混ざるため lod は no_lod であり、
+         *   数は HLOD の4分木のノードの数です。
+         * - TexturePacking: lod は no_lod であり、数は全LODを合わせたメッシュの数です。
+         * - MapAttach: lod は no_lod であり、数は全LODを合わせたメッシュの数です。
+         * MeshExtractor::extractPerExtent では、 TexturePacking と MapAttach はタイルごとに 0 から通知し直し、数はそのタイルのメッシュの数です。
+         * 複数のスレッドから通知されるため、同じ段階とLODについて processed の小さい通知が後から届くことがあります。
+         */
+        using Callback = std::function<void(ExtractStage stage, unsigned lod, size_t processed, size_t total)>;
+
+        ExtractProgress();
+        explicit ExtractProgress(Callback on_progress);
+
+        /// コピーを禁止します。
+        ExtractProgress(const ExtractProgress&) = delete;
+        ExtractProgress& operator=(const ExtractProgress&) = delete;
+
+        /// 抽出の中断を要求します。
+        void cancel();
+        bool isCancelled() const;
+
+        /// 中断が要求されていれば ExtractCancelledException を投げます。
+        void throwIfCancelled() const;
+
+        /// 進捗をコールバックに通知します。抽出処理から呼ばれます。
+        void report(ExtractStage stage, unsigned lod, size_t processed, size_t total) const;
+
+    private:
+        std::atomic<bool> is_cancelled_;
+        Callback on_progress_;
+        /// コールバックが同時に呼ばれないようにします。
+        mutable std::mutex callback_mutex_;
+    };
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <libplateau_api.h>
+
+namespace plateau::polygonMesh {
+
+    /**
+     * 1回のメッシュ抽出の間だけ必要な状態を保持します。現在は、抽出中に書き出すファイルの名前の予約を管理します。
+     *
+     * 結合後のテクスチャ画像や地図タイル画像は、既存のファイルを上書きしないよう、番号を変えながら存在しない名前を探して保存されます。
+     * しかし名前を決めてからファイルを書き出すまでの間に、別のスレッドの抽出が同じ名前を選ぶことがあります。
+     * そこで、名前を選ぶときにプロセス全体で共有する予約表に登録し、セッションが破棄されるまで他のセッションがその名前を選ばないようにします。
+     * 予約はプロセス内でのみ有効です。別のプロセスとの間では、ファイルの有無による確認のみ行われます。
+     *
+     * 1つのセッションは複数スレッドから同時に利用できます。
+     */
+    class LIBPLATEAU_EXPORT ExtractSession {
+    public:
+        ExtractSession() = default;
+        ExtractSession(const ExtractSession&) = delete;
+        ExtractSession& operator=(const ExtractSession&) = delete;
+
+        /// このセッションが予約した名前をすべて解放します。
+        ~ExtractSession();
+
+        /**
+         * path_at(0), path_at(1), ... の順に候補のパスを求め、ファイルが存在せず、どのセッションも予約していない最初のパスを予約して返します。
+         * 予約はこのセッションが破棄されるまで有効です。
+         */
+        std::filesystem::path reserveUniquePath(const std::function<std::filesystem::path(int attempt)>& path_at);
+
+    private:
+        std::mutex mutex_;
+        std::vector<std::string> reserved_keys_;
+    };
+}
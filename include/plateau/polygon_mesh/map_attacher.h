@@ -2,6 +2,8 @@
 
 #include <plateau/polygon_mesh/model.h>
 #include <plateau/geometry/geo_reference.h>
+#include <plateau/polygon_mesh/extract_progress.h>
+#include <plateau/polygon_mesh/extract_session.h>
 #include <filesystem>
 
 namespace  plateau::polygonMesh {
@@ -14,8 +16,11 @@ namespace  plateau::polygonMesh {
         /**
          * 引数のModelに含まれる各Meshに対し、航空写真または地図を貼り付けます。
          * 正常に読み込むことができた地図タイルの数を返します。
+         * progress が渡された場合、メッシュを1つ処理するたびに進捗を通知し、中断が要求されていれば ExtractCancelledException を投げます。
+         * 結合した地図タイル画像のファイル名は session で予約します。 nullptr の場合はこの呼び出しの間だけ有効なセッションを作ります。
          */
-        int attach(Model& model, const std::string& map_url_template, const std::filesystem::path& map_download_dest, const int zoom_level, const GeoReference& geo_reference);
+        int attach(Model& model, const std::string& map_url_template, const std::filesystem::path& map_download_dest, const int zoom_level, const GeoReference& geo_reference,
+                   const ExtractProgress* progress = nullptr, ExtractSession* session = nullptr);
     };
 
 }
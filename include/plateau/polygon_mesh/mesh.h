@@ -8,10 +8,26 @@
 #include "plateau/polygon_mesh/quaternion.h"
 #include <libplateau_api.h>
 #include <optional>
+#include <utility>
 
 namespace plateau::polygonMesh {
     using UV = std::vector<TVec2f>;
 
+    /**
+     * メッシュの indices のうち、1つの CityObjectIndex の三角形が連続して並ぶ範囲と、その範囲の頂点の範囲(AABB)です。
+     * 詳しくは Mesh::buildCityObjectRanges をご覧ください。
+     */
+    struct LIBPLATEAU_EXPORT CityObjectRange {
+        CityObjectIndex city_object_index;
+        /// 範囲の先頭の、 indices での位置です。
+        unsigned index_start;
+        /// 範囲に含まれる indices の数です。3の倍数になります。
+        unsigned index_count;
+        /// 範囲の三角形が使う頂点座標の最小・最大です。
+        TVec3d bounds_min;
+        TVec3d bounds_max;
+    };
+
     /**
      * メッシュ情報です。
      * Unity や Unreal Engine でメッシュを生成するために必要な情報が含まれるよう意図されています。
@@ -58,6 +74,12 @@ namespace plateau::polygonMesh {
         void addIndicesList(const std::vector<unsigned>& other_indices, unsigned prev_num_vertices,
                             bool invert_mesh_front_back);
 
+        /**
+         * すべての三角形の頂点の順番を反転し、メッシュを裏返します。
+         * 座標軸の変換で鏡像になった頂点に対して、面の向きを補正するために利用します。
+         */
+        void invertMeshFrontBack();
+
         void setUV1(UV&& uv);
         void setUV4(UV&& uv4);
 
@@ -80,6 +102,17 @@ namespace plateau::polygonMesh {
          */
         void addSubMesh(const std::string& texture_path, std::shared_ptr<const citygml::Material> material, size_t sub_mesh_start_index, size_t sub_mesh_end_index, int game_material_id);
 
+        /**
+         * 同じマテリアル (SubMesh::isSameAs で同じとみなされるもの) の三角形が連続するよう三角形を並べ替え、
+         * SubMesh をマテリアルごとに1つにまとめます。
+         * テクスチャありとなしのポリゴンが交互に追加されると細かい SubMesh が大量にでき、
+         * ゲームエンジンではその数だけ描画呼び出しが増えるため、それを減らすために利用します。
+         * 並べ替えは安定であり、同じマテリアル同士の三角形の順番と、まとめた後の SubMesh の順番は元の出現順のままです。
+         * 頂点は並べ替えないため、 UV4 の CityObjectIndex を含む頂点ごとの情報はそのまま保たれます。
+         * どの SubMesh にも含まれない三角形は、まとめた SubMesh の後ろに元の順番で並べます。
+         */
+        void coalesceSubMeshes();
+
         /**
          * 直前の SubMesh の範囲を拡大し、範囲の終わりがindicesリストの最後を指すようにします。
          * 利用すべき状況 : 形状を追加したけど、テクスチャは前と同じものにしたいとう状況で利用できます。
@@ -100,6 +133,39 @@ namespace plateau::polygonMesh {
 
         void merge(const Mesh& other_mesh, const bool invert_mesh_front_back, const bool include_textures);
 
+        /**
+         * UV4 の CityObjectIndex をもとに、地物ごとの三角形の範囲と AABB の表を作り、このメッシュに保持します。
+         * 地域単位で結合したメッシュの中の1つの建物を選択・強調・非表示にするとき、ゲームエンジン側で
+         * 頂点ごとに UV4 を調べる代わりに、この表の indices の範囲を操作すればよくなります。
+         *
+         * 同じ CityObjectIndex の三角形が indices 上で連続する部分ごとに1つの範囲とします。
+         * 範囲は SubMesh の境界で分けるため、各範囲は1つの SubMesh に収まります。
+         * そのため1つの地物が複数の SubMesh にまたがる場合は、その地物の範囲は複数になります。
+         * 表は CityObjectIndex の順 (primary_index, atomic_index の順) に並べ、同じ CityObjectIndex の中では indices の順とします。
+         * したがって1つの地物の範囲と、1つの主要地物とその最小地物の範囲は、それぞれ表の中で連続します。
+         * その位置は findCityObjectRanges と findPrimaryCityObjectRanges で求められます。
+         * 三角形の CityObjectIndex は1番目の頂点の UV4 によります。 UV4 のない頂点は CityObjectIndex(0, 0) とみなします。
+         *
+         * 表は作った時点のメッシュに対するものです。 indices を並べ替える操作 (coalesceSubMeshes, addIndicesList, merge) を行うと破棄されます。
+         * 頂点座標を変更した場合は作り直してください。
+         */
+        void buildCityObjectRanges();
+
+        /// buildCityObjectRanges で作った表を返します。作っていない場合や破棄された後は空です。
+        const std::vector<CityObjectRange>& getCityObjectRanges() const;
+
+        /**
+         * getCityObjectRanges() のうち city_object_index の範囲が並ぶ位置を、 (先頭の番号, 個数) で返します。
+         * 表を二分探索するため、地物の数によらず高速です。該当する範囲がなければ個数は 0 です。
+         */
+        std::pair<size_t, size_t> findCityObjectRanges(const CityObjectIndex& city_object_index) const;
+
+        /**
+         * getCityObjectRanges() のうち、主要地物 primary_index とその最小地物すべての範囲が並ぶ位置を (先頭の番号, 個数) で返します。
+         * 該当する範囲がなければ個数は 0 です。
+         */
+        std::pair<size_t, size_t> findPrimaryCityObjectRanges(int primary_index) const;
+
     private:
         friend class MeshFactory;
 
@@ -121,6 +187,9 @@ namespace plateau::polygonMesh {
         /// CityGMLには頂点カラーはないのでインポート時は使いませんが、
         /// UnityでRenderingToolkitを利用すると頂点カラーを使うのでそれのエクスポート時に利用します。
         std::vector<TVec3d> vertex_colors_;
+
+        /// 地物ごとの三角形の範囲です。 buildCityObjectRanges で作ります。
+        std::vector<CityObjectRange> city_object_ranges_;
     };
 }
 
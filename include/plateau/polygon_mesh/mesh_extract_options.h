@@ -2,6 +2,7 @@
 
 #include <plateau/geometry/geo_coordinate.h>
 #include <citygml/vecs.hpp>
+#include <citygml/cityobject.h>
 #include <plateau/polygon_mesh/polygon_mesh_utils.h>
 
 namespace plateau::polygonMesh {
@@ -19,6 +20,29 @@ namespace plateau::polygonMesh {
         PerCityModelArea = 2
     };
 
+    /**
+     * 属性による地物の絞り込みで、地物の属性値と MeshExtractOptions::attribute_filter_value をどう比較するかです。
+     * 属性値とフィルタ値がどちらも数値として読めるときは数値として、そうでなければ文字列として比較します。
+     */
+    enum class AttributeFilterComparison {
+        //! 属性で絞り込みません。
+        None = 0,
+        //! 属性が存在すれば値によらず残します。
+        Exists = 1,
+        //! 属性値 == フィルタ値 であれば残します。
+        Equal = 2,
+        //! 属性値 != フィルタ値 であれば残します。
+        NotEqual = 3,
+        //! 属性値 < フィルタ値 であれば残します。
+        Less = 4,
+        //! 属性値 <= フィルタ値 であれば残します。
+        LessOrEqual = 5,
+        //! 属性値 > フィルタ値 であれば残します。
+        Greater = 6,
+        //! 属性値 >= フィルタ値 であれば残します。
+        GreaterOrEqual = 7
+    };
+
     struct MeshExtractOptions {
         /// 設定をデフォルト値にするコンストラクタです。
         MeshExtractOptions() :
@@ -37,7 +61,23 @@ namespace plateau::polygonMesh {
                 texture_packing_resolution(2048),
                 attach_map_tile(true),
                 map_tile_zoom_level(15),
-                map_tile_url("https://cyberjapandata.gsi.go.jp/xyz/seamlessphoto/{z}/{x}/{y}.jpg")
+                map_tile_url("https://cyberjapandata.gsi.go.jp/xyz/seamlessphoto/{z}/{x}/{y}.jpg"),
+                thread_count(1),
+                max_triangle_count_in_grid(0),
+                clip_polygons_to_extent(false),
+                city_object_type_mask(citygml::CityObject::CityObjectsType::COT_All),
+                attribute_filter_comparison(AttributeFilterComparison::None),
+                attribute_filter_key(""),
+                attribute_filter_value(""),
+                coalesce_sub_meshes_by_material(false),
+                extract_implicit_geometry_as_instances(false),
+                rasterize_relief(false),
+                relief_raster_cell_size(5.0),
+                relief_chunk_size(0),
+                relief_skirt_height(10.0),
+                build_hlod(false),
+                hlod_switch_distance_factor(4.0),
+                build_city_object_ranges(false)
                 {}
 
     public:
@@ -111,5 +151,129 @@ namespace plateau::polygonMesh {
          * https://ctrlshift.hatenadiary.org/entry/20080119/1200719590
          */
         char map_tile_url[1000];
+
+        /**
+         * メッシュ抽出に利用するスレッド数です。
+         * 1 のとき単一スレッドで処理し、 0 のときハードウェアの並列数を利用します。
+         * スレッド数によらず、出力される Model のノード順序と CityObjectIndex は同一になります。
+         */
+        unsigned thread_count;
+
+        /**
+         * メッシュ結合単位が PerCityModelArea のときのみ有効です。
+         * 0 より大きいとき、グリッド内の三角形数がこの値を超える間、そのグリッドを4分割することを繰り返します。
+         * 建物が密集した地域のメッシュが大きくなりすぎることを防ぎます。
+         * 三角形数は主要地物ごとに min_lod から max_lod のうち最も多いLODで数え、全LODで同じ分割を使います。
+         * 0 のとき、 grid_count_of_side による均等なグリッドのみで分割します。
+         */
+        unsigned max_triangle_count_in_grid;
+
+        /**
+         * 範囲の境界をまたぐ三角形を、境界で正確に切り取るかどうかです。
+         * exclude_polygons_outside_extent では頂点が1つでも範囲内にあるポリゴンは丸ごと残るため、
+         * メッシュコードごとに分けて抽出すると境界付近の三角形が隣の範囲と重複します。
+         * true にすると範囲外の部分を取り除き、境界上の頂点の位置と UV は元の辺から補間して求めます。
+         * 隣り合う範囲で抽出した結果は境界で重複もすき間もなく接します。
+         * 指定した範囲同士が重なっている場合、重なった部分は重複して出力されます。
+         */
+        bool clip_polygons_to_extent;
+
+        /**
+         * 出力する主要地物の種類を CityObjectsType のビットマスクで指定します。
+         * 型がこのマスクに含まれない主要地物は、ポリゴンを読む前に除外されます。
+         * デフォルトでは全種類を出力します。
+         */
+        citygml::CityObject::CityObjectsType city_object_type_mask;
+
+        /**
+         * 主要地物を属性で絞り込むときの比較方法です。 None のとき属性では絞り込みません。
+         * 例えば attribute_filter_key を "bldg:measuredheight"、 attribute_filter_value を "30"、
+         * この値を Greater とすると、高さが30を超える建物のみを出力します。
+         * 指定した属性を持たない主要地物は、比較方法によらず除外されます。
+         */
+        AttributeFilterComparison attribute_filter_comparison;
+
+        /**
+         * 主要地物を属性で絞り込むときの属性名です。
+         * C#とC++でマーシャリングする関係上、charの固定長配列である必要があります。
+         */
+        char attribute_filter_key[256];
+
+        /**
+         * 主要地物を属性で絞り込むときに、属性値と比較する値です。
+         * C#とC++でマーシャリングする関係上、charの固定長配列である必要があります。
+         */
+        char attribute_filter_value[256];
+
+        /**
+         * 抽出後に、各メッシュの三角形をマテリアルごとに並べ替えて SubMesh を1つにまとめるかどうかです。
+         * テクスチャありとなしのポリゴンが混在すると細かい SubMesh が大量にでき、描画呼び出しが増えるのを防ぎます。
+         * 三角形の順番は変わりますが、頂点と UV4 の CityObjectIndex は変わりません。
+         * 詳しくは Mesh::coalesceSubMeshes をご覧ください。
+         */
+        bool coalesce_sub_meshes_by_material;
+
+        /**
+         * 暗黙的ジオメトリ(ImplicitGeometry)を、インスタンス化できる形で出力するかどうかです。
+         * true のとき、街路樹や道路標識のように同じ形状を参照する暗黙的ジオメトリについて、形状ごとに1つのメッシュを
+         * Model のインスタンスプロトタイプとして出力し、配置ごとには変換行列を MeshInstance として出力します。
+         * false のとき、暗黙的ジオメトリは出力しません。
+         * Model を返さないストリーミング抽出では利用できません。
+         */
+        bool extract_implicit_geometry_as_instances;
+
+        /**
+         * 地形 (PredefinedCityModelPackage::Relief) の TIN を、等間隔の格子による地形メッシュに変換して出力するかどうかです。
+         * true のとき、各LODノードの下の地形は relief_raster_cell_size 間隔の格子状のメッシュ1つに置き換わり、
+         * メッシュの粒度の設定によらず地物ごとのノードは作りません。元の TIN のテクスチャは引き継ぎませんが、
+         * attach_map_tile による地図タイルは格子状のメッシュに貼り付けます。
+         * 詳しくは ReliefRasterizer をご覧ください。
+         * Model を返さないストリーミング抽出では利用できません。
+         * 地形の都市モデルでは build_hlod より優先し、 build_hlod が true でも LODノードの下に格子状のメッシュを出力します。
+         */
+        bool rasterize_relief;
+
+        /**
+         * rasterize_relief が true のときの、格子の間隔です。単位はメートルです。
+         */
+        float relief_raster_cell_size;
+
+        /**
+         * rasterize_relief が true のとき、地形を何メートル四方のチャンクに分けるかです。 0 のときは分けません。
+         * チャンクごとに "relief_chunk_{x}_{y}" という名前のノードになり、ゲームエンジン側で個別に読み込み・破棄できます。
+         * チャンクの境界は基準点からの距離で決まるため、範囲を分けて抽出しても一致します。
+         */
+        float relief_chunk_size;
+
+        /**
+         * relief_chunk_size が正のとき、チャンクの外周に加える垂直な面(スカート)の高さです。単位はメートルで、 0 のときはスカートを付けません。
+         * 隣り合うチャンクの解像度が異なるときに、継ぎ目に隙間が見えるのを防ぎます。
+         */
+        float relief_skirt_height;
+
+        /**
+         * メッシュ結合単位が PerCityModelArea のときのみ有効です。
+         * true のとき、LODごとのノードの代わりに、 grid_count_of_side によるグリッドを葉とする4分木のノード "HLOD" を出力します。
+         * 葉のノードは、グリッド内の各主要地物を min_lod から max_lod のうち存在する最も高いLODで結合したメッシュを持ちます。
+         * 葉以外のノードは、子孫のグリッドにある主要地物を LOD1 (なければ LOD0) の形状で結合した粗いメッシュを持ちます。
+         * 各ノードには範囲と表示を切り替える距離 (HlodInfo) が設定され、ゲームエンジン側で距離に応じて読み込み・表示するノードを選べます。
+         * max_triangle_count_in_grid によるグリッドの分割は行いません。
+         * Model を返さないストリーミング抽出と、範囲ごとに分けて返す MeshExtractor::extractPerExtent では無視されます。
+         * rasterize_relief が true のときの地形の都市モデルでも無視し、HlodInfo を持たない LODノードを出力します。
+         */
+        bool build_hlod;
+
+        /**
+         * build_hlod が true のとき、各ノードの HlodInfo::switch_distance を、ノードの範囲の外接球の半径の何倍にするかです。
+         */
+        float hlod_switch_distance_factor;
+
+        /**
+         * 抽出の最後に、各メッシュについて地物ごとの三角形の範囲と AABB の表 (Mesh::getCityObjectRanges) を作るかどうかです。
+         * 結合したメッシュの中の個々の地物を、ゲームエンジン側で選択・強調・非表示にするときに利用できます。
+         * 表は SubMesh をまとめた後のメッシュに対して作るため、 coalesce_sub_meshes_by_material と併用できます。
+         * 詳しくは Mesh::buildCityObjectRanges をご覧ください。
+         */
+        bool build_city_object_ranges;
     };
 }
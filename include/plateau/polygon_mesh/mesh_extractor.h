@@ -2,8 +2,10 @@
 
 #include <libplateau_api.h>
 #include <memory>
+#include <functional>
 #include <plateau/polygon_mesh/mesh.h>
 #include <plateau/polygon_mesh/mesh_extract_options.h>
+#include <plateau/polygon_mesh/extract_progress.h>
 #include <plateau/geometry/geo_coordinate.h>
 #include "citygml/citymodel.h"
 #include "model.h"
@@ -16,6 +18,10 @@ namespace plateau::polygonMesh {
      * ゲームオブジェクト、メッシュ、テクスチャを生成することが期待されます。
      *
      * 詳しくは Model クラスのコメントを参照してください。
+     *
+     * 各関数は再入可能であり、異なる CityModel に対する抽出を複数のスレッドから同時に実行できます。
+     * 抽出中に書き出すファイルの名前は、抽出ごとの ExtractSession によって他の抽出と重ならないよう予約されます。
+     * ただし、同じ CityModel に対して同時に抽出する場合、および地図タイルのダウンロード先を共有する場合の動作は保証しません。
      */
     class LIBPLATEAU_EXPORT MeshExtractor {
     public:
@@ -31,8 +37,10 @@ namespace plateau::polygonMesh {
          * DLL利用者との間でModelをやりとりするには生ポインタである必要があるための措置です。
          * 別途 初期化されたばかりのModelを引数で受け取り、そのModelに対して結果を格納します。
          * 生ポインタのdeleteはDLLの利用者の責任です。
+         * progress を渡すと進捗を通知し、 progress->cancel() で抽出を中断できます。
+         * 中断したときは ExtractCancelledException を投げ、 out_model の内容は不定です。
          */
-        static void extract(Model& out_model, const citygml::CityModel& city_model, const MeshExtractOptions& options);
+        static void extract(Model& out_model, const citygml::CityModel& city_model, const MeshExtractOptions& options, const ExtractProgress* progress = nullptr);
 
         /**
          * CityModelから範囲内のModelを取り出します。
@@ -42,7 +50,39 @@ namespace plateau::polygonMesh {
         /**
          * CityModelから範囲内のModelを取り出します。
          */
-        static void extractInExtents(Model& out_model, const citygml::CityModel& city_model, const MeshExtractOptions& options, const std::vector<plateau::geometry::Extent>& extents);
+        static void extractInExtents(Model& out_model, const citygml::CityModel& city_model, const MeshExtractOptions& options, const std::vector<plateau::geometry::Extent>& extents, const ExtractProgress* progress = nullptr);
+
+        /**
+         * CityModel を tile_extents の範囲ごとに分けて取り出し、 tile_extents と同じ順番で Model を返します。
+         * 範囲ごとに extractInExtents を呼ぶのとは異なり、 CityModel の走査と頂点の座標変換は全範囲を合わせて1回だけ行い、
+         * その結果の三角形を範囲ごとに振り分けます。そのため、各三角形はちょうど1つの Model に含まれます。
+         * 範囲の境界をまたぐ三角形は重心が含まれる範囲に振り分けられます。
+         * 境界で正確に分けたい場合は options.clip_polygons_to_extent を指定してください。
+         * options.build_hlod は無視し、各 Model は LODごとのノードを持ちます。
+         * HLOD の各ノードの範囲と粗いメッシュは抽出範囲全体に対して作られるため、範囲ごとに振り分けると意味を失うためです。
+         * テクスチャ結合 (options.enable_texture_packing) と地図タイルの貼り付けは振り分けた後に Model ごとに行うため、
+         * 各 Model が参照する結合後の画像と地図タイルの画像は、その Model の範囲のものだけです。
+         */
+        static std::vector<std::shared_ptr<Model>> extractPerExtent(const citygml::CityModel& city_model, const MeshExtractOptions& options, const std::vector<plateau::geometry::Extent>& tile_extents, const ExtractProgress* progress = nullptr);
+
+        /// extractStreaming で、構築が終わったノードを受け取る関数です。 lod はそのノードが属するLODです。
+        using NodeCallback = std::function<void(unsigned lod, Node&& node)>;
+
+        /**
+         * CityModel から取り出した結果を Model にまとめる代わりに、構築が終わったノードから順に on_node_extracted に渡します。
+         * 渡すのは extract の結果で LODノードの子となるノード (グループごと、または主要地物ごとのノード) であり、順番も extract と同じです。
+         * 子もメッシュもないノードは渡しません。
+         * 渡したノードはコールバックが move しない限り直後に破棄されるため、 Model 全体をメモリ上に持たずに済みます。
+         * 同時にメモリ上にある結合後のメッシュは options.thread_count 個程度です。
+         * options.enable_texture_packing の場合、結合後のテクスチャ画像はすべてのノードを渡し終えてから書き出されます。
+         * progress を渡した場合、通知されるのは Geometry 段階の進捗のみです。
+         */
+        static void extractStreaming(const citygml::CityModel& city_model, const MeshExtractOptions& options, const NodeCallback& on_node_extracted, const ExtractProgress* progress = nullptr);
+
+        /**
+         * extractStreaming の範囲指定版です。
+         */
+        static void extractInExtentsStreaming(const citygml::CityModel& city_model, const MeshExtractOptions& options, const std::vector<plateau::geometry::Extent>& extents, const NodeCallback& on_node_extracted, const ExtractProgress* progress = nullptr);
 
         /**
          * 引数で与えられた LOD の主要地物について、次を判定して bool で返します。
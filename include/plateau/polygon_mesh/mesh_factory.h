@@ -5,7 +5,11 @@
 #include <citygml/polygon.h>
 #include <citygml/cityobject.h>
 #include <list>
+#include <optional>
 #include "plateau/geometry/geo_reference.h"
+#include <plateau/geometry/extent_index.h>
+#include <plateau/polygon_mesh/city_object_polygon_index.h>
+#include <plateau/polygon_mesh/texture_path_cache.h>
 
 namespace plateau::polygonMesh {
 
@@ -14,11 +18,23 @@ namespace plateau::polygonMesh {
      */
     class LIBPLATEAU_EXPORT MeshFactory {
     public:
+        /**
+         * polygon_index を渡すと、ポリゴンの検索に Geometry の走査の代わりにその索引を利用します。
+         * 索引の寿命は MeshFactory より長い必要があります。
+         * nullptr の場合や索引にない CityObject の場合は、その都度 Geometry を走査します。
+         * texture_path_cache を渡すと、テクスチャパスの絶対パスへの変換結果をそのキャッシュで共有します。
+         * extent_index を渡すと、範囲外のポリゴンの除外にその索引を利用します。 extents から作られたものである必要があります。
+         * nullptr の場合は必要になった時点で extents から作ります。
+         * 寿命は polygon_index と同様です。
+         */
         MeshFactory(
             std::unique_ptr<Mesh>&& target,
             const MeshExtractOptions& mesh_extract_options,
             const std::vector<plateau::geometry::Extent>& extents,
-            const geometry::GeoReference& geo_reference = geometry::GeoReference(9));
+            const geometry::GeoReference& geo_reference = geometry::GeoReference(9),
+            const CityObjectPolygonIndex* polygon_index = nullptr,
+            TexturePathCache* texture_path_cache = nullptr,
+            const geometry::ExtentIndex* extent_index = nullptr);
 
         std::unique_ptr<Mesh> releaseMesh() {
             return std::move(mesh_);
@@ -29,10 +45,18 @@ namespace plateau::polygonMesh {
          * 引数で与えられたポリゴンのうち、次の情報を追加します。
          * ・頂点リスト、インデックスリスト、UV1、テクスチャ。
          * なおその他の情報のマージには未対応です。例えば LinearRing は考慮されません。
-         * options.export_appearance の値によって、 mergeWithTexture または mergeWithoutTexture を呼び出します。
+         * options.export_appearance が true ならテクスチャごとに SubMesh を分け、 false なら最後の SubMesh を延長します。
+         * 一時的な Mesh は作らず、変換結果を直接 mesh の末尾に追加します。
          */
         void addPolygon(const citygml::Polygon& polygon, const std::string& gml_path) const;
 
+        /**
+         * ImplicitGeometry のテンプレートのように、頂点が緯度・経度ではなくメートル単位のローカル座標であるポリゴンを追加します。
+         * 頂点には単位と座標軸の変換のみを行い、平面直角座標への変換と基準点の適用は行いません。
+         * 範囲によるポリゴンの除外と切り取りは行いません。それ以外は addPolygon と同じです。
+         */
+        void addPolygonInLocalCoordinates(const citygml::Polygon& polygon, const std::string& gml_path) const;
+
         /**
          * 主要地物の主要地物IDを設定しMeshをマージします。
          */
@@ -68,7 +92,7 @@ namespace plateau::polygonMesh {
          * 子の CityObject は検索しません。
          * 子の Geometry は再帰的に検索します。
          */
-        void findAllPolygons(const citygml::CityObject& city_obj, unsigned lod, std::list<const citygml::Polygon*>& out_polygons, long long& out_vertices_count);
+        void findAllPolygons(const citygml::CityObject& city_obj, unsigned lod, std::vector<const citygml::Polygon*>& out_polygons, long long& out_vertices_count);
 
         /**
          * PLATEAUからメッシュを読み込んで座標軸を変換をするとき、このままだとメッシュが裏返ることがあります（座標軸が反転したりするので）。
@@ -76,9 +100,46 @@ namespace plateau::polygonMesh {
          */
         static bool shouldInvertIndicesOnMeshConvert(plateau::geometry::CoordinateSystem sys);
     private:
+        /// addPolygon と addPolygonInLocalCoordinates の共通処理です。
+        void addPolygon(const citygml::Polygon& polygon, const std::string& gml_path, bool is_local_coordinates) const;
+
+        /**
+         * 緯度・経度・高さで表された頂点と、インデックス、UV1 を座標変換しながら mesh_ の末尾に追加します。
+         * is_local_coordinates が true のときは、頂点をメートル単位のローカル座標として扱います。
+         * UV1 が頂点数に足りない分は 0 で埋めます。
+         */
+        void appendShape(const std::vector<TVec3d>& vertices_lat_lon, const std::vector<unsigned>& indices,
+                         const std::vector<TVec2f>& uv_1, bool is_local_coordinates) const;
+
+        /**
+         * 地物ごと・ポリゴンごとの変換で使う一時的な配列です。
+         * 地物やポリゴンのたびにメモリを確保し直さないよう、使うたびに clear して容量を保ったまま使い回します。
+         * 地物をまたいで内容を持ち越すことはありません。
+         * なお、値で返す libcitygml の関数 (UV とテーマ一覧の取得) の中と、テクスチャの異なる SubMesh を追加するときの
+         * テクスチャパスのコピーではメモリの確保が残ります。
+         */
+        struct ScratchBuffers {
+            /// 地物に含まれるポリゴンの一覧です。 addPolygonsIn... と countVertices で使います。
+            std::vector<const citygml::Polygon*> polygons;
+            /// polygon_index_ にない地物について、 findAllPolygons がその場で LOD 別にポリゴンを集めるのに使います。
+            CityObjectPolygonIndex::LodBuckets lod_buckets;
+            /// 以下は addPolygon で1ポリゴンの変換に使います。
+            std::vector<TVec2f> uv_1;
+            std::vector<TVec3d> clipped_vertices_lat_lon;
+            std::vector<unsigned> clipped_indices;
+            std::vector<TVec2f> clipped_uv_1;
+        };
+
         MeshExtractOptions options_;
         geometry::GeoReference geo_reference_;
         std::vector<plateau::geometry::Extent> extents_;
+        const CityObjectPolygonIndex* polygon_index_;
+        TexturePathCache* texture_path_cache_;
+        const geometry::ExtentIndex* extent_index_;
+        /// extent_index_ が渡されなかった場合に、このクラスで作る索引です。
+        std::optional<geometry::ExtentIndex> own_extent_index_;
+        /// addPolygon は const ですが、一時的な配列の使い回しは外から見た状態を変えないため mutable とします。
+        mutable ScratchBuffers scratch_;
 
         std::unique_ptr<Mesh> mesh_;
         // 新規に主要地物を追加する際に利用可能なインデックス
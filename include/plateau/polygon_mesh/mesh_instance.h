@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <citygml/vecs.hpp>
+#include <libplateau_api.h>
+
+namespace plateau::polygonMesh {
+
+    /**
+     * 暗黙的ジオメトリ(ImplicitGeometry)の1つの配置を表します。
+     * 街路樹や道路標識のように同じ形状が繰り返される地物について、形状を頂点として展開する代わりに、
+     * 共有される形状 (Model のインスタンスプロトタイプ) とその配置の変換行列だけを保持します。
+     *
+     * 詳しくは Model::addInstancePrototype をご覧ください。
+     */
+    struct LIBPLATEAU_EXPORT MeshInstance {
+        /// 配置する形状の、 Model::getInstancePrototypeAt における番号です。
+        size_t prototype_index;
+
+        /**
+         * プロトタイプの頂点座標を、この配置での座標に変換する 4×4 の変換行列です。
+         * 行優先で格納し、頂点を列ベクトル (x, y, z, 1) として左から掛けます。
+         * 変換後の座標は、同じ設定で通常どおり抽出したメッシュの頂点と同じ座標系です。
+         */
+        std::array<double, 16> transform;
+
+        /// この配置を持つ都市オブジェクトの gml:id です。
+        std::string gml_id;
+
+        unsigned lod;
+
+        /// 変換行列を point に掛けた結果を返します。
+        TVec3d apply(const TVec3d& point) const {
+            return {
+                    transform[0] * point.x + transform[1] * point.y + transform[2] * point.z + transform[3],
+                    transform[4] * point.x + transform[5] * point.y + transform[6] * point.z + transform[7],
+                    transform[8] * point.x + transform[9] * point.y + transform[10] * point.z + transform[11]
+            };
+        }
+    };
+}
@@ -2,6 +2,7 @@
 
 #include <plateau/polygon_mesh/model.h>
 #include <plateau/polygon_mesh/node.h>
+#include <plateau/polygon_mesh/mesh_instance.h>
 #include <libplateau_api.h>
 
 namespace plateau::polygonMesh {
@@ -18,6 +19,8 @@ namespace plateau::polygonMesh {
      * Model が所有する Node の階層関係は、ゲームエンジン側でのゲームオブジェクトの階層関係に対応します。
      * Node が所有する Mesh は、そのゲームオブジェクトが保持する3Dメッシュに対応します。
      * Mesh が所有する SubMesh は、そのメッシュのサブメッシュ（テクスチャパスを含む）に対応します。
+     *
+     * また Model は、ノードの階層とは別に、インスタンス化して描画する形状(インスタンスプロトタイプ)とその配置(MeshInstance)の一覧を持ちます。
      */
     class LIBPLATEAU_EXPORT Model {
     public:
@@ -50,8 +53,25 @@ namespace plateau::polygonMesh {
         /// ルートノードから再帰的に探索することで、Modelに含まれるすべてのMeshを取得します。
         std::vector<Mesh*> getAllMeshes() const;
         void reserveRootNodes(size_t reserve_count);
+
+        /**
+         * 複数の配置で共有される形状 (インスタンスプロトタイプ) を追加し、その番号を返します。
+         * プロトタイプの頂点は、配置の基準点を原点とするローカル座標であり、座標軸と単位は抽出時の設定に従います。
+         * プロトタイプはノードの階層には含まれず、 getAllMeshes でも返されません。
+         */
+        size_t addInstancePrototype(std::unique_ptr<Mesh>&& mesh);
+        size_t getInstancePrototypeCount() const;
+        Mesh& getInstancePrototypeAt(size_t index);
+        const Mesh& getInstancePrototypeAt(size_t index) const;
+
+        /// プロトタイプの配置を追加します。 instance.prototype_index は追加済みのプロトタイプを指す必要があります。
+        void addMeshInstance(MeshInstance&& instance);
+        const std::vector<MeshInstance>& getMeshInstances() const;
+        std::vector<MeshInstance>& getMeshInstances();
     private:
         std::vector<Node> root_nodes_;
+        std::vector<std::unique_ptr<Mesh>> instance_prototypes_;
+        std::vector<MeshInstance> mesh_instances_;
     };
 
 }
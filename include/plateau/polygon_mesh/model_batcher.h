@@ -0,0 +1,36 @@
+#pragma once
+
+#include <plateau/polygon_mesh/model.h>
+#include <libplateau_api.h>
+
+namespace plateau::polygonMesh {
+
+    /**
+     * Model 内のノードをまたいでメッシュを結合し、マテリアルごとに少数の大きなメッシュにまとめます。
+     * 地域単位で抽出しても、メッシュが数百個になり、その多くが同じテクスチャ(結合後のアトラスなど)を参照していることがあります。
+     * その描画呼び出しの数を減らし、ゲームエンジンで静的なバッチとして扱える出力を作るためのものです。
+     *
+     * 結合はルートノード(通常は LOD ごとのノード)ごとに行い、異なる LOD のメッシュは混ざりません。
+     * 出力の各ルートノードの子には、1つのマテリアルだけを持つメッシュのノードが並びます。
+     * マテリアルの同一性は Mesh::addSubMesh と同じく SubMesh::isSameAs で判定します。
+     *
+     * 結合後も地物ごとの選択や非表示ができるよう、 UV4 の CityObjectIndex は結合後のメッシュで一意になるよう振り直し、
+     * CityObjectList にはそのメッシュに含まれる地物の gml:id を登録します。
+     * 同じ gml:id の地物は、元のメッシュが異なっても同じ CityObjectIndex になります。
+     * 1つの地物の三角形は元の順番のまま連続して並びます。
+     */
+    class LIBPLATEAU_EXPORT ModelBatcher {
+    public:
+        /// 16ビットのインデックスで表せる頂点数です。
+        static constexpr unsigned default_max_vertex_count = 65535;
+
+        /**
+         * src のメッシュをマテリアルごとに結合した Model を返します。 src は変更しません。
+         * 1つのメッシュの頂点数が max_vertex_count を超える場合は、三角形の区切りで複数のメッシュに分けます。
+         * max_vertex_count が 0 のときは頂点数を制限しません。
+         * Node の Transform は考慮しません。抽出直後のように Node の Transform が単位変換であることを前提とします。
+         * インスタンスプロトタイプと MeshInstance は結合せず、同じ番号のまま複製します。
+         */
+        static Model batch(const Model& src, unsigned max_vertex_count = default_max_vertex_count);
+    };
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <plateau/polygon_mesh/model.h>
+#include <plateau/geometry/geo_reference.h>
+#include <libplateau_api.h>
+
+namespace plateau::polygonMesh {
+
+    /**
+     * 抽出済みの Model の頂点座標を、別の GeoReference による座標に変換します。
+     * 抽出後に reference_point, mesh_axes, unit_scale だけを変えたい場合に、GMLファイルの読み直しと再抽出を不要にするためのものです。
+     *
+     * 基準点・座標軸・単位だけが異なる場合、変換前後の座標の関係はアフィン変換になるため、
+     * 変換行列を1回だけ求め、全頂点に同じ行列を掛けて変換します。
+     * 平面直角座標系の系番号が異なる場合はアフィン変換にならないため、頂点ごとに緯度・経度を経由して変換します。
+     */
+    class LIBPLATEAU_EXPORT ModelReprojector {
+    public:
+        /**
+         * model の全メッシュの頂点を、 from で抽出した座標から to で抽出した場合の座標に変換します。
+         * 座標軸の変換によってメッシュが裏返る場合は、三角形の頂点の順番も反転します。
+         * 地物ごとの三角形の範囲の表 (Mesh::getCityObjectRanges) を持つメッシュは、変換後の頂点で表を作り直します。
+         * HlodInfo を持つノードは、範囲を頂点と同じく変換し、表示を切り替える距離を単位の変換に合わせて拡大・縮小します。
+         * Node の Transform は変更しません。抽出直後のように Node の Transform が単位変換であることを前提とします。
+         * インスタンスプロトタイプの頂点には座標軸と単位の変換のみを行い、 MeshInstance の変換行列はそれに合わせて変換します。
+         * 系番号が異なる場合、配置の基準点は頂点と同じく緯度・経度を経由して変換しますが、系の間での向きの違いは考慮しません。
+         * thread_count は MeshExtractOptions::thread_count と同じ意味であり、メッシュ単位で並列に変換します。
+         */
+        static void reproject(Model& model, const geometry::GeoReference& from, const geometry::GeoReference& to,
+                              unsigned thread_count = 1);
+    };
+}
@@ -8,6 +8,22 @@
 #include "transform.h"
 
 namespace plateau::polygonMesh {
+    /**
+     * HLOD (階層的な LOD) の階層を構成するノードについて、距離による表示の切り替えに使う情報です。
+     * 詳しくは MeshExtractOptions::build_hlod をご覧ください。
+     */
+    struct LIBPLATEAU_EXPORT HlodInfo {
+        /// 子孫も含めたメッシュの頂点を囲む直方体です。座標はメッシュの頂点と同じです。
+        TVec3d bounds_min;
+        TVec3d bounds_max;
+
+        /**
+         * カメラから bounds までの距離がこの値より小さいときは、このノードのメッシュの代わりに子ノードを表示します。
+         * 単位はメッシュの頂点と同じです。子ノードのない葉では 0 です。
+         */
+        double switch_distance;
+    };
+
     /**
      * Model 以下の階層構造を構成するノードです。
      * Node は 0個以上の 子Node を持つため階層構造になります。
@@ -41,6 +57,10 @@ namespace plateau::polygonMesh {
         void setLocalRotation(Quaternion rotation);
         Transform getLocalTransform() const;
 
+        /// HLOD の階層を構成するノードであれば、その範囲と切り替えの距離を返します。そうでなければ std::nullopt です。
+        const std::optional<HlodInfo>& getHlodInfo() const;
+        void setHlodInfo(const HlodInfo& hlod_info);
+
         /// Meshが存在し、かつそのMeshに頂点が1つ以上あるときにtrueを返します。
         bool hasVertices() const;
 
@@ -79,6 +99,8 @@ namespace plateau::polygonMesh {
         /// FBX,GLTFエクスポート時にローカルなトランスフォームとして利用されます。
         Transform local_transform_;
 
+        std::optional<HlodInfo> hlod_info_;
+
         /**
          * ゲームエンジン上でNodeに相当するゲームオブジェクトがアクティブかどうかです。
          * GranularityConverterでのみ利用します。それ以外の用途では常にtrueになります。
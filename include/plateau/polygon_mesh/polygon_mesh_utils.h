@@ -1,6 +1,7 @@
 #pragma once
 
 #include <list>
+#include <optional>
 #include <citygml/vecs.hpp>
 #include <libplateau_api.h>
 
@@ -37,6 +38,12 @@ namespace plateau::polygonMesh {
          */
         static TVec3d cityObjPos(const citygml::CityObject& city_obj);
 
+        /**
+         * cityObjPos と同じ位置を返しますが、位置が分からない場合は例外ではなく std::nullopt を返します。
+         * 多数の CityObject の位置を求める場合は CityObjectBoundsCache の利用を検討してください。
+         */
+        static std::optional<TVec3d> findCityObjPos(const citygml::CityObject& city_obj);
+
         /**
          * cityObjのポリゴンであり、頂点数が1以上であるものを検索します。
          * 最初に見つかったポリゴンを返します。なければ nullptr を返します。
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <plateau/polygon_mesh/model.h>
+#include <plateau/geometry/geo_reference.h>
+#include <libplateau_api.h>
+
+namespace plateau::polygonMesh {
+
+    /**
+     * 地形の TIN を平面上の等間隔の格子で標本化した高さの表です。
+     * 標本点は平面直角座標系(抽出時の基準点・単位による座標)で、東方向に column_count 個、北方向に row_count 個並びます。
+     * 標本点の位置は基準点からの距離が cell_size の整数倍となるため、同じ基準点で抽出した隣り合う地形の格子は継ぎ目で一致します。
+     */
+    struct LIBPLATEAU_EXPORT ReliefHeightMap {
+        /// 東方向の標本点の数です。
+        size_t column_count = 0;
+        /// 北方向の標本点の数です。
+        size_t row_count = 0;
+        /// 列0・行0 の標本点(南西の角)の東方向・北方向の座標です。
+        double origin_east = 0;
+        double origin_north = 0;
+        /// 標本点の間隔です。単位はメッシュの頂点と同じです。
+        double cell_size = 0;
+
+        /**
+         * 各標本点の高さです。行優先で、南の行から順に、行の中では西から順に並びます。
+         * 値はメッシュの頂点と同じ単位・基準点による高さであり、 TIN の三角形に覆われていない標本点は NaN です。
+         */
+        std::vector<float> heights;
+
+        /// 各標本点の高さを与えた地物の、 city_object_gml_ids での番号です。高さのない標本点は -1 です。
+        std::vector<int> city_object_indices;
+        /// 高さを与えた地物の gml:id です。
+        std::vector<std::string> city_object_gml_ids;
+
+        bool hasHeight(size_t column, size_t row) const;
+        float getHeight(size_t column, size_t row) const;
+    };
+
+    /**
+     * 地形を一定の大きさに区切ったチャンクの1つです。
+     * chunk_x, chunk_y は、基準点を含むチャンクを (0, 0) として東・北に数えたチャンクの位置です。
+     */
+    struct LIBPLATEAU_EXPORT ReliefChunk {
+        long long chunk_x;
+        long long chunk_y;
+        std::unique_ptr<Mesh> mesh;
+    };
+
+    /**
+     * 地形 (PredefinedCityModelPackage::Relief) の不規則な TIN を、平面上の等間隔の格子による高さの表(ハイトマップ)に変換します。
+     * GMLの TIN は三角形の大きさや密度が不揃いで頂点数が多く、描画にもテクスチャ結合にも時間がかかります。
+     * 格子にすることでゲームエンジンの地形機能にそのまま渡せる形になり、多くの場合は頂点数も大きく減ります。
+     *
+     * 標本点の高さは、真上から見てその点を含む三角形の平面で補間します。複数の三角形が含む場合は最も高い値とします。
+     */
+    class LIBPLATEAU_EXPORT ReliefRasterizer {
+    public:
+        /**
+         * node 以下のすべてのメッシュの三角形を、 cell_size メートル間隔の格子で標本化します。
+         * geo_reference は抽出時と同じものである必要があり、座標軸と単位の解釈に使います。
+         * Node の Transform は考慮しません。抽出直後のように Node の Transform が単位変換であることを前提とします。
+         * cell_size が正でない場合は std::invalid_argument を投げます。
+         */
+        static ReliefHeightMap rasterize(const Node& node, const geometry::GeoReference& geo_reference, double cell_size);
+
+        /**
+         * height_map の標本点を頂点とする格子状のメッシュを作ります。
+         * 頂点は height_map.heights と同じ順番で並び、列 c・行 r の頂点の番号は r * column_count + c です。
+         * 高さのない標本点も頂点として含め(高さは最も低い標本点と同じにします)、4隅のいずれかの高さがない格子は三角形を作りません。
+         * UV1 は格子全体を 0 から 1 に対応させ、 UV4 と CityObjectList には高さを与えた地物を設定します。
+         * 高さのある標本点がなければ nullptr を返します。
+         */
+        static std::unique_ptr<Mesh> createGridMesh(const ReliefHeightMap& height_map, const geometry::GeoReference& geo_reference);
+
+        /**
+         * height_map を chunk_size メートル四方のチャンクごとの格子状のメッシュに分けます。
+         * チャンクの境界は基準点から chunk_size の整数倍(標本点の間隔に丸めます)の位置にあり、抽出範囲によりません。
+         * そのため別々に抽出した地形でも境界が一致し、ゲームエンジン側でチャンクごとに読み込み・破棄できます。
+         * 隣り合うチャンクは境界の標本点を共有します。
+         *
+         * skirt_height が正のとき、各チャンクの外周に沿って、外周の頂点から skirt_height メートル真下に下ろした垂直な面(スカート)を加えます。
+         * 隣り合うチャンクを異なる解像度で簡略化したり読み込んだりしても、継ぎ目の隙間がスカートで隠れます。
+         * UV1 はチャンクごとに 0 から 1 に対応させ、スカートの頂点の UV1, UV4 は真上の頂点と同じです。
+         * 三角形のないチャンクは返しません。 chunk_size が正でない場合は std::invalid_argument を投げます。
+         */
+        static std::vector<ReliefChunk> createChunkMeshes(const ReliefHeightMap& height_map, const geometry::GeoReference& geo_reference,
+                                                          double chunk_size, double skirt_height);
+
+        /**
+         * src の各ルートノード(通常は LOD ごとのノード)について、その下の地形を格子状のメッシュに置き換えた Model を返します。
+         * chunk_size が 0 のときはルートノードごとに1つのメッシュ "relief_grid" とし、
+         * 正のときは createChunkMeshes で分けたチャンクごとのメッシュ "relief_chunk_{chunk_x}_{chunk_y}" とします。
+         * src は変更しません。元の TIN のテクスチャは引き継ぎません。
+         */
+        static Model rasterizeModel(const Model& src, const geometry::GeoReference& geo_reference, double cell_size,
+                                    double chunk_size = 0, double skirt_height = 0);
+    };
+}
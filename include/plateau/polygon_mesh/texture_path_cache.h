@@ -0,0 +1,61 @@
+#pragma once
+
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <libplateau_api.h>
+
+namespace citygml {
+    class Texture;
+    class CityModel;
+}
+
+namespace plateau::polygonMesh {
+
+    /**
+     * citygml::Texture の URL を絶対パスに変換した結果を、メッシュ抽出1回の間キャッシュします。
+     * 同じテクスチャは多数のポリゴンから参照されるため、ポリゴンごとに std::filesystem でパスを組み立てる代わりに
+     * テクスチャごとに1回だけ変換し、以降は同じ文字列を返します。
+     * なお SubMesh はテクスチャパスを自身の std::string として保持するため、返した文字列は SubMesh ごとにコピーされます。
+     * 省けるのはパスの組み立てと絶対パスへの変換であり、SubMesh ごとの文字列の確保ではありません。
+     *
+     * 相対パスの基準となる GMLファイルのパスはコンストラクタで指定し、1つのキャッシュは1つの GMLファイルに対して利用します。
+     * また、ポリゴンのテクスチャとマテリアルを取得するテーマも GMLファイルごとに1回だけ決めて保持します。
+     * 複数スレッドから同時に利用できます。
+     */
+    class LIBPLATEAU_EXPORT TexturePathCache {
+    public:
+        /// テーマは rgbTexture とします。
+        explicit TexturePathCache(std::string gml_path);
+
+        /// city_model の GMLファイルに対するキャッシュを作り、 city_model のテーマ一覧からテーマを決めます。
+        explicit TexturePathCache(const citygml::CityModel& city_model);
+
+        TexturePathCache(const TexturePathCache&) = delete;
+        TexturePathCache& operator=(const TexturePathCache&) = delete;
+
+        const std::string& getGmlPath() const;
+
+        /**
+         * ポリゴンのテクスチャ・UV・マテリアルを取得するテーマ名です。
+         * GMLファイルに rgbTexture のテーマがあればそれを、なければテーマ一覧の最初のものを使います。
+         * ポリゴンごとにテーマ一覧を取得して探す代わりに、この名前で直接引きます。
+         */
+        const std::string& getTheme() const;
+
+        /**
+         * texture の URL を、相対パスであれば GMLファイルのあるディレクトリを基準に絶対パスに変換して返します。
+         * 戻り値の参照は、このキャッシュが破棄されるまで有効です。
+         */
+        const std::string& getAbsolutePath(const citygml::Texture& texture);
+
+        /// テクスチャの URL を、相対パスであれば gml_path のあるディレクトリを基準に絶対パスに変換します。
+        static std::string toAbsolutePath(const std::string& texture_url, const std::string& gml_path);
+
+    private:
+        std::string gml_path_;
+        std::string theme_;
+        std::shared_mutex mutex_;
+        std::unordered_map<const citygml::Texture*, std::string> absolute_paths_;
+    };
+}
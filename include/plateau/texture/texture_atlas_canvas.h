@@ -3,6 +3,7 @@
 #include "texture_image_base.h"
 #include "atlas_info.h"
 #include "atlas_container.h"
+#include <plateau/polygon_mesh/extract_session.h>
 #include <filesystem>
 
 namespace plateau::texture{
@@ -16,7 +17,11 @@ namespace plateau::texture{
         }
 
 
-        void setDefaultSaveFilePathIfEmpty(const std::string& original_file_path);
+        /**
+         * 保存先が未設定であれば、 original_file_path と同じフォルダの packed_image_(元のファイル名)_(番号).png を保存先にします。
+         * 番号は、ファイルが存在せず session 等で予約されていないものを選びます。
+         */
+        void setDefaultSaveFilePathIfEmpty(const std::string& original_file_path, polygonMesh::ExtractSession& session);
         void setSaveFilePath(const std::filesystem::path& path);
         const std::string& getSaveFilePath() const;
 
@@ -19,7 +19,14 @@ namespace plateau::texture {
     class LIBPLATEAU_EXPORT TexturePacker {
     public:
 
-        explicit TexturePacker(size_t width, size_t height, const int internal_canvas_count = 8);
+        static constexpr int default_internal_canvas_count = 8;
+
+        /**
+         * session は結合後の画像のファイル名を予約するために利用します。
+         * nullptr の場合、この TexturePacker が破棄されるまで有効なセッションを内部で作ります。
+         */
+        explicit TexturePacker(size_t width, size_t height, const int internal_canvas_count = default_internal_canvas_count,
+                               plateau::polygonMesh::ExtractSession* session = nullptr);
 
         void process(plateau::polygonMesh::Model& model);
         void processNodeRecursive(const plateau::polygonMesh::Node& node);
@@ -33,6 +40,8 @@ namespace plateau::texture {
         std::vector<std::shared_ptr<TextureAtlasCanvas>> canvases_;
         size_t canvas_width_;
         size_t canvas_height_;
-
+        plateau::polygonMesh::ExtractSession* session_;
+        /// session_ が渡されなかった場合に、このクラスで作るセッションです。
+        std::unique_ptr<plateau::polygonMesh::ExtractSession> own_session_;
     };
 } // namespace plateau::texture
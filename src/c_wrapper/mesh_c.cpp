@@ -1,6 +1,7 @@
 #include <plateau/polygon_mesh/mesh.h>
 #include "libplateau_c.h"
 #include <cassert>
+#include <algorithm>
 using namespace citygml;
 using namespace libplateau;
 using namespace plateau::polygonMesh;
@@ -90,6 +91,92 @@ extern "C" {
     }
 
 
+    LIBPLATEAU_C_EXPORT APIResult LIBPLATEAU_C_API plateau_mesh_coalesce_sub_meshes(
+            Mesh* const mesh
+    ) {
+        API_TRY {
+            mesh->coalesceSubMeshes();
+            return APIResult::Success;
+        }
+        API_CATCH
+        return APIResult::ErrorUnknown;
+    }
+
+
+    LIBPLATEAU_C_EXPORT APIResult LIBPLATEAU_C_API plateau_mesh_build_city_object_ranges(
+            Mesh* const mesh
+    ) {
+        API_TRY {
+            mesh->buildCityObjectRanges();
+            return APIResult::Success;
+        }
+        API_CATCH
+        return APIResult::ErrorUnknown;
+    }
+
+    DLL_VALUE_FUNC(plateau_mesh_get_city_object_range_count,
+                   Mesh,
+                   int,
+                   handle->getCityObjectRanges().size())
+
+    /**
+     * 地物ごとの三角形の範囲の表を out_ranges にまとめてコピーします。
+     * out_ranges は plateau_mesh_get_city_object_range_count の数だけの要素を確保しておく必要があります。
+     */
+    LIBPLATEAU_C_EXPORT APIResult LIBPLATEAU_C_API plateau_mesh_get_city_object_ranges(
+            const Mesh* const mesh,
+            CityObjectRange* const out_ranges
+    ) {
+        API_TRY {
+            const auto& ranges = mesh->getCityObjectRanges();
+            std::copy(ranges.begin(), ranges.end(), out_ranges);
+            return APIResult::Success;
+        }
+        API_CATCH
+        return APIResult::ErrorUnknown;
+    }
+
+    /**
+     * plateau_mesh_get_city_object_ranges の表のうち、 city_object_index の範囲が並ぶ位置を返します。
+     * 該当する範囲がなければ out_count は 0 です。
+     */
+    LIBPLATEAU_C_EXPORT APIResult LIBPLATEAU_C_API plateau_mesh_find_city_object_ranges(
+            const Mesh* const mesh,
+            const CityObjectIndex city_object_index,
+            int* const out_first,
+            int* const out_count
+    ) {
+        API_TRY {
+            const auto found = mesh->findCityObjectRanges(city_object_index);
+            *out_first = static_cast<int>(found.first);
+            *out_count = static_cast<int>(found.second);
+            return APIResult::Success;
+        }
+        API_CATCH
+        return APIResult::ErrorUnknown;
+    }
+
+    /**
+     * plateau_mesh_get_city_object_ranges の表のうち、主要地物 primary_index とその最小地物の範囲が並ぶ位置を返します。
+     * 該当する範囲がなければ out_count は 0 です。
+     */
+    LIBPLATEAU_C_EXPORT APIResult LIBPLATEAU_C_API plateau_mesh_find_primary_city_object_ranges(
+            const Mesh* const mesh,
+            const int primary_index,
+            int* const out_first,
+            int* const out_count
+    ) {
+        API_TRY {
+            const auto found = mesh->findPrimaryCityObjectRanges(primary_index);
+            *out_first = static_cast<int>(found.first);
+            *out_count = static_cast<int>(found.second);
+            return APIResult::Success;
+        }
+        API_CATCH
+        return APIResult::ErrorUnknown;
+    }
+
+
     DLL_VALUE_FUNC(plateau_mesh_get_vertex_color_count,
                    Mesh,
                    int,
@@ -6,6 +6,12 @@
 using namespace libplateau;
 using namespace plateau::polygonMesh;
 
+/// 抽出が終わったノードを受け取るコールバックです。 node はコールバックの中でのみ有効です。
+typedef void(* ExtractedNodeCallbackFuncPtr)(unsigned lod, const Node* node);
+
+/// 抽出の進捗を受け取るコールバックです。 stage は ExtractStage の値であり、各引数の意味は ExtractProgress::Callback と同じです。
+typedef void(* ExtractProgressCallbackFuncPtr)(int stage, unsigned lod, unsigned long long processed, unsigned long long total);
+
 extern "C"{
 
     /**
@@ -43,4 +49,103 @@ extern "C"{
         API_CATCH;
         return APIResult::ErrorUnknown;
     }
+
+    /**
+     * MeshExtractor::extractInExtentsStreaming して、構築が終わったノードを1つずつ callback に渡します。
+     * 渡したノードはコールバックから戻った後に破棄されるため、必要な情報はコールバックの中で読み取ってください。
+     * progress は nullptr でも構いません。 progress->cancel() によって中断したときは APIResult::ErrorCancelled を返します。
+     */
+    LIBPLATEAU_C_EXPORT APIResult LIBPLATEAU_C_API plateau_mesh_extractor_extract_in_extents_streaming(
+            const CityModelHandle* const city_model_handle,
+            const MeshExtractOptions options,
+            const std::vector<plateau::geometry::Extent>* extents,
+            const ExtractedNodeCallbackFuncPtr callback,
+            const ExtractProgress* const progress) {
+        API_TRY{
+            MeshExtractor::extractInExtentsStreaming(
+                    city_model_handle->getCityModel(), options, *extents,
+                    [callback](const unsigned lod, Node&& node) {
+                        callback(lod, &node);
+                    }, progress);
+            return APIResult::Success;
+        }
+        catch (const ExtractCancelledException&) {
+            return APIResult::ErrorCancelled;
+        }
+        API_CATCH;
+        return APIResult::ErrorUnknown;
+    }
+
+    /**
+     * 進捗を callback に通知する ExtractProgress を生成します。 callback が nullptr のときは通知しません。
+     * delete はDLL利用者の責任です。
+     */
+    LIBPLATEAU_C_EXPORT APIResult LIBPLATEAU_C_API plateau_create_extract_progress(
+            ExtractProgress** const out_progress,
+            const ExtractProgressCallbackFuncPtr callback) {
+        API_TRY{
+            if (callback == nullptr) {
+                *out_progress = new ExtractProgress();
+                return APIResult::Success;
+            }
+            *out_progress = new ExtractProgress(
+                    [callback](const ExtractStage stage, const unsigned lod, const size_t processed, const size_t total) {
+                        callback(static_cast<int>(stage), lod, processed, total);
+                    });
+            return APIResult::Success;
+        }
+        API_CATCH;
+        return APIResult::ErrorUnknown;
+    }
+
+    DLL_DELETE_FUNC(plateau_delete_extract_progress,
+                    ExtractProgress)
+
+    /**
+     * 抽出の中断を要求します。抽出中の別スレッドから呼ぶことができます。
+     */
+    DLL_1_ARG_FUNC(plateau_extract_progress_cancel,
+                   ExtractProgress* const handle,
+                   handle->cancel())
+
+    /**
+     * plateau_mesh_extractor_extract の進捗通知と中断に対応した版です。
+     * progress->cancel() によって中断したときは APIResult::ErrorCancelled を返します。
+     */
+    LIBPLATEAU_C_EXPORT APIResult LIBPLATEAU_C_API plateau_mesh_extractor_extract_with_progress(
+            const CityModelHandle* const city_model_handle,
+            const MeshExtractOptions options,
+            const ExtractProgress* const progress,
+            Model* const out_model) {
+        API_TRY{
+            MeshExtractor::extract(*out_model, city_model_handle->getCityModel(), options, progress);
+            return APIResult::Success;
+        }
+        catch (const ExtractCancelledException&) {
+            return APIResult::ErrorCancelled;
+        }
+        API_CATCH;
+        return APIResult::ErrorUnknown;
+    }
+
+    /**
+     * plateau_mesh_extractor_extract_in_extents の進捗通知と中断に対応した版です。
+     * progress->cancel() によって中断したときは APIResult::ErrorCancelled を返します。
+     */
+    LIBPLATEAU_C_EXPORT APIResult LIBPLATEAU_C_API plateau_mesh_extractor_extract_in_extents_with_progress(
+            const CityModelHandle* const city_model_handle,
+            const MeshExtractOptions options,
+            const std::vector<plateau::geometry::Extent>* extents,
+            const ExtractProgress* const progress,
+            Model* const out_model) {
+        API_TRY{
+            MeshExtractor::extractInExtents(*out_model, city_model_handle->getCityModel(), options, *extents, progress);
+            return APIResult::Success;
+        }
+        catch (const ExtractCancelledException&) {
+            return APIResult::ErrorCancelled;
+        }
+        API_CATCH;
+        return APIResult::ErrorUnknown;
+    }
 }
@@ -1,7 +1,12 @@
 #include "libplateau_c.h"
+#include <algorithm>
 #include <plateau/polygon_mesh/model.h>
+#include <plateau/polygon_mesh/model_reprojector.h>
+#include <plateau/polygon_mesh/model_batcher.h>
+#include <plateau/polygon_mesh/relief_rasterizer.h>
 using namespace libplateau;
 using namespace plateau::polygonMesh;
+using namespace plateau::geometry;
 extern "C" {
 
     DLL_CREATE_FUNC(plateau_create_model,
@@ -33,4 +38,90 @@ extern "C" {
         } API_CATCH;
         return APIResult::ErrorUnknown;
     }
+
+    /// model の頂点を、 from で抽出した座標から to で抽出した場合の座標に変換します。
+    LIBPLATEAU_C_EXPORT APIResult LIBPLATEAU_C_API plateau_model_reproject(
+            Model* model,
+            const GeoReference* from,
+            const GeoReference* to,
+            unsigned thread_count
+    ) {
+        API_TRY {
+            ModelReprojector::reproject(*model, *from, *to, thread_count);
+            return APIResult::Success;
+        } API_CATCH;
+        return APIResult::ErrorUnknown;
+    }
+
+    DLL_VALUE_FUNC(plateau_model_get_instance_prototype_count,
+                   Model,
+                   int,
+                   handle->getInstancePrototypeCount())
+
+    DLL_PTR_FUNC_WITH_INDEX_CHECK(plateau_model_get_instance_prototype_at_index,
+                                  Model,
+                                  Mesh,
+                                  &handle->getInstancePrototypeAt(index),
+                                  index < 0 || index >= handle->getInstancePrototypeCount())
+
+    DLL_VALUE_FUNC(plateau_model_get_mesh_instance_count,
+                   Model,
+                   int,
+                   handle->getMeshInstances().size())
+
+    /// index 番目の MeshInstance のプロトタイプ番号と LOD を書き込み、 out_transform に 16個の要素からなる変換行列を書き込みます。
+    LIBPLATEAU_C_EXPORT APIResult LIBPLATEAU_C_API plateau_model_get_mesh_instance_at_index(
+            const Model* const model,
+            const int index,
+            int* const out_prototype_index,
+            int* const out_lod,
+            double* const out_transform
+    ) {
+        API_TRY {
+            const auto& instances = model->getMeshInstances();
+            if (index < 0 || index >= instances.size()) return APIResult::ErrorIndexOutOfBounds;
+            const auto& instance = instances.at(index);
+            *out_prototype_index = static_cast<int>(instance.prototype_index);
+            *out_lod = static_cast<int>(instance.lod);
+            std::copy(instance.transform.begin(), instance.transform.end(), out_transform);
+            return APIResult::Success;
+        } API_CATCH;
+        return APIResult::ErrorUnknown;
+    }
+
+    DLL_STRING_PTR_FUNC(plateau_model_get_mesh_instance_gml_id,
+                        const Model,
+                        handle->getMeshInstances().at(index).gml_id,
+                        , int index)
+
+    /// src_model の地形の TIN を、 cell_size メートル間隔の格子状のメッシュに置き換えた Model を新しく作ります。
+    /// chunk_size が正のときは、その大きさのチャンクごとのメッシュに分け、外周に skirt_height メートルのスカートを付けます。
+    LIBPLATEAU_C_EXPORT APIResult LIBPLATEAU_C_API plateau_model_rasterize_relief(
+            const Model* const src_model,
+            const GeoReference* const geo_reference,
+            Model** out_model_ptr,
+            double cell_size,
+            double chunk_size,
+            double skirt_height
+    ) {
+        API_TRY {
+            *out_model_ptr = new Model(ReliefRasterizer::rasterizeModel(*src_model, *geo_reference, cell_size,
+                                                                        chunk_size, skirt_height));
+            return APIResult::Success;
+        } API_CATCH;
+        return APIResult::ErrorUnknown;
+    }
+
+    /// src_model のメッシュをマテリアルごとに結合した Model を新しく作ります。
+    LIBPLATEAU_C_EXPORT APIResult LIBPLATEAU_C_API plateau_model_batch(
+            const Model* const src_model,
+            Model** out_model_ptr,
+            unsigned max_vertex_count
+    ) {
+        API_TRY {
+            *out_model_ptr = new Model(ModelBatcher::batch(*src_model, max_vertex_count));
+            return APIResult::Success;
+        } API_CATCH;
+        return APIResult::ErrorUnknown;
+    }
 }
@@ -88,6 +88,24 @@ extern "C" {
         return APIResult::ErrorUnknown;
     }
 
+    /// Node が HLOD の階層を構成するノードであれば、その範囲と切り替えの距離を書き込みます。そうでなければ ErrorValueNotFound を返します。
+    LIBPLATEAU_C_EXPORT APIResult LIBPLATEAU_C_API plateau_node_get_hlod_info(
+            const Node* const node,
+            TVec3d* const out_bounds_min,
+            TVec3d* const out_bounds_max,
+            double* const out_switch_distance
+    ) {
+        API_TRY {
+            const auto& hlod_info = node->getHlodInfo();
+            if (!hlod_info.has_value()) return APIResult::ErrorValueNotFound;
+            *out_bounds_min = hlod_info->bounds_min;
+            *out_bounds_max = hlod_info->bounds_max;
+            *out_switch_distance = hlod_info->switch_distance;
+            return APIResult::Success;
+        } API_CATCH;
+        return APIResult::ErrorUnknown;
+    }
+
     /**
      * Node に Mesh をセットします。
      * 取扱注意:
@@ -0,0 +1,62 @@
+#include "libplateau_c.h"
+#include <plateau/polygon_mesh/relief_rasterizer.h>
+#include <algorithm>
+using namespace libplateau;
+using namespace plateau::polygonMesh;
+using namespace plateau::geometry;
+extern "C" {
+
+    /// node 以下の地形を cell_size メートル間隔の格子で標本化した ReliefHeightMap を新しく作ります。
+    LIBPLATEAU_C_EXPORT APIResult LIBPLATEAU_C_API plateau_relief_rasterizer_rasterize(
+            const Node* const node,
+            const GeoReference* const geo_reference,
+            double cell_size,
+            ReliefHeightMap** out_height_map_ptr
+    ) {
+        API_TRY {
+            *out_height_map_ptr = new ReliefHeightMap(ReliefRasterizer::rasterize(*node, *geo_reference, cell_size));
+            return APIResult::Success;
+        } API_CATCH;
+        return APIResult::ErrorUnknown;
+    }
+
+    DLL_DELETE_FUNC(plateau_delete_relief_height_map,
+                    ReliefHeightMap)
+
+    DLL_VALUE_FUNC(plateau_relief_height_map_get_column_count,
+                   ReliefHeightMap,
+                   int,
+                   handle->column_count)
+
+    DLL_VALUE_FUNC(plateau_relief_height_map_get_row_count,
+                   ReliefHeightMap,
+                   int,
+                   handle->row_count)
+
+    DLL_VALUE_FUNC(plateau_relief_height_map_get_origin_east,
+                   ReliefHeightMap,
+                   double,
+                   handle->origin_east)
+
+    DLL_VALUE_FUNC(plateau_relief_height_map_get_origin_north,
+                   ReliefHeightMap,
+                   double,
+                   handle->origin_north)
+
+    DLL_VALUE_FUNC(plateau_relief_height_map_get_cell_size,
+                   ReliefHeightMap,
+                   double,
+                   handle->cell_size)
+
+    /// out_heights に column_count × row_count 個の高さを書き込みます。
+    LIBPLATEAU_C_EXPORT APIResult LIBPLATEAU_C_API plateau_relief_height_map_get_heights(
+            const ReliefHeightMap* const height_map,
+            float* const out_heights
+    ) {
+        API_TRY {
+            std::copy(height_map->heights.begin(), height_map->heights.end(), out_heights);
+            return APIResult::Success;
+        } API_CATCH;
+        return APIResult::ErrorUnknown;
+    }
+}
@@ -0,0 +1,124 @@
+#include <plateau/geometry/extent_index.h>
+#include <algorithm>
+#include <limits>
+
+namespace plateau::geometry {
+
+    namespace {
+        std::vector<double> sortedUnique(std::vector<double>&& values) {
+            std::sort(values.begin(), values.end());
+            values.erase(std::unique(values.begin(), values.end()), values.end());
+            return std::move(values);
+        }
+
+        /// 境界値 value そのものに対応する要素区間の番号を返します。 value は breakpoints に含まれている必要があります。
+        size_t segmentOfBreakpoint(const std::vector<double>& breakpoints, const double value) {
+            const auto it = std::lower_bound(breakpoints.begin(), breakpoints.end(), value);
+            return static_cast<size_t>(it - breakpoints.begin()) * 2;
+        }
+
+        Extent emptyBounds() {
+            constexpr double double_max = std::numeric_limits<double>::max();
+            constexpr double double_min = std::numeric_limits<double>::lowest();
+            return {GeoCoordinate(double_max, double_max, double_max), GeoCoordinate(double_min, double_min, double_min)};
+        }
+    }
+
+    ExtentIndex::ExtentIndex(const std::vector<Extent>& extents) :
+        lon_segment_count_(0),
+        bounds_(emptyBounds()) {
+
+        if (extents.empty()) return;
+
+        std::vector<double> lats;
+        std::vector<double> lons;
+        lats.reserve(extents.size() * 2);
+        lons.reserve(extents.size() * 2);
+        for (const auto& extent : extents) {
+            lats.push_back(extent.min.latitude);
+            lats.push_back(extent.max.latitude);
+            lons.push_back(extent.min.longitude);
+            lons.push_back(extent.max.longitude);
+            bounds_.min.latitude = std::min(bounds_.min.latitude, extent.min.latitude);
+            bounds_.min.longitude = std::min(bounds_.min.longitude, extent.min.longitude);
+            bounds_.max.latitude = std::max(bounds_.max.latitude, extent.max.latitude);
+            bounds_.max.longitude = std::max(bounds_.max.longitude, extent.max.longitude);
+        }
+        lat_breakpoints_ = sortedUnique(std::move(lats));
+        lon_breakpoints_ = sortedUnique(std::move(lons));
+
+        const auto lat_segment_count = lat_breakpoints_.size() * 2 - 1;
+        lon_segment_count_ = lon_breakpoints_.size() * 2 - 1;
+        first_extent_indices_.assign(lat_segment_count * lon_segment_count_, -1);
+
+        // 各 Extent が覆う要素区間に、それを覆う最初の Extent の番号を記録します。 min > max の Extent は何も含みません。
+        // 後ろから順に記録することで、複数の Extent が覆う区間には最も番号の小さいものが残ります。
+        for (auto i = static_cast<int>(extents.size()) - 1; i >= 0; i--) {
+            const auto& extent = extents.at(i);
+            if (extent.min.latitude > extent.max.latitude || extent.min.longitude > extent.max.longitude) continue;
+            const auto lat_begin = segmentOfBreakpoint(lat_breakpoints_, extent.min.latitude);
+            const auto lat_end = segmentOfBreakpoint(lat_breakpoints_, extent.max.latitude);
+            const auto lon_begin = segmentOfBreakpoint(lon_breakpoints_, extent.min.longitude);
+            const auto lon_end = segmentOfBreakpoint(lon_breakpoints_, extent.max.longitude);
+            for (auto lat = lat_begin; lat <= lat_end; lat++) {
+                for (auto lon = lon_begin; lon <= lon_end; lon++) {
+                    first_extent_indices_[lat * lon_segment_count_ + lon] = i;
+                }
+            }
+        }
+    }
+
+    bool ExtentIndex::contains(const TVec3d& lat_lon) const {
+        return find(lat_lon) >= 0;
+    }
+
+    int ExtentIndex::find(const TVec3d& lat_lon) const {
+        const auto lat = segmentOf(lat_breakpoints_, lat_lon.x);
+        if (lat < 0) return -1;
+        const auto lon = segmentOf(lon_breakpoints_, lat_lon.y);
+        if (lon < 0) return -1;
+        return first_extent_indices_[static_cast<size_t>(lat) * lon_segment_count_ + static_cast<size_t>(lon)];
+    }
+
+    bool ExtentIndex::mayIntersect(const TVec3d& min_lat_lon, const TVec3d& max_lat_lon) const {
+        return
+                min_lat_lon.x <= bounds_.max.latitude && max_lat_lon.x >= bounds_.min.latitude &&
+                min_lat_lon.y <= bounds_.max.longitude && max_lat_lon.y >= bounds_.min.longitude;
+    }
+
+    bool ExtentIndex::mayIntersect(const std::vector<TVec3d>& vertices) const {
+        if (vertices.empty() || empty()) return false;
+
+        auto min = vertices.at(0);
+        auto max = vertices.at(0);
+        for (const auto& vertex : vertices) {
+            min.x = std::min(min.x, vertex.x);
+            min.y = std::min(min.y, vertex.y);
+            max.x = std::max(max.x, vertex.x);
+            max.y = std::max(max.y, vertex.y);
+        }
+        return mayIntersect(min, max);
+    }
+
+    bool ExtentIndex::containsAny(const std::vector<TVec3d>& vertices) const {
+        // 外接矩形で大まかに判定し、明らかに範囲外であれば各頂点を調べません。
+        if (!mayIntersect(vertices)) return false;
+
+        return std::any_of(vertices.begin(), vertices.end(), [this](const TVec3d& vertex) {
+            return contains(vertex);
+        });
+    }
+
+    bool ExtentIndex::empty() const {
+        return first_extent_indices_.empty();
+    }
+
+    long long ExtentIndex::segmentOf(const std::vector<double>& breakpoints, const double value) {
+        const auto it = std::lower_bound(breakpoints.begin(), breakpoints.end(), value);
+        if (it == breakpoints.end()) return -1;
+        const auto k = static_cast<long long>(it - breakpoints.begin());
+        if (*it == value) return k * 2;
+        if (k == 0) return -1;
+        return k * 2 - 1;
+    }
+}
@@ -53,13 +53,10 @@ namespace plateau::geometry {
     }
 
     bool Extent::contains(const CityObject& city_obj, bool ignore_height) const{
-        try{
-            auto pos = PolygonMeshUtils::cityObjPos(city_obj);
-            return contains(pos, ignore_height);
-        }catch(std::invalid_argument& e){
-            // 位置不明は false 扱いとします。
-            return false;
-        }
+        const auto pos = PolygonMeshUtils::findCityObjPos(city_obj);
+        // 位置不明は false 扱いとします。
+        if (!pos.has_value()) return false;
+        return contains(pos.value(), ignore_height);
     }
 
     bool Extent::intersects2D(const Extent& other) const {
@@ -1,8 +1,15 @@
 #include "area_mesh_factory.h"
+#include "city_object_filter.h"
 
 #include <plateau/polygon_mesh/primary_city_object_types.h>
 #include <plateau/polygon_mesh/mesh_factory.h>
 #include <plateau/polygon_mesh/polygon_mesh_utils.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <optional>
+#include <atomic>
+#include <unordered_map>
 
 namespace {
     using namespace plateau;
@@ -14,12 +21,15 @@ namespace {
     using GridIDToObjectsMap = std::map<unsigned, std::list<const citygml::CityObject*>>;
     using GroupIDToObjectsMap = GridIDToObjectsMap;
 
-    bool shouldSkipCityObj(const citygml::CityObject& city_obj, const MeshExtractOptions& options, const std::vector<geometry::Extent>& extents) {
+    /// 位置が position である CityObject を範囲外として除外すべきかどうかを返します。位置不明のものは範囲外とみなします。
+    bool shouldSkipCityObj(const std::optional<TVec3d>& position, const MeshExtractOptions& options, const std::vector<geometry::Extent>& extents) {
         if (!options.exclude_city_object_outside_extent)
             return false;
+        if (!position.has_value())
+            return true;
 
         for (const auto& extent : extents) {
-            if (extent.contains(city_obj))
+            if (extent.contains(position.value()))
                 return false;
         }
 
@@ -61,20 +71,244 @@ namespace {
      * city_objects の各CityObjectが位置の上でどのグリッドに属するかを求め、gridIdToObjsMapに追加することでグリッド分けします。
      * また ImportID を割り振ります。
      * extentの範囲外のものは除外します（除外する設定の場合）。
+     * 型や属性による絞り込みの条件に合わないものと、ポリゴンがなく位置が不明なものも除外します。
+     * 位置は bounds_cache から求めます。
      */
     GridIDToObjectsMap classifyCityObjectsToGrid(const citygml::ConstCityObjects& city_objects, const citygml::Envelope& city_envelope,
-                                           const MeshExtractOptions& options, const std::vector<plateau::geometry::Extent>& extents) {
+                                           const MeshExtractOptions& options, const std::vector<plateau::geometry::Extent>& extents,
+                                           const CityObjectBoundsCache& bounds_cache) {
         auto grid_id_to_objects_map = initGridIDToObjectsMap(options.grid_count_of_side, options.grid_count_of_side);
+        const CityObjectFilter filter(options);
         for (const auto co : city_objects) {
-            // 範囲外、または位置不明ならスキップします（スキップする設定の場合）。
-            if (shouldSkipCityObj(*co, options, extents))
+            // 型や属性の条件に合わなければ、位置を計算せずにスキップします。
+            if (!filter.passes(*co))
+                continue;
+            // 範囲外ならスキップします（スキップする設定の場合）。
+            const auto position = bounds_cache.findPosition(*co);
+            if (shouldSkipCityObj(position, options, extents))
+                continue;
+            // 位置不明の CityObject はポリゴンを持たず、メッシュに寄与しないためスキップします。
+            if (!position.has_value())
                 continue;
 
-            const int grid_id = getGridId(city_envelope, PolygonMeshUtils::cityObjPos(*co), options.grid_count_of_side, options.grid_count_of_side);
+            const int grid_id = getGridId(city_envelope, position.value(), options.grid_count_of_side, options.grid_count_of_side);
             grid_id_to_objects_map.at(grid_id).push_back(co);
         }
         return grid_id_to_objects_map;
     }
+
+    /**
+     * グリッドを4分割することを繰り返す回数の上限です。
+     * 多数の CityObject が同じ位置にある場合でも分割が止まるようにします。
+     */
+    constexpr int max_grid_subdivision_depth = 8;
+
+    /// グリッドの範囲です。 x, y は CityModel の Envelope と同じ座標系です。
+    struct GridBounds {
+        double min_x;
+        double min_y;
+        double max_x;
+        double max_y;
+    };
+
+    /// 主要地物について、そのLODでメッシュに含まれるポリゴンの三角形数を索引から求めます。
+    long long countTrianglesInPrimaryObject(const citygml::CityObject& primary_object, const unsigned lod,
+                                            const CityObjectPolygonIndex& polygon_index) {
+        long long index_count = 0;
+        if (MeshExtractor::shouldContainPrimaryMesh(lod, primary_object)) {
+            const auto lod_polygons = polygon_index.find(primary_object, lod);
+            if (lod_polygons != nullptr) index_count += lod_polygons->index_count;
+        }
+        if (lod >= 2) {
+            for (const auto atomic_object : PolygonMeshUtils::getChildCityObjectsRecursive(primary_object)) {
+                const auto lod_polygons = polygon_index.find(*atomic_object, lod);
+                if (lod_polygons != nullptr) index_count += lod_polygons->index_count;
+            }
+        }
+        return index_count / 3;
+    }
+
+    /**
+     * グリッド内の三角形数が max_triangle_count を超える間、グリッドを4分割することを再帰的に繰り返し、
+     * 分割後のグリッドを out_grids の末尾に追加します。
+     * 分割後の各グリッドに CityObject の位置で振り分けるため、元のグリッドの順番と、各グリッド内の CityObject の順番は保たれます。
+     */
+    void subdivideGrid(std::list<const citygml::CityObject*>&& objects, const GridBounds& bounds, const int depth,
+                       const std::unordered_map<const citygml::CityObject*, std::pair<TVec3d, long long>>& object_info,
+                       const unsigned max_triangle_count, std::vector<std::list<const citygml::CityObject*>>& out_grids) { // NOLINT(misc-no-recursion)
+        if (objects.empty()) return;
+
+        long long triangle_count = 0;
+        for (const auto object : objects) {
+            triangle_count += object_info.at(object).second;
+        }
+        if (triangle_count <= max_triangle_count || objects.size() <= 1 || depth >= max_grid_subdivision_depth) {
+            out_grids.push_back(std::move(objects));
+            return;
+        }
+
+        // 4分割します。子グリッドの番号は x + y * 2 です。
+        const auto mid_x = (bounds.min_x + bounds.max_x) * 0.5;
+        const auto mid_y = (bounds.min_y + bounds.max_y) * 0.5;
+        std::array<std::list<const citygml::CityObject*>, 4> children;
+        for (const auto object : objects) {
+            const auto& position = object_info.at(object).first;
+            const int child_x = position.x < mid_x ? 0 : 1;
+            const int child_y = position.y < mid_y ? 0 : 1;
+            children.at(child_x + child_y * 2).push_back(object);
+        }
+        const std::array<GridBounds, 4> child_bounds = {
+                GridBounds{bounds.min_x, bounds.min_y, mid_x, mid_y},
+                GridBounds{mid_x, bounds.min_y, bounds.max_x, mid_y},
+                GridBounds{bounds.min_x, mid_y, mid_x, bounds.max_y},
+                GridBounds{mid_x, mid_y, bounds.max_x, bounds.max_y}
+        };
+        for (size_t i = 0; i < children.size(); i++) {
+            subdivideGrid(std::move(children.at(i)), child_bounds.at(i), depth + 1, object_info, max_triangle_count, out_grids);
+        }
+    }
+
+    /**
+     * grid_count_of_side による均等なグリッドを起点として、三角形数が options.max_triangle_count_in_grid を超えるグリッドを4分木状に分割します。
+     * 分割後のグリッドに、元のグリッド番号の順に 0 から番号を振り直して返します。
+     * 三角形数は、主要地物ごとに min_lod から max_lod のうち最も多いLODのものを使います。
+     * 分割の結果はLODによらないため、どのLODでも同じグリッド番号は同じ範囲を指し、グリッドとグループの対応が保たれます。
+     */
+    GridIDToObjectsMap subdivideGridsByTriangleCount(GridIDToObjectsMap&& grid_id_to_objects_map, const citygml::Envelope& city_envelope,
+                                                     const MeshExtractOptions& options,
+                                                     const CityObjectPolygonIndex& polygon_index,
+                                                     const CityObjectBoundsCache& bounds_cache) {
+        // 分割の判定に使う位置と三角形数を CityObject ごとに1回だけ求めます。
+        std::unordered_map<const citygml::CityObject*, std::pair<TVec3d, long long>> object_info;
+        for (const auto& [grid_id, objects] : grid_id_to_objects_map) {
+            for (const auto object : objects) {
+                long long triangle_count = 0;
+                for (auto lod = options.min_lod; lod <= options.max_lod; lod++) {
+                    triangle_count = std::max(triangle_count, countTrianglesInPrimaryObject(*object, lod, polygon_index));
+                }
+                object_info.emplace(object, std::make_pair(bounds_cache.findPosition(*object).value(), triangle_count));
+            }
+        }
+
+        const auto lower = city_envelope.getLowerBound();
+        const auto upper = city_envelope.getUpperBound();
+        const int grid_num = options.grid_count_of_side;
+        const auto grid_size_x = (upper.x - lower.x) / grid_num;
+        const auto grid_size_y = (upper.y - lower.y) / grid_num;
+
+        std::vector<std::list<const citygml::CityObject*>> subdivided_grids;
+        for (auto& [grid_id, objects] : grid_id_to_objects_map) {
+            const int grid_x = static_cast<int>(grid_id) % grid_num;
+            const int grid_y = static_cast<int>(grid_id) / grid_num;
+            const auto bounds = GridBounds{
+                    lower.x + grid_size_x * grid_x, lower.y + grid_size_y * grid_y,
+                    lower.x + grid_size_x * (grid_x + 1), lower.y + grid_size_y * (grid_y + 1)};
+            subdivideGrid(std::move(objects), bounds, 0, object_info, options.max_triangle_count_in_grid, subdivided_grids);
+        }
+
+        auto result = GridIDToObjectsMap();
+        for (unsigned i = 0; i < subdivided_grids.size(); i++) {
+            result.emplace(i, std::move(subdivided_grids.at(i)));
+        }
+        return result;
+    }
+
+    /// HLOD の4分木の1つのノードが受け持つグリッドの範囲 [x_begin, x_end) × [y_begin, y_end) です。
+    struct HlodCell {
+        int x_begin;
+        int y_begin;
+        int x_end;
+        int y_end;
+        int depth;
+        std::vector<size_t> children;
+
+        bool isLeaf() const {
+            return children.empty();
+        }
+    };
+
+    /**
+     * グリッドの範囲を4分割することを1つのグリッドになるまで繰り返し、4分木のノードを out_cells に追加します。
+     * 追加したノードの out_cells での番号を返します。
+     */
+    size_t buildHlodCells(const int x_begin, const int y_begin, const int x_end, const int y_end, const int depth,
+                          std::vector<HlodCell>& out_cells) { // NOLINT(misc-no-recursion)
+        const auto index = out_cells.size();
+        out_cells.push_back({x_begin, y_begin, x_end, y_end, depth, {}});
+        if (x_end - x_begin <= 1 && y_end - y_begin <= 1) return index;
+
+        // グリッドの数が2のべき乗でない場合や、縦横で異なる場合は、空になる部分を除きます。
+        const int mid_x = x_begin + (x_end - x_begin + 1) / 2;
+        const int mid_y = y_begin + (y_end - y_begin + 1) / 2;
+        const std::array<std::array<int, 4>, 4> quadrants = {{
+                {x_begin, y_begin, mid_x, mid_y},
+                {mid_x, y_begin, x_end, mid_y},
+                {x_begin, mid_y, mid_x, y_end},
+                {mid_x, mid_y, x_end, y_end}
+        }};
+        for (const auto& [child_x_begin, child_y_begin, child_x_end, child_y_end] : quadrants) {
+            if (child_x_begin >= child_x_end || child_y_begin >= child_y_end) continue;
+            const auto child = buildHlodCells(child_x_begin, child_y_begin, child_x_end, child_y_end, depth + 1, out_cells);
+            out_cells.at(index).children.push_back(child);
+        }
+        return index;
+    }
+
+    /// 主要地物を HLOD の葉のメッシュに含めるときのLODです。 min_lod から max_lod のうち存在する最も高いLODであり、なければ std::nullopt です。
+    std::optional<unsigned> selectHlodDetailLod(const CityObjectPolygonIndex::LodMask lod_mask, const MeshExtractOptions& options) {
+        for (auto lod = options.max_lod + 1; lod-- > options.min_lod;) {
+            if (CityObjectPolygonIndex::lodMaskContains(lod_mask, lod)) return lod;
+        }
+        return std::nullopt;
+    }
+
+    /// 主要地物を HLOD の粗いメッシュに含めるときのLODです。 LOD1 の形状があれば LOD1、なければ LOD0 の形状(フットプリント)を使います。
+    std::optional<unsigned> selectHlodProxyLod(const CityObjectPolygonIndex::LodMask lod_mask) {
+        for (const unsigned lod : {1u, 0u}) {
+            if (CityObjectPolygonIndex::lodMaskContains(lod_mask, lod)) return lod;
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * 4分木のノード cell_index 以下の Node を組み立て、 meshes のうち対応するメッシュを移動して持たせます。
+     * 各 Node には、子孫も含めたメッシュの範囲と、その外接球の半径に switch_distance_factor を掛けた切り替えの距離を設定します。
+     */
+    Node assembleHlodNode(const std::vector<HlodCell>& cells, const size_t cell_index,
+                          std::vector<std::unique_ptr<Mesh>>& meshes, const double switch_distance_factor) { // NOLINT(misc-no-recursion)
+        const auto& cell = cells.at(cell_index);
+        const auto name = cell.isLeaf()
+                ? "grid_" + std::to_string(cell.x_begin) + "_" + std::to_string(cell.y_begin)
+                : "hlod_" + std::to_string(cell.depth) + "_" + std::to_string(cell.x_begin) + "_" + std::to_string(cell.y_begin);
+        auto node = Node(name, std::move(meshes.at(cell_index)));
+
+        std::optional<std::pair<TVec3d, TVec3d>> bounds;
+        const auto extend = [&bounds](const TVec3d& min, const TVec3d& max) {
+            if (!bounds.has_value()) {
+                bounds.emplace(min, max);
+                return;
+            }
+            auto& [current_min, current_max] = bounds.value();
+            current_min = TVec3d(std::min(current_min.x, min.x), std::min(current_min.y, min.y), std::min(current_min.z, min.z));
+            current_max = TVec3d(std::max(current_max.x, max.x), std::max(current_max.y, max.y), std::max(current_max.z, max.z));
+        };
+        if (node.polygonExists()) {
+            for (const auto& vertex : node.getMesh()->getVertices()) extend(vertex, vertex);
+        }
+        node.reserveChild(cell.children.size());
+        for (const auto child_index : cell.children) {
+            auto child = assembleHlodNode(cells, child_index, meshes, switch_distance_factor);
+            const auto& child_info = child.getHlodInfo();
+            if (child_info.has_value()) extend(child_info->bounds_min, child_info->bounds_max);
+            node.addChildNode(std::move(child));
+        }
+        if (!bounds.has_value()) return node;
+
+        const auto& [min, max] = bounds.value();
+        const auto radius = (max - min).length() * 0.5;
+        node.setHlodInfo({min, max, cell.isLeaf() ? 0.0 : radius * switch_distance_factor});
+        return node;
+    }
 }
 
 namespace plateau::polygonMesh {
@@ -82,13 +316,69 @@ namespace plateau::polygonMesh {
 
     GridMergeResult
         AreaMeshFactory::gridMerge(const CityModel& city_model, const MeshExtractOptions& options, unsigned lod,
-                              const geometry::GeoReference& geo_reference, const std::vector<plateau::geometry::Extent>& extents) {
-        // city_model に含まれる 主要地物 をグリッドに分類します。
+                              const geometry::GeoReference& geo_reference, const std::vector<plateau::geometry::Extent>& extents,
+                              const CityObjectPolygonIndex* polygon_index, const ThreadPool* thread_pool,
+                              TexturePathCache* texture_path_cache, const geometry::ExtentIndex* extent_index,
+                              const CityObjectBoundsCache* bounds_cache, const ExtractProgress* progress) {
+        auto merged_meshes = GridMergeResult();
+        gridMergeStreaming(city_model, options, lod, geo_reference, extents,
+                           [&merged_meshes](const unsigned group_id, std::unique_ptr<Mesh>&& mesh) {
+                               merged_meshes.emplace(group_id, std::move(mesh));
+                           },
+                           0, polygon_index, thread_pool, texture_path_cache, extent_index, bounds_cache, progress);
+        return merged_meshes;
+    }
+
+    void AreaMeshFactory::gridMergeStreaming(
+            const CityModel& city_model, const MeshExtractOptions& options, unsigned lod,
+            const geometry::GeoReference& geo_reference, const std::vector<plateau::geometry::Extent>& extents,
+            const GroupMeshCallback& on_group_merged, const size_t window_size,
+            const CityObjectPolygonIndex* polygon_index, const ThreadPool* thread_pool,
+            TexturePathCache* texture_path_cache, const geometry::ExtentIndex* extent_index,
+            const CityObjectBoundsCache* bounds_cache, const ExtractProgress* progress) {
         const auto& all_primary_city_objects =
             city_model.getAllCityObjectsOfType(PrimaryCityObjectTypes::getPrimaryTypeMask());
+
+        // スレッドは呼び出し全体で1つの ThreadPool を使い回します。
+        std::optional<ThreadPool> local_thread_pool;
+        if (thread_pool == nullptr) {
+            local_thread_pool.emplace(options.thread_count);
+            thread_pool = &local_thread_pool.value();
+        }
+
+        // 位置のキャッシュが渡されなければ、絞り込みの条件に合う主要地物について構築します。
+        CityObjectBoundsCache local_bounds_cache;
+        if (bounds_cache == nullptr) {
+            const CityObjectFilter filter(options);
+            auto filtered_objects = std::vector<const CityObject*>();
+            for (const auto primary_object : all_primary_city_objects) {
+                if (filter.passes(*primary_object)) filtered_objects.push_back(primary_object);
+            }
+            local_bounds_cache.build(filtered_objects, *thread_pool);
+            bounds_cache = &local_bounds_cache;
+        }
+
+        // city_model に含まれる 主要地物 をグリッドに分類します。
         const auto& city_envelope = city_model.getEnvelope();
-        auto grid_id_to_primary_objects_map = classifyCityObjectsToGrid(all_primary_city_objects, city_envelope, options, extents);
-        
+        auto grid_id_to_primary_objects_map = classifyCityObjectsToGrid(all_primary_city_objects, city_envelope, options, extents, *bounds_cache);
+
+        // 索引が渡されなければ、グリッドに分類された主要地物について構築します。
+        CityObjectPolygonIndex local_polygon_index;
+        if (polygon_index == nullptr) {
+            auto classified_objects = std::vector<const CityObject*>();
+            for (const auto& [grid_id, primary_objects_in_grid] : grid_id_to_primary_objects_map) {
+                classified_objects.insert(classified_objects.end(), primary_objects_in_grid.begin(), primary_objects_in_grid.end());
+            }
+            local_polygon_index.build(classified_objects, *thread_pool);
+            polygon_index = &local_polygon_index;
+        }
+
+        // 三角形数の上限が指定されていれば、上限を超えるグリッドをさらに細かく分割します。
+        if (options.max_triangle_count_in_grid > 0) {
+            grid_id_to_primary_objects_map = subdivideGridsByTriangleCount(
+                    std::move(grid_id_to_primary_objects_map), city_envelope, options, *polygon_index, *bounds_cache);
+        }
+
         // グリッドをさらに分割してグループにします。
         // グループの分割基準:
         // 仕様上存在しうる最大LODをm として、各オブジェクトを次のグループに分けます。
@@ -107,10 +397,11 @@ namespace plateau::polygonMesh {
         for (const auto& [grid_id, primary_objects_in_grid] : grid_id_to_primary_objects_map) {
             for (const auto& primary_object : primary_objects_in_grid) {
                 // この CityObject について、最大でどのLODまで存在するか確認します。
+                // 存在するLODは索引の構築時にビットマスクとして求めてあるため、ここでは木構造を走査しません。
+                const auto lod_mask = polygon_index->getLodMaskRecursive(*primary_object);
                 unsigned max_lod_in_obj = PolygonMeshUtils::max_lod_in_specification_;
                 for (unsigned target_lod = lod + 1; target_lod <= PolygonMeshUtils::max_lod_in_specification_; ++target_lod) {
-                    bool target_lod_exists =
-                        PolygonMeshUtils::findFirstPolygon(primary_object, target_lod) != nullptr;
+                    bool target_lod_exists = CityObjectPolygonIndex::lodMaskContains(lod_mask, target_lod);
                     if (!target_lod_exists) {
                         max_lod_in_obj = target_lod - 1;
                         break;
@@ -126,28 +417,136 @@ namespace plateau::polygonMesh {
         }
 
         // グループごとにメッシュを結合します。
-        auto merged_meshes = GridMergeResult();
-        // グループごとのループ
-        for (const auto& [group_id, primary_objects] : group_id_to_primary_objects_map) {
-            // 1グループのメッシュ生成
-            MeshFactory mesh_factory(nullptr, options, extents, geo_reference);
-
-            // グループ内の各主要地物のループ
-            for (const auto& primary_object : primary_objects) {
-                if(MeshExtractor::isTypeToSkip(primary_object->getType())) continue;
-                if (MeshExtractor::shouldContainPrimaryMesh(lod, *primary_object)) {
-                    mesh_factory.addPolygonsInPrimaryCityObject(*primary_object, lod, city_model.getGmlPath());
-                }
+        // 各グループは互いに独立しているため並列に処理し、結果はグループIDの順に渡します。
+        // 先頭のグループが終わり次第渡して次のグループに進むことで、同時にメモリ上にあるメッシュを window_size 個程度に抑えます。
+        auto groups = std::vector<const GroupIDToObjectsMap::value_type*>();
+        groups.reserve(group_id_to_primary_objects_map.size());
+        for (const auto& group : group_id_to_primary_objects_map) {
+            groups.push_back(&group);
+        }
+        const auto group_count = groups.size();
+
+        // 進捗はグループに含まれる主要地物の数で数えます。
+        size_t object_count = 0;
+        for (const auto group : groups) {
+            object_count += group->second.size();
+        }
+        std::atomic<size_t> processed_object_count = 0;
+        if (progress != nullptr) progress->report(ExtractStage::Geometry, lod, 0, object_count);
+
+        const auto window = window_size == 0 ? group_count : std::min(window_size, group_count);
+        auto group_meshes = std::vector<std::unique_ptr<Mesh>>(window);
+        thread_pool->parallelForInOrder(group_count, window,
+            [&](size_t group_index) {
+                const auto& primary_objects = groups.at(group_index)->second;
+                // 1グループのメッシュ生成
+                MeshFactory mesh_factory(nullptr, options, extents, geo_reference, polygon_index, texture_path_cache, extent_index);
 
-                if (lod >= 2) {
-                    // 主要地物の子である各最小地物をメッシュに加えます。
-                    auto atomic_objects = PolygonMeshUtils::getChildCityObjectsRecursive(*primary_object);
-                    mesh_factory.addPolygonsInAtomicCityObjects(*primary_object, atomic_objects, lod, city_model.getGmlPath());
+                // グループ内の各主要地物のループ
+                for (const auto& primary_object : primary_objects) {
+                    if (progress != nullptr) progress->throwIfCancelled();
+                    if (!MeshExtractor::isTypeToSkip(primary_object->getType())) {
+                        if (MeshExtractor::shouldContainPrimaryMesh(lod, *primary_object)) {
+                            mesh_factory.addPolygonsInPrimaryCityObject(*primary_object, lod, city_model.getGmlPath());
+                        }
+
+                        if (lod >= 2) {
+                            // 主要地物の子である各最小地物をメッシュに加えます。
+                            auto atomic_objects = PolygonMeshUtils::getChildCityObjectsRecursive(*primary_object);
+                            mesh_factory.addPolygonsInAtomicCityObjects(*primary_object, atomic_objects, lod, city_model.getGmlPath());
+                        }
+                        mesh_factory.incrementPrimaryIndex();
+                    }
+                    if (progress != nullptr) {
+                        progress->report(ExtractStage::Geometry, lod, ++processed_object_count, object_count);
+                    }
                 }
-                mesh_factory.incrementPrimaryIndex();
+                group_meshes.at(group_index % window) = mesh_factory.releaseMesh();
+            },
+            [&](size_t group_index) {
+                on_group_merged(groups.at(group_index)->first, std::move(group_meshes.at(group_index % window)));
+            });
+    }
+
+    Node AreaMeshFactory::buildHlod(
+            const CityModel& city_model, const MeshExtractOptions& options,
+            const geometry::GeoReference& geo_reference, const std::vector<plateau::geometry::Extent>& extents,
+            const CityObjectPolygonIndex* polygon_index, const ThreadPool* thread_pool,
+            TexturePathCache* texture_path_cache, const geometry::ExtentIndex* extent_index,
+            const CityObjectBoundsCache* bounds_cache, const ExtractProgress* progress) {
+        const auto& all_primary_city_objects =
+            city_model.getAllCityObjectsOfType(PrimaryCityObjectTypes::getPrimaryTypeMask());
+
+        // ThreadPool と位置のキャッシュと索引の扱いは gridMergeStreaming と同じです。
+        std::optional<ThreadPool> local_thread_pool;
+        if (thread_pool == nullptr) {
+            local_thread_pool.emplace(options.thread_count);
+            thread_pool = &local_thread_pool.value();
+        }
+        CityObjectBoundsCache local_bounds_cache;
+        if (bounds_cache == nullptr) {
+            const CityObjectFilter filter(options);
+            auto filtered_objects = std::vector<const CityObject*>();
+            for (const auto primary_object : all_primary_city_objects) {
+                if (filter.passes(*primary_object)) filtered_objects.push_back(primary_object);
             }
-            merged_meshes.emplace(group_id, mesh_factory.releaseMesh());
+            local_bounds_cache.build(filtered_objects, *thread_pool);
+            bounds_cache = &local_bounds_cache;
         }
-        return merged_meshes;
+        const auto grid_id_to_primary_objects_map = classifyCityObjectsToGrid(
+                all_primary_city_objects, city_model.getEnvelope(), options, extents, *bounds_cache);
+
+        CityObjectPolygonIndex local_polygon_index;
+        if (polygon_index == nullptr) {
+            auto classified_objects = std::vector<const CityObject*>();
+            for (const auto& [grid_id, primary_objects_in_grid] : grid_id_to_primary_objects_map) {
+                classified_objects.insert(classified_objects.end(), primary_objects_in_grid.begin(), primary_objects_in_grid.end());
+            }
+            local_polygon_index.build(classified_objects, *thread_pool);
+            polygon_index = &local_polygon_index;
+        }
+
+        // grid_count_of_side による均等なグリッドを葉とする4分木を作ります。
+        const int grid_num = options.grid_count_of_side;
+        std::vector<HlodCell> cells;
+        buildHlodCells(0, 0, grid_num, grid_num, 0, cells);
+
+
+        // 各ノードのメッシュは互いに独立しているため、並列に作ります。進捗は4分木のノードの数で数え、LODは区別しません。
+        std::atomic<size_t> processed_cell_count = 0;
+        if (progress != nullptr) progress->report(ExtractStage::Geometry, ExtractProgress::no_lod, 0, cells.size());
+        std::vector<std::unique_ptr<Mesh>> meshes(cells.size());
+        thread_pool->parallelFor(cells.size(), [&](size_t cell_index) {
+            if (progress != nullptr) progress->throwIfCancelled();
+            const auto& cell = cells.at(cell_index);
+            MeshFactory mesh_factory(nullptr, options, extents, geo_reference, polygon_index, texture_path_cache, extent_index);
+            for (int grid_y = cell.y_begin; grid_y < cell.y_end; grid_y++) {
+                for (int grid_x = cell.x_begin; grid_x < cell.x_end; grid_x++) {
+                    for (const auto primary_object : grid_id_to_primary_objects_map.at(grid_x + grid_y * grid_num)) {
+                        if (MeshExtractor::isTypeToSkip(primary_object->getType())) continue;
+                        const auto lod_mask = polygon_index->getLodMaskRecursive(*primary_object);
+                        const auto lod = cell.isLeaf() ? selectHlodDetailLod(lod_mask, options) : selectHlodProxyLod(lod_mask);
+                        if (!lod.has_value()) continue;
+
+                        if (MeshExtractor::shouldContainPrimaryMesh(lod.value(), *primary_object)) {
+                            mesh_factory.addPolygonsInPrimaryCityObject(*primary_object, lod.value(), city_model.getGmlPath());
+                        }
+                        if (lod.value() >= 2) {
+                            auto atomic_objects = PolygonMeshUtils::getChildCityObjectsRecursive(*primary_object);
+                            mesh_factory.addPolygonsInAtomicCityObjects(*primary_object, atomic_objects, lod.value(), city_model.getGmlPath());
+                        }
+                        mesh_factory.incrementPrimaryIndex();
+                    }
+                }
+            }
+            meshes.at(cell_index) = mesh_factory.releaseMesh();
+            if (progress != nullptr) {
+                progress->report(ExtractStage::Geometry, ExtractProgress::no_lod, ++processed_cell_count, cells.size());
+            }
+        });
+
+        auto hlod_node = Node("HLOD");
+        hlod_node.addChildNode(assembleHlodNode(cells, 0, meshes, options.hlod_switch_distance_factor));
+        return hlod_node;
     }
 }
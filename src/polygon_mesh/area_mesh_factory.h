@@ -2,13 +2,23 @@
 
 #include "citygml/citymodel.h"
 #include "plateau/geometry/geo_reference.h"
+#include <plateau/geometry/extent_index.h>
 #include <plateau/polygon_mesh/mesh_extractor.h>
 #include <plateau/polygon_mesh/mesh.h>
+#include <plateau/polygon_mesh/node.h>
 #include <plateau/polygon_mesh/mesh_extract_options.h>
+#include <plateau/polygon_mesh/city_object_polygon_index.h>
+#include <plateau/polygon_mesh/city_object_bounds_cache.h>
+#include <plateau/polygon_mesh/texture_path_cache.h>
+#include <plateau/polygon_mesh/extract_progress.h>
+#include "thread_pool.h"
+#include <functional>
 
 namespace plateau::polygonMesh {
     /// グループIDと、その結合後Meshのmapです。
     using GridMergeResult = std::map<unsigned, std::unique_ptr<Mesh>>;
+    /// グループIDと、その結合後Meshを受け取る関数です。
+    using GroupMeshCallback = std::function<void(unsigned group_id, std::unique_ptr<Mesh>&& mesh)>;
 
     /**
      * cityModel をグリッド状に分割し、各地物オブジェクトをグリッドに分類します。
@@ -20,9 +30,47 @@ namespace plateau::polygonMesh {
     public:
         /**
          * city_model の範囲をグリッド状に分割して、グリッドをさらにグループに分け、各グループ内のメッシュを結合して返します。
+         * polygon_index が nullptr の場合、分類対象の主要地物について索引をその場で構築します。
+         * 複数のLODで gridMerge を呼ぶ場合は、索引を共有すると Geometry の走査が1回で済みます。
+         * グループごとのメッシュ結合は thread_pool で並列に行います。
+         * thread_pool が nullptr の場合、 options.thread_count のスレッド数で処理します。
+         * 呼び出し元の ThreadPool を渡すとスレッドを作り直さずに済み、呼び出し元がすでに並列処理中でもスレッド数の合計が thread_count を超えません。
+         * texture_path_cache と extent_index は MeshFactory にそのまま渡されます。
+         * bounds_cache は範囲による除外とグリッドへの分類に使う主要地物の位置です。 nullptr の場合はその場で構築します。
+         * progress が渡された場合、主要地物を1つ処理するたびに進捗を通知し、中断が要求されていれば ExtractCancelledException を投げます。
          */
         static GridMergeResult
         gridMerge(const citygml::CityModel& city_model, const MeshExtractOptions& options, unsigned lod,
-                  const plateau::geometry::GeoReference& geo_reference, const std::vector<plateau::geometry::Extent>& extents);
+                  const plateau::geometry::GeoReference& geo_reference, const std::vector<plateau::geometry::Extent>& extents,
+                  const CityObjectPolygonIndex* polygon_index = nullptr, const ThreadPool* thread_pool = nullptr,
+                  TexturePathCache* texture_path_cache = nullptr, const plateau::geometry::ExtentIndex* extent_index = nullptr,
+                  const CityObjectBoundsCache* bounds_cache = nullptr, const ExtractProgress* progress = nullptr);
+
+        /**
+         * gridMerge と同様にグループごとのメッシュを結合し、結合が終わったものからグループIDの順に on_group_merged に渡します。
+         * メッシュの結合は並列に行い、先頭のグループが終わり次第渡して次のグループの結合に進みます。
+         * 結合を始めるのは、 window_size 個前のグループを渡し終えた後です。
+         * そのため、同時にメモリ上にある結合後のメッシュは window_size 個程度です。 window_size が 0 のときは全グループを一度に結合します。
+         */
+        static void
+        gridMergeStreaming(const citygml::CityModel& city_model, const MeshExtractOptions& options, unsigned lod,
+                           const plateau::geometry::GeoReference& geo_reference, const std::vector<plateau::geometry::Extent>& extents,
+                           const GroupMeshCallback& on_group_merged, size_t window_size,
+                           const CityObjectPolygonIndex* polygon_index = nullptr, const ThreadPool* thread_pool = nullptr,
+                           TexturePathCache* texture_path_cache = nullptr, const plateau::geometry::ExtentIndex* extent_index = nullptr,
+                           const CityObjectBoundsCache* bounds_cache = nullptr, const ExtractProgress* progress = nullptr);
+
+        /**
+         * city_model の範囲をグリッド状に分割し、グリッドを葉とする4分木の HLOD の階層を作って、それを子に持つノード "HLOD" を返します。
+         * 葉のノードはグリッドの詳細なメッシュを、それ以外のノードは子孫のグリッドの粗いメッシュ(LOD1 または LOD0)を持ち、
+         * 各ノードに HlodInfo を設定します。詳しくは MeshExtractOptions::build_hlod をご覧ください。
+         * 引数の扱いは gridMerge と同じです。
+         */
+        static Node
+        buildHlod(const citygml::CityModel& city_model, const MeshExtractOptions& options,
+                  const plateau::geometry::GeoReference& geo_reference, const std::vector<plateau::geometry::Extent>& extents,
+                  const CityObjectPolygonIndex* polygon_index = nullptr, const ThreadPool* thread_pool = nullptr,
+                  TexturePathCache* texture_path_cache = nullptr, const plateau::geometry::ExtentIndex* extent_index = nullptr,
+                  const CityObjectBoundsCache* bounds_cache = nullptr, const ExtractProgress* progress = nullptr);
     };
 }
@@ -0,0 +1,116 @@
+#include <plateau/polygon_mesh/city_object_bounds_cache.h>
+#include <plateau/polygon_mesh/polygon_mesh_utils.h>
+#include "citygml/cityobject.h"
+#include "citygml/polygon.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <array>
+
+namespace plateau::polygonMesh {
+    using namespace citygml;
+
+    namespace {
+        /// CityObject とその子孫の Geometry を1回だけ走査して、位置と外接直方体を求めるための集計です。
+        struct BoundsCollector {
+            /// LOD ごとに、 PolygonMeshUtils::findFirstPolygon で見つかるポリゴンの最初の頂点です。
+            std::array<std::optional<TVec3d>, PolygonMeshUtils::max_lod_in_specification_ + 1> first_vertices;
+            std::optional<TVec3d> min;
+            std::optional<TVec3d> max;
+
+            void addVertex(const TVec3d& vertex) {
+                if (!min.has_value()) {
+                    min = vertex;
+                    max = vertex;
+                    return;
+                }
+                min = TVec3d(std::min(min->x, vertex.x), std::min(min->y, vertex.y), std::min(min->z, vertex.z));
+                max = TVec3d(std::max(max->x, vertex.x), std::max(max->y, vertex.y), std::max(max->z, vertex.z));
+            }
+
+            /**
+             * findFirstPolygon は、LODが指定と異なる Geometry の子を走査しません。
+             * 同じ結果になるよう、 is_first_vertex_target は祖先の Geometry がすべて同じLODである場合のみ true とします。
+             */
+            void collectInGeometry(const Geometry& geometry, const bool is_first_vertex_target) { // NOLINT(misc-no-recursion)
+                const auto lod = geometry.getLOD();
+                const bool is_lod_in_range = lod < first_vertices.size();
+                const unsigned int polygon_count = geometry.getPolygonsCount();
+                for (unsigned int i = 0; i < polygon_count; i++) {
+                    const auto& vertices = geometry.getPolygon(i)->getVertices();
+                    if (vertices.empty()) continue;
+                    if (is_first_vertex_target && is_lod_in_range && !first_vertices.at(lod).has_value()) {
+                        first_vertices.at(lod) = vertices.at(0);
+                    }
+                    for (const auto& vertex : vertices) {
+                        addVertex(vertex);
+                    }
+                }
+
+                const unsigned int child_count = geometry.getGeometriesCount();
+                for (unsigned int i = 0; i < child_count; i++) {
+                    const auto& child = geometry.getGeometry(i);
+                    collectInGeometry(child, is_first_vertex_target && child.getLOD() == lod);
+                }
+            }
+
+            /// findFirstPolygon と同じく、子の CityObject を先に、次に自身の Geometry を走査します。
+            void collectInCityObject(const CityObject& city_obj) { // NOLINT(misc-no-recursion)
+                const unsigned int child_count = city_obj.getChildCityObjectsCount();
+                for (unsigned int i = 0; i < child_count; i++) {
+                    collectInCityObject(city_obj.getChildCityObject(i));
+                }
+                const unsigned int geometry_count = city_obj.getGeometriesCount();
+                for (unsigned int i = 0; i < geometry_count; i++) {
+                    collectInGeometry(city_obj.getGeometry(i), true);
+                }
+            }
+        };
+    }
+
+    void CityObjectBoundsCache::build(const std::vector<const CityObject*>& city_objects, const unsigned thread_count) {
+        build(city_objects, ThreadPool(thread_count));
+    }
+
+    void CityObjectBoundsCache::build(const std::vector<const CityObject*>& city_objects, const ThreadPool& thread_pool) {
+        std::vector<std::optional<CityObjectBounds>> results(city_objects.size());
+        thread_pool.parallelFor(city_objects.size(), [&](size_t i) {
+            results.at(i) = compute(*city_objects.at(i));
+        });
+
+        entries_.reserve(entries_.size() + city_objects.size());
+        for (size_t i = 0; i < city_objects.size(); i++) {
+            entries_.emplace(city_objects.at(i), results.at(i));
+        }
+    }
+
+    std::optional<CityObjectBounds> CityObjectBoundsCache::find(const CityObject& city_obj) const {
+        const auto it = entries_.find(&city_obj);
+        if (it != entries_.end()) return it->second;
+        return compute(city_obj);
+    }
+
+    std::optional<TVec3d> CityObjectBoundsCache::findPosition(const CityObject& city_obj) const {
+        const auto bounds = find(city_obj);
+        if (!bounds.has_value()) return std::nullopt;
+        return bounds->position;
+    }
+
+    std::optional<CityObjectBounds> CityObjectBoundsCache::compute(const CityObject& city_obj) {
+        const auto& envelope = city_obj.getEnvelope();
+        if (envelope.validBounds()) {
+            const auto& lower = envelope.getLowerBound();
+            const auto& upper = envelope.getUpperBound();
+            return CityObjectBounds{(lower + upper) * 0.5, lower, upper};
+        }
+
+        BoundsCollector collector;
+        collector.collectInCityObject(city_obj);
+        for (const auto& first_vertex : collector.first_vertices) {
+            if (first_vertex.has_value()) {
+                return CityObjectBounds{first_vertex.value(), collector.min.value(), collector.max.value()};
+            }
+        }
+        // 位置が不明
+        return std::nullopt;
+    }
+}
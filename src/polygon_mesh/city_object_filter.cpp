@@ -0,0 +1,84 @@
+#include "city_object_filter.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <citygml/attributesmap.h>
+
+namespace plateau::polygonMesh {
+    using namespace citygml;
+
+    namespace {
+        /// str 全体が数値として読めればその値を返します。
+        std::optional<double> parseNumber(const std::string& str) {
+            if (str.empty()) return std::nullopt;
+            char* end = nullptr;
+            const auto value = std::strtod(str.c_str(), &end);
+            // 前後の空白は許容します。
+            while (end != nullptr && *end != '\0' && std::isspace(static_cast<unsigned char>(*end))) end++;
+            if (end == str.c_str() || *end != '\0') return std::nullopt;
+            return value;
+        }
+
+        /// 属性値 attribute_value とフィルタの値 filter_value が comparison の関係を満たすかどうかを返します。
+        template<typename T>
+        bool satisfies(const T& attribute_value, const T& filter_value, const AttributeFilterComparison comparison) {
+            switch (comparison) {
+                case AttributeFilterComparison::Equal:
+                    return attribute_value == filter_value;
+                case AttributeFilterComparison::NotEqual:
+                    return attribute_value != filter_value;
+                case AttributeFilterComparison::Less:
+                    return attribute_value < filter_value;
+                case AttributeFilterComparison::LessOrEqual:
+                    return attribute_value <= filter_value;
+                case AttributeFilterComparison::Greater:
+                    return attribute_value > filter_value;
+                case AttributeFilterComparison::GreaterOrEqual:
+                    return attribute_value >= filter_value;
+                default:
+                    return true;
+            }
+        }
+
+        /// 固定長配列の文字列を、終端がなくても配列の長さまでで読み取ります。
+        template<size_t N>
+        std::string toString(const char (&chars)[N]) {
+            return std::string(chars, strnlen(chars, N));
+        }
+    }
+
+    CityObjectFilter::CityObjectFilter(const MeshExtractOptions& options) :
+        type_mask_(options.city_object_type_mask),
+        comparison_(options.attribute_filter_comparison),
+        key_(toString(options.attribute_filter_key)),
+        value_(toString(options.attribute_filter_value)),
+        numeric_value_(parseNumber(value_)) {
+    }
+
+    bool CityObjectFilter::passes(const CityObject& primary_object) const {
+        if ((primary_object.getType() & type_mask_) == static_cast<CityObject::CityObjectsType>(0)) return false;
+        if (comparison_ == AttributeFilterComparison::None) return true;
+        return passesAttribute(primary_object);
+    }
+
+    bool CityObjectFilter::passesAttribute(const CityObject& primary_object) const {
+        const auto& attributes = primary_object.getAttributes();
+        const auto found = attributes.find(key_);
+        if (found == attributes.end()) return false;
+        if (comparison_ == AttributeFilterComparison::Exists) return true;
+
+        const auto& attribute = found->second;
+        if (attribute.getType() == AttributeType::AttributeSet) return false;
+
+        // 両方が数値として読めれば数値として比較し、そうでなければ文字列として比較します。
+        const auto& attribute_str = attribute.asString();
+        if (numeric_value_.has_value()) {
+            const auto attribute_number = parseNumber(attribute_str);
+            if (attribute_number.has_value()) {
+                return satisfies(attribute_number.value(), numeric_value_.value(), comparison_);
+            }
+        }
+        return satisfies(attribute_str, value_, comparison_);
+    }
+}
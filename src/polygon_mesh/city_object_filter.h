@@ -0,0 +1,32 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <citygml/cityobject.h>
+#include <plateau/polygon_mesh/mesh_extract_options.h>
+
+namespace plateau::polygonMesh {
+
+    /**
+     * MeshExtractOptions の city_object_type_mask と属性による絞り込みを、主要地物に対して判定します。
+     * フィルタ値の数値への変換はコンストラクタで1回だけ行い、地物ごとの判定では型の比較と属性の検索のみを行います。
+     * 判定は地物の Geometry を読まないため、除外される地物のポリゴンは走査されません。
+     */
+    class CityObjectFilter {
+    public:
+        explicit CityObjectFilter(const MeshExtractOptions& options);
+
+        /// primary_object が絞り込みの条件を満たし、出力すべきであれば true を返します。
+        bool passes(const citygml::CityObject& primary_object) const;
+
+    private:
+        bool passesAttribute(const citygml::CityObject& primary_object) const;
+
+        citygml::CityObject::CityObjectsType type_mask_;
+        AttributeFilterComparison comparison_;
+        std::string key_;
+        std::string value_;
+        /// value_ を数値として読めるときの値です。
+        std::optional<double> numeric_value_;
+    };
+}
@@ -0,0 +1,122 @@
+#include <plateau/polygon_mesh/city_object_polygon_index.h>
+#include "citygml/cityobject.h"
+#include "citygml/polygon.h"
+#include "thread_pool.h"
+#include <unordered_set>
+
+namespace plateau::polygonMesh {
+    using namespace citygml;
+
+    namespace {
+        void collectInGeometry(const Geometry& geom, CityObjectPolygonIndex::LodBuckets& out_buckets) { // NOLINT(misc-no-recursion)
+            // 子のジオメトリのポリゴンを先に集めます。
+            const unsigned int child_count = geom.getGeometriesCount();
+            for (unsigned int i = 0; i < child_count; i++) {
+                collectInGeometry(geom.getGeometry(i), out_buckets);
+            }
+
+            const auto lod = geom.getLOD();
+            if (lod >= out_buckets.size()) return;
+            auto& bucket = out_buckets.at(lod);
+
+            const unsigned int polygon_count = geom.getPolygonsCount();
+            for (unsigned int i = 0; i < polygon_count; i++) {
+                const auto& polygon = geom.getPolygon(i);
+                bucket.polygons.push_back(polygon.get());
+                bucket.vertex_count += static_cast<long long>(polygon->getVertices().size());
+                bucket.index_count += static_cast<long long>(polygon->getIndices().size());
+            }
+        }
+    }
+
+    void CityObjectPolygonIndex::build(const std::vector<const CityObject*>& city_objects, const unsigned thread_count) {
+        build(city_objects, ThreadPool(thread_count));
+    }
+
+    void CityObjectPolygonIndex::build(const std::vector<const CityObject*>& city_objects, const ThreadPool& thread_pool) {
+        // 索引を作る対象として、引数の CityObject とその子孫を重複なく列挙します。
+        std::vector<const CityObject*> targets;
+        std::unordered_set<const CityObject*> visited;
+        for (const auto city_obj : city_objects) {
+            if (visited.insert(city_obj).second) targets.push_back(city_obj);
+            for (const auto child : PolygonMeshUtils::getChildCityObjectsRecursive(*city_obj)) {
+                if (visited.insert(child).second) targets.push_back(child);
+            }
+        }
+
+        std::vector<LodBuckets> results(targets.size());
+        thread_pool.parallelFor(targets.size(), [&](size_t i) {
+            results.at(i) = collect(*targets.at(i));
+        });
+
+        entries_.reserve(entries_.size() + targets.size());
+        for (size_t i = 0; i < targets.size(); i++) {
+            entries_.emplace(targets.at(i), Entry{ std::move(results.at(i)), 0 });
+        }
+
+        // 子孫を含めたLODのビットマスクを求めます。子孫は親より先に計算されるようにします。
+        for (const auto city_obj : city_objects) {
+            computeLodMaskRecursive(*city_obj);
+        }
+    }
+
+    CityObjectPolygonIndex::LodMask CityObjectPolygonIndex::computeLodMaskRecursive(const CityObject& city_obj) { // NOLINT(misc-no-recursion)
+        auto& entry = entries_.at(&city_obj);
+        LodMask mask = 0;
+        for (unsigned lod = 0; lod < entry.buckets.size(); lod++) {
+            if (entry.buckets.at(lod).vertex_count > 0) mask |= 1u << lod;
+        }
+
+        const auto child_count = city_obj.getChildCityObjectsCount();
+        for (unsigned int i = 0; i < child_count; i++) {
+            mask |= computeLodMaskRecursive(city_obj.getChildCityObject(i));
+        }
+        entry.lod_mask_recursive = mask;
+        return mask;
+    }
+
+    const LodPolygons* CityObjectPolygonIndex::find(const CityObject& city_obj, const unsigned lod) const {
+        if (lod > PolygonMeshUtils::max_lod_in_specification_) return nullptr;
+        const auto it = entries_.find(&city_obj);
+        if (it == entries_.end()) return nullptr;
+        return &it->second.buckets.at(lod);
+    }
+
+    bool CityObjectPolygonIndex::hasPolygonsRecursive(const CityObject& city_obj, const unsigned lod) const {
+        if (lod > PolygonMeshUtils::max_lod_in_specification_) return false;
+        const auto it = entries_.find(&city_obj);
+        if (it == entries_.end()) {
+            return PolygonMeshUtils::findFirstPolygon(&city_obj, lod) != nullptr;
+        }
+        return lodMaskContains(it->second.lod_mask_recursive, lod);
+    }
+
+    CityObjectPolygonIndex::LodMask CityObjectPolygonIndex::getLodMaskRecursive(const CityObject& city_obj) const {
+        const auto it = entries_.find(&city_obj);
+        if (it != entries_.end()) return it->second.lod_mask_recursive;
+
+        LodMask mask = 0;
+        for (unsigned lod = 0; lod <= PolygonMeshUtils::max_lod_in_specification_; lod++) {
+            if (PolygonMeshUtils::findFirstPolygon(&city_obj, lod) != nullptr) mask |= 1u << lod;
+        }
+        return mask;
+    }
+
+    CityObjectPolygonIndex::LodBuckets CityObjectPolygonIndex::collect(const CityObject& city_obj) {
+        LodBuckets buckets;
+        collect(city_obj, buckets);
+        return buckets;
+    }
+
+    void CityObjectPolygonIndex::collect(const CityObject& city_obj, LodBuckets& out_buckets) {
+        for (auto& bucket : out_buckets) {
+            bucket.polygons.clear();
+            bucket.vertex_count = 0;
+            bucket.index_count = 0;
+        }
+        const auto geometry_count = city_obj.getGeometriesCount();
+        for (unsigned i = 0; i < geometry_count; i++) {
+            collectInGeometry(city_obj.getGeometry(i), out_buckets);
+        }
+    }
+}
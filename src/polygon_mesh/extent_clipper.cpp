@@ -0,0 +1,196 @@
+#include "extent_clipper.h"
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <tuple>
+
+namespace plateau::polygonMesh {
+    using namespace plateau::geometry;
+
+    namespace {
+        /// 切り取り処理中の頂点です。 original_index は元の頂点番号であり、境界上に新たに作った頂点では -1 です。
+        struct ClipVertex {
+            TVec3d lat_lon;
+            TVec2f uv;
+            long long original_index;
+        };
+
+        /// 範囲の境界線の1つです。 axis は 0 のとき緯度、 1 のとき経度です。
+        struct ClipBoundary {
+            int axis;
+            double value;
+            bool keep_greater;
+        };
+
+        double coordinateOf(const TVec3d& lat_lon, const int axis) {
+            return axis == 0 ? lat_lon.x : lat_lon.y;
+        }
+
+        bool isInside(const ClipVertex& vertex, const ClipBoundary& boundary) {
+            const auto coordinate = coordinateOf(vertex.lat_lon, boundary.axis);
+            return boundary.keep_greater ? coordinate >= boundary.value : coordinate <= boundary.value;
+        }
+
+        bool isInside(const TVec3d& lat_lon, const Extent& extent) {
+            return extent.contains(lat_lon);
+        }
+
+        /**
+         * 辺 (a, b) と境界線の交点を求めます。
+         * 同じ辺を逆向きに渡しても同じ結果になるよう、座標の小さい方の端点を基準に補間します。
+         */
+        ClipVertex intersect(const ClipVertex& a, const ClipVertex& b, const ClipBoundary& boundary) {
+            const bool a_is_smaller =
+                    std::tie(a.lat_lon.x, a.lat_lon.y, a.lat_lon.z) < std::tie(b.lat_lon.x, b.lat_lon.y, b.lat_lon.z);
+            const auto& p = a_is_smaller ? a : b;
+            const auto& q = a_is_smaller ? b : a;
+
+            const auto p_coordinate = coordinateOf(p.lat_lon, boundary.axis);
+            const auto q_coordinate = coordinateOf(q.lat_lon, boundary.axis);
+            const auto t = (boundary.value - p_coordinate) / (q_coordinate - p_coordinate);
+
+            auto lat_lon = TVec3d(
+                    p.lat_lon.x + (q.lat_lon.x - p.lat_lon.x) * t,
+                    p.lat_lon.y + (q.lat_lon.y - p.lat_lon.y) * t,
+                    p.lat_lon.z + (q.lat_lon.z - p.lat_lon.z) * t);
+            // 境界上の座標は補間の誤差を含まないよう境界の値そのものにします。
+            if (boundary.axis == 0) lat_lon.x = boundary.value;
+            else lat_lon.y = boundary.value;
+
+            const auto uv = TVec2f(
+                    p.uv.x + (q.uv.x - p.uv.x) * static_cast<float>(t),
+                    p.uv.y + (q.uv.y - p.uv.y) * static_cast<float>(t));
+            return {lat_lon, uv, -1};
+        }
+
+        /// Sutherland-Hodgman 法で、凸多角形 polygon を境界線の内側だけに切り取ります。
+        void clipByBoundary(const std::vector<ClipVertex>& polygon, const ClipBoundary& boundary,
+                            std::vector<ClipVertex>& out_polygon) {
+            out_polygon.clear();
+            const auto count = polygon.size();
+            for (size_t i = 0; i < count; i++) {
+                const auto& current = polygon[i];
+                const auto& next = polygon[(i + 1) % count];
+                const bool current_inside = isInside(current, boundary);
+                const bool next_inside = isInside(next, boundary);
+                if (current_inside) {
+                    out_polygon.push_back(current);
+                    if (!next_inside) out_polygon.push_back(intersect(current, next, boundary));
+                } else if (next_inside) {
+                    out_polygon.push_back(intersect(current, next, boundary));
+                }
+            }
+        }
+
+        bool isSamePosition(const ClipVertex& a, const ClipVertex& b) {
+            return a.lat_lon.x == b.lat_lon.x && a.lat_lon.y == b.lat_lon.y && a.lat_lon.z == b.lat_lon.z;
+        }
+
+        void removeConsecutiveDuplicates(std::vector<ClipVertex>& polygon) {
+            polygon.erase(std::unique(polygon.begin(), polygon.end(), isSamePosition), polygon.end());
+            while (polygon.size() > 1 && isSamePosition(polygon.front(), polygon.back())) {
+                polygon.pop_back();
+            }
+        }
+
+        /// 出力先の頂点を管理し、同じ頂点が重複して出力されないようにします。
+        class OutputVertices {
+        public:
+            OutputVertices(size_t original_vertex_count,
+                           std::vector<TVec3d>& out_vertices_lat_lon, std::vector<TVec2f>& out_uv) :
+                    original_to_output_(original_vertex_count, -1),
+                    out_vertices_lat_lon_(out_vertices_lat_lon),
+                    out_uv_(out_uv) {
+            }
+
+            unsigned add(const ClipVertex& vertex) {
+                if (vertex.original_index >= 0) {
+                    auto& output_index = original_to_output_.at(vertex.original_index);
+                    if (output_index < 0) output_index = push(vertex);
+                    return static_cast<unsigned>(output_index);
+                }
+                const auto key = std::make_tuple(vertex.lat_lon.x, vertex.lat_lon.y, vertex.lat_lon.z);
+                const auto found = created_vertices_.find(key);
+                if (found != created_vertices_.end()) return found->second;
+                const auto output_index = static_cast<unsigned>(push(vertex));
+                created_vertices_.emplace(key, output_index);
+                return output_index;
+            }
+
+        private:
+            long long push(const ClipVertex& vertex) {
+                out_vertices_lat_lon_.push_back(vertex.lat_lon);
+                out_uv_.push_back(vertex.uv);
+                return static_cast<long long>(out_vertices_lat_lon_.size()) - 1;
+            }
+
+            std::vector<long long> original_to_output_;
+            std::map<std::tuple<double, double, double>, unsigned> created_vertices_;
+            std::vector<TVec3d>& out_vertices_lat_lon_;
+            std::vector<TVec2f>& out_uv_;
+        };
+    }
+
+    void ExtentClipper::clip(const std::vector<TVec3d>& vertices_lat_lon, const std::vector<unsigned>& indices,
+                             const std::vector<TVec2f>& uv, const std::vector<Extent>& extents,
+                             std::vector<TVec3d>& out_vertices_lat_lon, std::vector<unsigned>& out_indices,
+                             std::vector<TVec2f>& out_uv) {
+        OutputVertices output(vertices_lat_lon.size(), out_vertices_lat_lon, out_uv);
+
+        const auto toClipVertex = [&](const unsigned index) {
+            return ClipVertex{vertices_lat_lon.at(index), index < uv.size() ? uv.at(index) : TVec2f(0, 0),
+                              static_cast<long long>(index)};
+        };
+
+        std::vector<ClipVertex> polygon;
+        std::vector<ClipVertex> clipped;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            const std::array<ClipVertex, 3> triangle = {
+                    toClipVertex(indices[i]), toClipVertex(indices[i + 1]), toClipVertex(indices[i + 2])};
+
+            // 三角形全体が1つの範囲に含まれていれば、切り取らずにそのまま出力します。
+            bool is_whole_inside = false;
+            for (const auto& extent : extents) {
+                if (isInside(triangle[0].lat_lon, extent) && isInside(triangle[1].lat_lon, extent) &&
+                    isInside(triangle[2].lat_lon, extent)) {
+                    is_whole_inside = true;
+                    break;
+                }
+            }
+            if (is_whole_inside) {
+                for (const auto& vertex : triangle) {
+                    out_indices.push_back(output.add(vertex));
+                }
+                continue;
+            }
+
+            // 範囲ごとに切り取ります。
+            for (const auto& extent : extents) {
+                const std::array<ClipBoundary, 4> boundaries = {
+                        ClipBoundary{0, extent.min.latitude, true},
+                        ClipBoundary{0, extent.max.latitude, false},
+                        ClipBoundary{1, extent.min.longitude, true},
+                        ClipBoundary{1, extent.max.longitude, false}};
+
+                polygon.assign(triangle.begin(), triangle.end());
+                for (const auto& boundary : boundaries) {
+                    clipByBoundary(polygon, boundary, clipped);
+                    std::swap(polygon, clipped);
+                    if (polygon.size() < 3) break;
+                }
+                // 頂点が境界上にあると、同じ位置の頂点が連続して出力されるため取り除きます。
+                removeConsecutiveDuplicates(polygon);
+                if (polygon.size() < 3) continue;
+
+                // 切り取った結果は凸多角形なので、扇形に三角形分割します。
+                const auto first = output.add(polygon[0]);
+                for (size_t j = 1; j + 1 < polygon.size(); j++) {
+                    out_indices.push_back(first);
+                    out_indices.push_back(output.add(polygon[j]));
+                    out_indices.push_back(output.add(polygon[j + 1]));
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <citygml/vecs.hpp>
+#include <plateau/geometry/geo_coordinate.h>
+#include <libplateau_api.h>
+
+namespace plateau::polygonMesh {
+
+    /**
+     * 三角形の集合を Extent の緯度・経度の範囲で切り取ります。
+     * 範囲の境界をまたぐ三角形は境界で分割され、範囲内の部分だけが残ります。
+     * 境界上に作られる頂点の位置と UV は、元の辺の両端から線形補間して求めます。
+     *
+     * 辺の補間は端点の順番によらず同じ計算になるようにしているため、
+     * 隣り合う範囲でそれぞれ切り取った結果は境界上で同じ頂点を共有し、すき間も重複もできません。
+     * ただし、範囲同士が重なっている場合は重なった部分が重複して出力されます。
+     */
+    class LIBPLATEAU_EXPORT ExtentClipper {
+    public:
+        /**
+         * vertices_lat_lon と indices で表される三角形群を extents で切り取り、結果を out と名の付く引数に格納します。
+         * uv は頂点ごとの UV であり、頂点数に足りない分は (0, 0) とみなします。
+         * 出力の頂点は緯度・経度・高さのままであり、使われない頂点は含みません。
+         * 三角形の向き(表裏)は保たれます。
+         */
+        static void clip(const std::vector<TVec3d>& vertices_lat_lon, const std::vector<unsigned>& indices,
+                         const std::vector<TVec2f>& uv, const std::vector<plateau::geometry::Extent>& extents,
+                         std::vector<TVec3d>& out_vertices_lat_lon, std::vector<unsigned>& out_indices,
+                         std::vector<TVec2f>& out_uv);
+    };
+}
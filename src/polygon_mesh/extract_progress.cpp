@@ -0,0 +1,35 @@
+#include <plateau/polygon_mesh/extract_progress.h>
+
+namespace plateau::polygonMesh {
+
+    ExtractCancelledException::ExtractCancelledException() :
+        std::runtime_error("Mesh extraction is cancelled.") {
+    }
+
+    ExtractProgress::ExtractProgress() :
+        is_cancelled_(false) {
+    }
+
+    ExtractProgress::ExtractProgress(Callback on_progress) :
+        is_cancelled_(false),
+        on_progress_(std::move(on_progress)) {
+    }
+
+    void ExtractProgress::cancel() {
+        is_cancelled_.store(true, std::memory_order_relaxed);
+    }
+
+    bool ExtractProgress::isCancelled() const {
+        return is_cancelled_.load(std::memory_order_relaxed);
+    }
+
+    void ExtractProgress::throwIfCancelled() const {
+        if (isCancelled()) throw ExtractCancelledException();
+    }
+
+    void ExtractProgress::report(const ExtractStage stage, const unsigned lod, const size_t processed, const size_t total) const {
+        if (!on_progress_) return;
+        std::lock_guard<std::mutex> lock(callback_mutex_);
+        on_progress_(stage, lod, processed, total);
+    }
+}
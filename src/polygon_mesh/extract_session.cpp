@@ -0,0 +1,51 @@
+#include <plateau/polygon_mesh/extract_session.h>
+#include <unordered_set>
+
+namespace plateau::polygonMesh {
+    namespace fs = std::filesystem;
+
+    namespace {
+        /// 実行中の全セッションが予約しているパスの一覧です。
+        struct ReservedPaths {
+            std::mutex mutex;
+            std::unordered_set<std::string> keys;
+        };
+
+        ReservedPaths& reservedPaths() {
+            static ReservedPaths reserved_paths;
+            return reserved_paths;
+        }
+
+        /// 同じファイルを指すパスが同じ文字列になるよう、絶対パスに正規化します。
+        std::string toKey(const fs::path& path) {
+            std::error_code error;
+            const auto absolute_path = fs::absolute(path, error);
+            return (error ? path : absolute_path).lexically_normal().u8string();
+        }
+    }
+
+    ExtractSession::~ExtractSession() {
+        auto& reserved_paths = reservedPaths();
+        std::lock_guard<std::mutex> lock(reserved_paths.mutex);
+        for (const auto& key : reserved_keys_) {
+            reserved_paths.keys.erase(key);
+        }
+    }
+
+    fs::path ExtractSession::reserveUniquePath(const std::function<fs::path(int attempt)>& path_at) {
+        auto& reserved_paths = reservedPaths();
+        // ファイルの有無の確認と予約の間に他のセッションが割り込まないよう、確認から予約までを1つのロックで行います。
+        std::lock_guard<std::mutex> lock(reserved_paths.mutex);
+        for (int attempt = 0;; attempt++) {
+            auto path = path_at(attempt);
+            auto key = toKey(path);
+            if (reserved_paths.keys.count(key) > 0) continue;
+            if (fs::exists(path)) continue;
+
+            reserved_paths.keys.insert(key);
+            std::lock_guard<std::mutex> own_lock(mutex_);
+            reserved_keys_.push_back(std::move(key));
+            return path;
+        }
+    }
+}
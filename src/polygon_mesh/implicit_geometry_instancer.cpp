@@ -0,0 +1,129 @@
+#include "implicit_geometry_instancer.h"
+#include "city_object_filter.h"
+#include <plateau/polygon_mesh/mesh_extractor.h>
+#include <plateau/polygon_mesh/mesh_factory.h>
+#include <plateau/polygon_mesh/polygon_mesh_utils.h>
+#include <plateau/polygon_mesh/primary_city_object_types.h>
+#include <citygml/cityobject.h>
+#include <citygml/geometry.h>
+#include <citygml/transformmatrix.h>
+
+namespace plateau::polygonMesh {
+    using namespace citygml;
+    using namespace plateau::geometry;
+
+    namespace {
+        void collectPolygons(const Geometry& geometry, const unsigned lod, std::vector<const Polygon*>& out_polygons) { // NOLINT(misc-no-recursion)
+            // 子のジオメトリのポリゴンを先に集めます。 CityObjectPolygonIndex と同じ順番です。
+            for (unsigned i = 0; i < geometry.getGeometriesCount(); i++) {
+                collectPolygons(geometry.getGeometry(i), lod, out_polygons);
+            }
+            if (geometry.getLOD() != lod) return;
+            for (unsigned i = 0; i < geometry.getPolygonsCount(); i++) {
+                out_polygons.push_back(geometry.getPolygon(i).get());
+            }
+        }
+    }
+
+    ImplicitGeometryInstancer::ImplicitGeometryInstancer(
+            const MeshExtractOptions& options, const std::vector<Extent>& extents, const GeoReference& geo_reference) :
+            options_(options),
+            extents_(extents),
+            geo_reference_(geo_reference),
+            extent_index_(extents) {
+    }
+
+    void ImplicitGeometryInstancer::extract(const CityModel& city_model, Model& out_model) {
+        texture_path_cache_.emplace(city_model);
+        prototypes_.clear();
+
+        const CityObjectFilter filter(options_);
+        const auto& primary_objects = city_model.getAllCityObjectsOfType(PrimaryCityObjectTypes::getPrimaryTypeMask());
+        for (const auto primary_object : primary_objects) {
+            if (!filter.passes(*primary_object)) continue;
+            if (MeshExtractor::isTypeToSkip(primary_object->getType())) continue;
+
+            addInstances(*primary_object, out_model);
+            for (const auto child : PolygonMeshUtils::getChildCityObjectsRecursive(*primary_object)) {
+                addInstances(*child, out_model);
+            }
+        }
+    }
+
+    void ImplicitGeometryInstancer::addInstances(const CityObject& city_object, Model& out_model) {
+        for (unsigned i = 0; i < city_object.getImplicitGeometryCount(); i++) {
+            const auto& implicit_geometry = city_object.getImplicitGeometry(i);
+            if (!extent_index_.contains(implicit_geometry.getReferencePoint())) continue;
+
+            std::optional<std::array<double, 16>> transform;
+            for (unsigned j = 0; j < implicit_geometry.getGeometriesCount(); j++) {
+                const auto& geometry = implicit_geometry.getGeometry(j);
+                for (auto lod = options_.min_lod; lod <= options_.max_lod; lod++) {
+                    const auto prototype_index = findOrCreatePrototype(geometry, lod, out_model);
+                    if (!prototype_index.has_value()) continue;
+                    // 変換行列は配置ごとに1回だけ求めます。
+                    if (!transform.has_value()) transform = computeTransform(implicit_geometry);
+                    out_model.addMeshInstance({prototype_index.value(), transform.value(), city_object.getId(), lod});
+                }
+            }
+        }
+    }
+
+    std::optional<size_t> ImplicitGeometryInstancer::findOrCreatePrototype(
+            const Geometry& geometry, const unsigned lod, Model& out_model) {
+        const auto key = std::make_pair(&geometry, lod);
+        const auto found = prototypes_.find(key);
+        if (found != prototypes_.end()) return found->second;
+
+        std::vector<const Polygon*> polygons;
+        collectPolygons(geometry, lod, polygons);
+
+        std::optional<size_t> prototype_index;
+        if (!polygons.empty()) {
+            MeshFactory mesh_factory(nullptr, options_, extents_, geo_reference_, nullptr, &texture_path_cache_.value());
+            for (const auto polygon : polygons) {
+                mesh_factory.addPolygonInLocalCoordinates(*polygon, texture_path_cache_->getGmlPath());
+            }
+            auto mesh = mesh_factory.releaseMesh();
+            if (mesh->hasVertices()) {
+                // プロトタイプは特定の地物に属さないため、 UV4 は頂点数に合わせて 0 で埋めます。 地物は MeshInstance::gml_id で区別します。
+                mesh->addUV4WithSameVal(TVec2f(0, 0), static_cast<long long>(mesh->getVertices().size()));
+                prototype_index = out_model.addInstancePrototype(std::move(mesh));
+            }
+        }
+        prototypes_.emplace(key, prototype_index);
+        return prototype_index;
+    }
+
+    std::array<double, 16> ImplicitGeometryInstancer::computeTransform(const ImplicitGeometry& implicit_geometry) const {
+        // GML では配置後の座標は referencePoint + M * (テンプレートの座標) であり、 M と テンプレートの座標はメートル単位の ENU です。
+        // プロトタイプの頂点 v は A(テンプレートの座標) / s なので (A: ENU から出力の座標軸への変換, s: unit_scale)、
+        // 出力の座標は project(referencePoint) + A * M_linear * A^-1 * v + A(M_translation) / s となります。
+        const auto* m = implicit_geometry.getTransformMatrix().getMatrix();
+        const auto axes = geo_reference_.getCoordinateSystem();
+        const auto applyLinear = [m](const TVec3d& v) {
+            return TVec3d(m[0] * v.x + m[1] * v.y + m[2] * v.z,
+                          m[4] * v.x + m[5] * v.y + m[6] * v.z,
+                          m[8] * v.x + m[9] * v.y + m[10] * v.z);
+        };
+
+        std::array<double, 16> transform{};
+        const TVec3d basis[3] = {TVec3d(1, 0, 0), TVec3d(0, 1, 0), TVec3d(0, 0, 1)};
+        for (int col = 0; col < 3; col++) {
+            const auto column = GeoReference::convertAxisFromENUTo(
+                    axes, applyLinear(GeoReference::convertAxisToENU(axes, basis[col])));
+            transform[col] = column.x;
+            transform[4 + col] = column.y;
+            transform[8 + col] = column.z;
+        }
+
+        const auto origin = geo_reference_.project(implicit_geometry.getReferencePoint());
+        const auto translation = GeoReference::convertAxisFromENUTo(axes, TVec3d(m[3], m[7], m[11])) /
+                                 static_cast<double>(geo_reference_.getUnitScale());
+        transform[3] = origin.x + translation.x;
+        transform[7] = origin.y + translation.y;
+        transform[11] = origin.z + translation.z;
+        transform[15] = 1;
+        return transform;
+    }
+}
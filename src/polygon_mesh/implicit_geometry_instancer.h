@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <citygml/citymodel.h>
+#include <citygml/implictgeometry.h>
+#include <plateau/polygon_mesh/model.h>
+#include <plateau/polygon_mesh/mesh_extract_options.h>
+#include <plateau/polygon_mesh/texture_path_cache.h>
+#include <plateau/geometry/geo_reference.h>
+#include <plateau/geometry/extent_index.h>
+
+namespace plateau::polygonMesh {
+
+    /**
+     * 都市オブジェクトの暗黙的ジオメトリ(ImplicitGeometry)を、頂点として展開せずに Model のインスタンスプロトタイプと配置として出力します。
+     *
+     * 同じ形状を参照する暗黙的ジオメトリは、libcitygml の中で同じ Geometry を共有します。
+     * そのため テンプレートの Geometry と LOD の組ごとに1つだけプロトタイプのメッシュを作り、配置ごとには変換行列だけを記録します。
+     * プロトタイプの頂点はテンプレートのローカル座標に、抽出設定の単位と座標軸の変換をしたものです。
+     * 配置の変換行列は、基準点 (referencePoint) と transformationMatrix を抽出設定の座標系に合わせたものです。
+     */
+    class ImplicitGeometryInstancer {
+    public:
+        ImplicitGeometryInstancer(const MeshExtractOptions& options, const std::vector<geometry::Extent>& extents,
+                                  const geometry::GeoReference& geo_reference);
+
+        /**
+         * city_model の主要地物とその子孫が持つ暗黙的ジオメトリを、 out_model にプロトタイプと配置として追加します。
+         * 主要地物の絞り込みは通常の抽出と同じ条件で行い、基準点が範囲外の配置は除外します。
+         */
+        void extract(const citygml::CityModel& city_model, Model& out_model);
+
+    private:
+        void addInstances(const citygml::CityObject& city_object, Model& out_model);
+
+        /// テンプレートの LOD lod のポリゴンからプロトタイプを作り、その番号を返します。ポリゴンがなければ nullopt を返します。
+        std::optional<size_t> findOrCreatePrototype(const citygml::Geometry& geometry, unsigned lod, Model& out_model);
+
+        std::array<double, 16> computeTransform(const citygml::ImplicitGeometry& implicit_geometry) const;
+
+        const MeshExtractOptions& options_;
+        const std::vector<geometry::Extent>& extents_;
+        const geometry::GeoReference& geo_reference_;
+        const geometry::ExtentIndex extent_index_;
+        /// extract の対象の GML ファイルについて作ります。
+        std::optional<TexturePathCache> texture_path_cache_;
+        /// テンプレートの Geometry と LOD の組から、プロトタイプの番号への対応です。ポリゴンがない組は nullopt です。
+        std::map<std::pair<const citygml::Geometry*, unsigned>, std::optional<size_t>> prototypes_;
+    };
+}
@@ -3,6 +3,7 @@
 #include <plateau/texture/texture_image_base.h>
 #include <plateau/texture/texture_packer.h>
 #include <cassert>
+#include <optional>
 
 namespace plateau::polygonMesh {
     namespace fs = std::filesystem;
@@ -68,10 +69,23 @@ namespace plateau::polygonMesh {
 
     }
 
-    int MapAttacher::attach(Model& model, const std::string& map_url_template, const std::filesystem::path& map_download_dest, const int zoom_level, const GeoReference& geo_reference) {
+    int MapAttacher::attach(Model& model, const std::string& map_url_template, const std::filesystem::path& map_download_dest, const int zoom_level, const GeoReference& geo_reference,
+                            const ExtractProgress* progress, ExtractSession* session) {
+        // セッションが渡されなければ、この呼び出しの間だけ有効なセッションを作ります。
+        std::optional<ExtractSession> own_session;
+        if(session == nullptr) {
+            own_session.emplace();
+            session = &own_session.value();
+        }
         int success_load_tile_count = 0;
         auto meshes = model.getAllMeshes();
+        if(progress != nullptr) progress->report(ExtractStage::MapAttach, ExtractProgress::no_lod, 0, meshes.size());
         for(int i=0; i<meshes.size(); i++) {
+            if(progress != nullptr) {
+                progress->throwIfCancelled();
+                // 前のメッシュまでの処理が終わったことを通知します。途中の continue で通知が漏れないよう、ループの先頭で行います。
+                if(i > 0) progress->report(ExtractStage::MapAttach, ExtractProgress::no_lod, i, meshes.size());
+            }
             auto mesh = meshes.at(i);
             if(mesh->getVertices().empty()) continue;
 
@@ -108,7 +122,8 @@ namespace plateau::polygonMesh {
             size_t combined_image_height = tile_image_height * (max_row - min_row + 1);
 
             // タイルを結合します。
-            auto packer = TexturePacker(combined_image_width, combined_image_height);
+            auto packer = TexturePacker(combined_image_width, combined_image_height,
+                                        TexturePacker::default_internal_canvas_count, session);
             auto combined_tile_dir = fs::u8path(tiles.firstSucceed().image_path)
                     .remove_filename()
                     .parent_path()
@@ -118,16 +133,15 @@ namespace plateau::polygonMesh {
             std::string combined_file_name;
             fs::path combined_image_path;
 
-            // 同名のファイルがあったとき上書きしたくないので、同名でなくなるまでファイル名の番号を上げます
-            for(int attempt=0; attempt<999; attempt++){
+            // 同名のファイルがあったとき上書きしたくないので、同名でなくなるまでファイル名の番号を上げます。
+            // 同時に実行中の他の抽出と同じ名前にならないよう、セッションで名前を予約します。
+            combined_image_path = session->reserveUniquePath([&](const int attempt) {
                 // ファイル名は combined_map_mesh(mesh番号)_v(バージョン番号,基本は0だが同名のがすでにあれば増える)_p0 (pはpart、1枚にまとめるので基本0のはず)
+                // 予約されたパスは最後に求めたものなので、 combined_file_name もそれに対応します。
                 combined_file_name = "combined_map_mesh" + std::to_string(i) + "_v" + std::to_string(attempt) + "_p";
                 // FIXME 下の ".png" の決め打ちはあまり良くない
-                combined_image_path = fs::path(combined_tile_dir) / fs::u8path(combined_file_name + "0.png");
-                if(!fs::exists(combined_image_path)){
-                    break;
-                }
-            }
+                return fs::path(combined_tile_dir) / fs::u8path(combined_file_name + "0.png");
+            });
             packer.setSaveFilePath(combined_tile_dir, combined_file_name);
             for (auto r = min_row; r <= max_row; r++) {
                 for (auto c = min_col; c <= max_col; c++) {
@@ -162,6 +176,7 @@ namespace plateau::polygonMesh {
                 sub_mesh.setTexturePath(combined_image_path.u8string());
             }
         }
+        if(progress != nullptr && !meshes.empty()) progress->report(ExtractStage::MapAttach, ExtractProgress::no_lod, meshes.size(), meshes.size());
         return success_load_tile_count;
     }
 }
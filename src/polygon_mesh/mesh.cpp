@@ -3,10 +3,30 @@
 
 #include "citygml/texture.h"
 #include "citygml/cityobject.h"
+#include <algorithm>
 
 namespace plateau::polygonMesh {
     using namespace citygml;
 
+    namespace {
+        /// std::equal_range で CityObjectRange と検索する値を比べるために、それぞれから比較の基準となる値を取り出します。
+        const CityObjectIndex& toCityObjectIndex(const CityObjectRange& range) {
+            return range.city_object_index;
+        }
+
+        const CityObjectIndex& toCityObjectIndex(const CityObjectIndex& index) {
+            return index;
+        }
+
+        int toPrimaryIndex(const CityObjectRange& range) {
+            return range.city_object_index.primary_index;
+        }
+
+        int toPrimaryIndex(const int primary_index) {
+            return primary_index;
+        }
+    }
+
     Mesh::Mesh()
         : uv1_(UV())
         , uv4_(UV()) {
@@ -96,6 +116,7 @@ namespace plateau::polygonMesh {
         if (other_indices.size() % 3 != 0) {
             throw std::runtime_error("size of other_indices must be multiple of 3.");
         }
+        city_object_ranges_.clear();
 
         // インデックスリストの末尾に追加します。
         // 以前の頂点の数だけインデックスの数値を大きくします。
@@ -119,6 +140,13 @@ namespace plateau::polygonMesh {
         }
     }
 
+    void Mesh::invertMeshFrontBack() {
+        // 三角形ごとに1番目と3番目の頂点を入れ替えます。
+        for (size_t i = 0; i + 2 < indices_.size(); i += 3) {
+            std::swap(indices_[i], indices_[i + 2]);
+        }
+    }
+
 
     void Mesh::setUV1(UV&& uv) {
         uv1_ = std::move(uv);
@@ -154,8 +182,8 @@ namespace plateau::polygonMesh {
 
     void Mesh::addSubMesh(const std::string& texture_path, std::shared_ptr<const citygml::Material> material, size_t sub_mesh_start_index, size_t sub_mesh_end_index, int game_material_id) {
         // テクスチャが異なる場合は追加します。
-        // TODO テクスチャありのポリゴン と なしのポリゴン が交互にマージされることで、テクスチャなしのサブメッシュが大量に生成されるので描画負荷に改善の余地ありです。
-        //      テクスチャなしのサブメッシュは1つにまとめたいところです。テクスチャなしのポリゴンを連続してマージすることで1つにまとまるはずです。
+        // テクスチャありのポリゴン と なしのポリゴン が交互にマージされると、テクスチャなしのサブメッシュが大量に生成されます。
+        // それらを1つにまとめるには、追加し終わった後で coalesceSubMeshes を呼びます。
 
         // 前と同じマテリアルかどうか判定します。
         bool are_materials_same;
@@ -177,6 +205,63 @@ namespace plateau::polygonMesh {
         }
     }
 
+    void Mesh::coalesceSubMeshes() {
+        if (sub_meshes_.size() <= 1) return;
+
+        // 各 SubMesh を、同じマテリアルを持つ最初の SubMesh のグループに振り分けます。
+        // グループの番号は、そのマテリアルが最初に現れた順です。
+        std::vector<size_t> group_leaders; // グループの先頭の SubMesh の番号
+        std::vector<std::vector<size_t>> group_members;
+        for (size_t i = 0; i < sub_meshes_.size(); i++) {
+            size_t group = 0;
+            while (group < group_leaders.size() && !sub_meshes_.at(group_leaders.at(group)).isSameAs(sub_meshes_.at(i))) {
+                group++;
+            }
+            if (group == group_leaders.size()) {
+                group_leaders.push_back(i);
+                group_members.emplace_back();
+            }
+            group_members.at(group).push_back(i);
+        }
+        // まとめられる SubMesh がなければ何もしません。
+        if (group_leaders.size() == sub_meshes_.size()) return;
+
+        // どの SubMesh にも含まれない indices を記録します。
+        std::vector<bool> is_covered(indices_.size(), false);
+        for (const auto& sub_mesh : sub_meshes_) {
+            const auto end = std::min(sub_mesh.getEndIndex() + 1, indices_.size());
+            for (auto i = sub_mesh.getStartIndex(); i < end; i++) {
+                is_covered[i] = true;
+            }
+        }
+
+        // グループごとに、属する SubMesh の範囲を元の順番でつなげます。
+        std::vector<unsigned> new_indices;
+        new_indices.reserve(indices_.size());
+        std::vector<SubMesh> new_sub_meshes;
+        new_sub_meshes.reserve(group_leaders.size());
+        for (size_t group = 0; group < group_leaders.size(); group++) {
+            const auto start = new_indices.size();
+            for (const auto member : group_members.at(group)) {
+                const auto& sub_mesh = sub_meshes_.at(member);
+                const auto end = std::min(sub_mesh.getEndIndex() + 1, indices_.size());
+                if (sub_mesh.getStartIndex() >= end) continue;
+                new_indices.insert(new_indices.end(), indices_.begin() + sub_mesh.getStartIndex(), indices_.begin() + end);
+            }
+            if (new_indices.size() == start) continue;
+            const auto& leader = sub_meshes_.at(group_leaders.at(group));
+            new_sub_meshes.emplace_back(start, new_indices.size() - 1, leader.getTexturePath(),
+                                        leader.getMaterial(), leader.getGameMaterialID());
+        }
+        for (size_t i = 0; i < indices_.size(); i++) {
+            if (!is_covered[i]) new_indices.push_back(indices_[i]);
+        }
+
+        indices_ = std::move(new_indices);
+        sub_meshes_ = std::move(new_sub_meshes);
+        city_object_ranges_.clear();
+    }
+
     void Mesh::extendLastSubMesh(size_t sub_mesh_end_index) {
         if (sub_meshes_.empty()) {
             sub_meshes_.emplace_back(0, sub_mesh_end_index, "", nullptr);
@@ -218,6 +303,80 @@ namespace plateau::polygonMesh {
 
     void Mesh::merge(const Mesh& other_mesh, const bool invert_mesh_front_back, const bool include_textures) {
         MeshMerger::mergeMesh(*this, other_mesh, invert_mesh_front_back, include_textures);
+        city_object_ranges_.clear();
+    }
+
+    void Mesh::buildCityObjectRanges() {
+        city_object_ranges_.clear();
+
+        // SubMesh の先頭の位置です。範囲はここで必ず区切ります。
+        std::vector<size_t> sub_mesh_starts;
+        sub_mesh_starts.reserve(sub_meshes_.size());
+        for (const auto& sub_mesh : sub_meshes_) {
+            sub_mesh_starts.push_back(sub_mesh.getStartIndex());
+        }
+        std::sort(sub_mesh_starts.begin(), sub_mesh_starts.end());
+        auto next_sub_mesh_start = sub_mesh_starts.begin();
+
+        for (size_t i = 0; i + 2 < indices_.size(); i += 3) {
+            const auto first_vertex = indices_[i];
+            const auto city_object_index = first_vertex < uv4_.size()
+                                           ? CityObjectIndex::fromUV(uv4_[first_vertex])
+                                           : CityObjectIndex(0, 0);
+
+            bool is_sub_mesh_boundary = false;
+            while (next_sub_mesh_start != sub_mesh_starts.end() && *next_sub_mesh_start <= i) {
+                is_sub_mesh_boundary = true;
+                next_sub_mesh_start++;
+            }
+
+            if (is_sub_mesh_boundary || city_object_ranges_.empty() ||
+                !(city_object_ranges_.back().city_object_index == city_object_index)) {
+                const auto& vertex = vertices_.at(first_vertex);
+                city_object_ranges_.push_back({city_object_index, static_cast<unsigned>(i), 0, vertex, vertex});
+            }
+
+            auto& range = city_object_ranges_.back();
+            range.index_count += 3;
+            for (size_t j = i; j < i + 3; j++) {
+                const auto& vertex = vertices_.at(indices_[j]);
+                range.bounds_min.x = std::min(range.bounds_min.x, vertex.x);
+                range.bounds_min.y = std::min(range.bounds_min.y, vertex.y);
+                range.bounds_min.z = std::min(range.bounds_min.z, vertex.z);
+                range.bounds_max.x = std::max(range.bounds_max.x, vertex.x);
+                range.bounds_max.y = std::max(range.bounds_max.y, vertex.y);
+                range.bounds_max.z = std::max(range.bounds_max.z, vertex.z);
+            }
+        }
+
+        // 地物ごとに範囲を引けるよう、 CityObjectIndex の順に並べます。同じ地物の中では indices の順を保ちます。
+        std::sort(city_object_ranges_.begin(), city_object_ranges_.end(),
+                  [](const CityObjectRange& a, const CityObjectRange& b) {
+                      if (a.city_object_index == b.city_object_index) return a.index_start < b.index_start;
+                      return a.city_object_index < b.city_object_index;
+                  });
+    }
+
+    const std::vector<CityObjectRange>& Mesh::getCityObjectRanges() const {
+        return city_object_ranges_;
+    }
+
+    std::pair<size_t, size_t> Mesh::findCityObjectRanges(const CityObjectIndex& city_object_index) const {
+        const auto found = std::equal_range(
+                city_object_ranges_.begin(), city_object_ranges_.end(), city_object_index,
+                [](const auto& a, const auto& b) {
+                    return toCityObjectIndex(a) < toCityObjectIndex(b);
+                });
+        return {found.first - city_object_ranges_.begin(), found.second - found.first};
+    }
+
+    std::pair<size_t, size_t> Mesh::findPrimaryCityObjectRanges(const int primary_index) const {
+        const auto found = std::equal_range(
+                city_object_ranges_.begin(), city_object_ranges_.end(), primary_index,
+                [](const auto& a, const auto& b) {
+                    return toPrimaryIndex(a) < toPrimaryIndex(b);
+                });
+        return {found.first - city_object_ranges_.begin(), found.second - found.first};
     }
 
 
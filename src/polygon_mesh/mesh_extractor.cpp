@@ -2,12 +2,20 @@
 #include <plateau/polygon_mesh/primary_city_object_types.h>
 #include "citygml/texture.h"
 #include "area_mesh_factory.h"
+#include "city_object_filter.h"
+#include "implicit_geometry_instancer.h"
+#include "model_tile_splitter.h"
+#include "thread_pool.h"
 #include "citygml/cityobject.h"
 #include "plateau/polygon_mesh/map_attacher.h"
+#include <plateau/polygon_mesh/relief_rasterizer.h>
 #include <plateau/polygon_mesh/mesh_factory.h>
 #include <plateau/polygon_mesh/polygon_mesh_utils.h>
 #include <plateau/dataset/gml_file.h>
 #include <plateau/texture/texture_packer.h>
+#include <optional>
+#include <functional>
+#include <atomic>
 
 namespace {
     using namespace plateau;
@@ -16,144 +24,507 @@ namespace {
     using namespace texture;
     namespace fs = std::filesystem;
 
-    bool shouldSkipCityObj(const citygml::CityObject& city_obj, const MeshExtractOptions& options, const std::vector<geometry::Extent>& extents) {
+    bool shouldSkipCityObj(const citygml::CityObject& city_obj, const MeshExtractOptions& options, const std::vector<geometry::Extent>& extents,
+                           const CityObjectBoundsCache& bounds_cache) {
 
         // 範囲内であっても、COT_Roomは意図的に省きます。なぜなら、LOD4の建物においてRoomと天井、床等が完全に重複するのをなくしたいからです。
         if(city_obj.getType() == citygml::CityObject::CityObjectsType::COT_Room) return true;
 
-        // 範囲外を省く設定ならば省きます。
+        // 範囲外を省く設定ならば省きます。位置不明のものは範囲外とみなします。
         if (!options.exclude_city_object_outside_extent)
             return false;
 
+        const auto position = bounds_cache.findPosition(city_obj);
+        if (!position.has_value())
+            return true;
+
         for (const auto& extent : extents) {
-            if (extent.contains(city_obj))
+            if (extent.contains(position.value()))
                 return false;
         }
 
         return true;
     }
 
-    void extractInner(
-        Model& out_model, const citygml::CityModel& city_model,
-        const MeshExtractOptions& options,
-        const std::vector<geometry::Extent>& extents) {
+    /**
+     * city_model の主要地物のうち、範囲外やスキップ対象のもの、型や属性による絞り込みの条件に合わないものを除いて
+     * メッシュ抽出の対象となるものを返します。
+     * 順番は city_model 内での順番と同じです。
+     * 絞り込みの条件に合う主要地物の位置を out_bounds_cache に記録し、範囲外かどうかの判定に使います。
+     */
+    std::vector<const citygml::CityObject*> listPrimaryObjectsToExtract(
+        const citygml::CityModel& city_model, const MeshExtractOptions& options,
+        const std::vector<geometry::Extent>& extents, const ThreadPool& thread_pool, CityObjectBoundsCache& out_bounds_cache) {
+
+        auto& all_primary_city_objects_in_model =
+            city_model.getAllCityObjectsOfType(PrimaryCityObjectTypes::getPrimaryTypeMask());
+
+        // 型や属性の条件に合わなければスキップします。位置の計算より先に判定し、除外する地物のジオメトリは読みません。
+        const CityObjectFilter filter(options);
+        std::vector<const citygml::CityObject*> candidates;
+        candidates.reserve(all_primary_city_objects_in_model.size());
+        for (auto primary_object : all_primary_city_objects_in_model) {
+            if (!filter.passes(*primary_object))
+                continue;
+            if (MeshExtractor::isTypeToSkip(primary_object->getType())) continue;
+            candidates.push_back(primary_object);
+        }
 
-        if (options.max_lod < options.min_lod) throw std::logic_error("Invalid LOD range.");
+        // 位置は地物ごとに1回だけ求め、範囲外の判定とグリッドへの分類で共有します。どちらも行わない場合は求めません。
+        if (options.exclude_city_object_outside_extent || options.mesh_granularity == MeshGranularity::PerCityModelArea) {
+            out_bounds_cache.build(candidates, thread_pool);
+        }
 
-        const auto geo_reference = geometry::GeoReference(options.coordinate_zone_id, options.reference_point, options.unit_scale, options.mesh_axes);
+        std::vector<const citygml::CityObject*> primary_objects;
+        primary_objects.reserve(candidates.size());
+        for (auto primary_object : candidates) {
+            // 範囲外ならスキップします。
+            if (shouldSkipCityObj(*primary_object, options, extents, out_bounds_cache))
+                continue;
+            primary_objects.push_back(primary_object);
+        }
+        return primary_objects;
+    }
 
-        // rootNode として LODノード を作ります。
-        for (unsigned lod = options.min_lod; lod <= options.max_lod; lod++) {
-            auto lod_node = Node("LOD" + std::to_string(lod));
-
-            // LODノードの下にメッシュ配置用ノードを作ります。
-            switch (options.mesh_granularity) {
-            case MeshGranularity::PerCityModelArea:
-            {
-                // 次のような階層構造を作ります:
-                // model -> LODノード -> グループごとのノード
-
-                // 3D都市モデルをグループに分け、グループごとにメッシュをマージします。
-                auto result = AreaMeshFactory::gridMerge(city_model, options, lod, geo_reference, extents);
-                // グループごとのノードを追加します。
-                for (auto& [group_id, mesh] : result) {
-                    auto node = Node("group" + std::to_string(group_id), std::move(mesh));
-                    lod_node.addChildNode(std::move(node));
-                }
+    /**
+     * 主要地物単位のメッシュを作ります。
+     * LOD2以上では、主要地物の子である最小地物もメッシュに含めます。
+     */
+    std::unique_ptr<Mesh> createPrimaryMesh(
+        const citygml::CityObject& primary_object, const unsigned lod, const citygml::CityModel& city_model,
+        const MeshExtractOptions& options, const std::vector<geometry::Extent>& extents,
+        const geometry::GeoReference& geo_reference, const CityObjectPolygonIndex& polygon_index,
+        TexturePathCache& texture_path_cache, const geometry::ExtentIndex& extent_index) {
+
+        MeshFactory mesh_factory(nullptr, options, extents, geo_reference, &polygon_index, &texture_path_cache, &extent_index);
+
+        if (MeshExtractor::shouldContainPrimaryMesh(lod, primary_object)) {
+            mesh_factory.addPolygonsInPrimaryCityObject(primary_object, lod, city_model.getGmlPath());
+        }
+
+        if (lod >= 2) {
+            // 主要地物の子である各最小地物をメッシュに加えます。
+            auto atomic_objects = PolygonMeshUtils::getChildCityObjectsRecursive(primary_object);
+            mesh_factory.addPolygonsInAtomicCityObjects(primary_object, atomic_objects, lod, city_model.getGmlPath());
+        }
+
+        return mesh_factory.releaseMesh();
+    }
+
+    /**
+     * 最小地物単位で、主要地物のノードとその子の最小地物ごとのノードを作ります。
+     */
+    Node createPrimaryNodeWithAtomicChildren(
+        const citygml::CityObject& primary_city_object, const unsigned lod, const citygml::CityModel& city_model,
+        const MeshExtractOptions& options, const std::vector<geometry::Extent>& extents,
+        const geometry::GeoReference& geo_reference, const CityObjectPolygonIndex& polygon_index,
+        TexturePathCache& texture_path_cache, const geometry::ExtentIndex& extent_index) {
+
+        // 主要地物のノードを作成します。
+        std::unique_ptr<Mesh> primary_mesh;
+        MeshFactory primary_mesh_factory(nullptr, options, extents, geo_reference, &polygon_index, &texture_path_cache, &extent_index);
+        if (MeshExtractor::shouldContainPrimaryMesh(lod, primary_city_object)) {
+            primary_mesh_factory.addPolygonsInPrimaryCityObject(primary_city_object, lod, city_model.getGmlPath());
+            primary_mesh = primary_mesh_factory.releaseMesh();
+        }
+        auto primary_node = Node(primary_city_object.getId(), std::move(primary_mesh));
+
+        // 最小地物ごとにノードを作成
+        auto atomic_objects = PolygonMeshUtils::getChildCityObjectsRecursive(primary_city_object);
+        for (auto atomic_object : atomic_objects) {
+            if(MeshExtractor::isTypeToSkip(atomic_object->getType())) continue;
+            MeshFactory atomic_mesh_factory(nullptr, options, extents, geo_reference, &polygon_index, &texture_path_cache, &extent_index);
+            atomic_mesh_factory.addPolygonsInAtomicCityObject(
+                primary_city_object, *atomic_object,
+                lod, city_model.getGmlPath());
+            auto atomic_node = Node(atomic_object->getId(), atomic_mesh_factory.releaseMesh());
+            primary_node.addChildNode(std::move(atomic_node));
+        }
+        return primary_node;
+    }
+
+    /**
+     * 主要地物ごとに並列に処理するときに、LODごとの処理済みの数を数えて progress に通知します。
+     * progress が nullptr のときは何もしません。
+     */
+    class LodProgressCounter {
+    public:
+        LodProgressCounter(const ExtractProgress* progress, const unsigned min_lod, const unsigned lod_count, const size_t object_count) :
+            progress_(progress),
+            min_lod_(min_lod),
+            object_count_(object_count),
+            processed_counts_(new std::atomic<size_t>[lod_count]()) {
+            if (progress_ == nullptr) return;
+            for (unsigned lod_index = 0; lod_index < lod_count; lod_index++) {
+                progress_->report(ExtractStage::Geometry, min_lod_ + lod_index, 0, object_count_);
             }
-            break;
-            case MeshGranularity::PerPrimaryFeatureObject:
-            {
-                // 次のような階層構造を作ります：
-                // model -> LODノード -> 主要地物ごとのノード
-
-                auto& all_primary_city_objects_in_model =
-                    city_model.getAllCityObjectsOfType(PrimaryCityObjectTypes::getPrimaryTypeMask());
-
-                // 主要地物ごとにメッシュを結合します。
-                for (auto primary_object : all_primary_city_objects_in_model) {
-                    // 範囲外ならスキップします。
-                    if (shouldSkipCityObj(*primary_object, options, extents))
-                        continue;
-                    if (MeshExtractor::isTypeToSkip(primary_object->getType())) continue;
-
-                    // 主要地物のメッシュを作ります。
-                    MeshFactory mesh_factory(nullptr, options, extents, geo_reference);
-                    
-                    if (MeshExtractor::shouldContainPrimaryMesh(lod, *primary_object)) {
-                        mesh_factory.addPolygonsInPrimaryCityObject(*primary_object, lod, city_model.getGmlPath());
-                    }
-
-                    if (lod >= 2) {
-                        // 主要地物の子である各最小地物をメッシュに加えます。
-                        auto atomic_objects = PolygonMeshUtils::getChildCityObjectsRecursive(*primary_object);
-                        mesh_factory.addPolygonsInAtomicCityObjects(*primary_object, atomic_objects, lod, city_model.getGmlPath());
-                    }
-
-                    // 主要地物ごとのノードを追加します。
-                    lod_node.addChildNode(Node(primary_object->getId(), mesh_factory.releaseMesh()));
-                    mesh_factory.incrementPrimaryIndex();
+        }
+
+        void throwIfCancelled() const {
+            if (progress_ != nullptr) progress_->throwIfCancelled();
+        }
+
+        void countUp(const unsigned lod_index) const {
+            if (progress_ == nullptr) return;
+            const auto processed = ++processed_counts_[lod_index];
+            progress_->report(ExtractStage::Geometry, min_lod_ + lod_index, processed, object_count_);
+        }
+
+    private:
+        const ExtractProgress* progress_;
+        unsigned min_lod_;
+        size_t object_count_;
+        std::unique_ptr<std::atomic<size_t>[]> processed_counts_;
+    };
+
+    /// 構築が終わったノードを、そのノードが属するLODの番号 (min_lod から数えて何番目か) とともに受け取る関数です。
+    using LodNodeSink = std::function<void(unsigned lod_index, Node&& node)>;
+
+    /**
+     * 0 から task_count - 1 までの各タスクでノードを作り、タスクの順番で on_created に渡します。
+     * ノードは並列に作り、先頭のノードができ次第 on_created に渡して次のタスクに進むため、
+     * 同時にメモリ上にある作成済みのノードは window_size 個程度です。
+     * window_size が 0 のときは全タスクを一度に処理します。
+     */
+    void createNodesInOrder(const ThreadPool& thread_pool, const size_t task_count, const size_t window_size,
+                            const std::function<Node(size_t task_index)>& create_node,
+                            const std::function<void(size_t task_index, Node&& node)>& on_created) {
+        const auto window = window_size == 0 ? task_count : std::min(window_size, task_count);
+        std::vector<std::optional<Node>> nodes(window);
+        thread_pool.parallelForInOrder(task_count, window,
+            [&](size_t task_index) {
+                nodes.at(task_index % window).emplace(create_node(task_index));
+            },
+            [&](size_t task_index) {
+                auto& node = nodes.at(task_index % window);
+                on_created(task_index, std::move(node.value()));
+                node.reset();
+            });
+    }
+
+    /**
+     * LODノードの子となるノードを構築し、LODの順、LOD内では Model に並べる順に sink に渡します。
+     * streaming が true のときは、作り終えたノードから順番に sink に渡し、作成済みで渡していないノードをスレッド数程度に抑えます。
+     * そうでなければ全ノードを作り終えてから渡します。
+     * progress が nullptr でなければ、主要地物を1つ処理するたびに進捗を通知し、中断が要求されていれば ExtractCancelledException を投げます。
+     */
+    void extractNodes(
+        const citygml::CityModel& city_model, const MeshExtractOptions& options,
+        const std::vector<geometry::Extent>& extents, const geometry::GeoReference& geo_reference,
+        const bool streaming, const LodNodeSink& sink, const ExtractProgress* progress) {
+
+        if (options.max_lod < options.min_lod) throw std::logic_error("Invalid LOD range.");
+
+        const auto thread_pool = ThreadPool(options.thread_count);
+        const size_t window_size = streaming ? thread_pool.getThreadCount() : 0;
+        const unsigned lod_count = options.max_lod - options.min_lod + 1;
+
+        // 範囲外かどうかはLODによらないため、全LODで同じ判定結果を使います。
+        CityObjectBoundsCache bounds_cache;
+        const auto primary_objects = listPrimaryObjectsToExtract(city_model, options, extents, thread_pool, bounds_cache);
+        const auto object_count = primary_objects.size();
+
+        // 各地物の Geometry を1回だけ走査し、ポリゴンをLODごとに振り分けておきます。
+        // 以降は LOD ごとに Geometry を走査し直す代わりにこの索引を引きます。
+        CityObjectPolygonIndex polygon_index;
+        polygon_index.build(primary_objects, thread_pool);
+
+        // 同じテクスチャを参照するポリゴンが多いため、テクスチャパスの変換結果を抽出全体で共有します。
+        TexturePathCache texture_path_cache(city_model);
+
+        // 範囲外のポリゴンを除外する際に、頂点ごとに全範囲と比較しなくて済むよう索引を作ります。
+        const auto extent_index = geometry::ExtentIndex(extents);
+
+        // LODノードの下にメッシュ配置用ノードを作ります。
+        // 各LODは互いに独立しているため、LODを1つずつ順番に処理するのではなく、すべてのLODを同時に構築します。
+        switch (options.mesh_granularity) {
+        case MeshGranularity::PerCityModelArea:
+        {
+            // 次のような階層構造を作ります:
+            // model -> LODノード -> グループごとのノード
+
+            if (streaming) {
+                // 同時にメモリ上にあるメッシュを抑えるため、LODを順番に処理し、LOD内のグループを並列に結合します。
+                for (unsigned lod_index = 0; lod_index < lod_count; lod_index++) {
+                    const auto lod = options.min_lod + lod_index;
+                    AreaMeshFactory::gridMergeStreaming(
+                        city_model, options, lod, geo_reference, extents,
+                        [&](const unsigned group_id, std::unique_ptr<Mesh>&& mesh) {
+                            sink(lod_index, Node("group" + std::to_string(group_id), std::move(mesh)));
+                        },
+                        window_size, &polygon_index, &thread_pool, &texture_path_cache, &extent_index, &bounds_cache, progress);
                 }
+                break;
             }
-            break;
-            case MeshGranularity::PerAtomicFeatureObject:
-            {
-                // 次のような階層構造を作ります：
-                // model -> LODノード -> 主要地物ごとのノード -> その子の最小地物ごとのノード
-                auto& primary_city_objects = city_model.getAllCityObjectsOfType(
-                        PrimaryCityObjectTypes::getPrimaryTypeMask());
-                for (auto primary_city_object : primary_city_objects) {
-                    // 範囲外ならスキップします。
-                    if (shouldSkipCityObj(*primary_city_object, options, extents))
-                        continue;
-                    if (MeshExtractor::isTypeToSkip(primary_city_object->getType())) continue;
-
-                    // 主要地物のノードを作成します。
-                    std::unique_ptr<Mesh> primary_mesh;
-                    MeshFactory primary_mesh_factory(nullptr, options, extents, geo_reference);
-                    if (MeshExtractor::shouldContainPrimaryMesh(lod, *primary_city_object)) {
-                        primary_mesh_factory.addPolygonsInPrimaryCityObject(*primary_city_object, lod, city_model.getGmlPath());
-                        primary_mesh = primary_mesh_factory.releaseMesh();
-                    }
-                    auto primary_node = Node(primary_city_object->getId(), std::move(primary_mesh));
-
-                    // 最小地物ごとにノードを作成
-                    auto atomic_objects = PolygonMeshUtils::getChildCityObjectsRecursive(*primary_city_object);
-                    for (auto atomic_object : atomic_objects) {
-                        if(MeshExtractor::isTypeToSkip(atomic_object->getType())) continue;
-                        MeshFactory atomic_mesh_factory(nullptr, options, extents, geo_reference);
-                        atomic_mesh_factory.addPolygonsInAtomicCityObject(
-                            *primary_city_object, *atomic_object,
-                            lod, city_model.getGmlPath());
-                        auto atomic_node = Node(atomic_object->getId(), atomic_mesh_factory.releaseMesh());
-                        primary_node.addChildNode(std::move(atomic_node));
-                    }
-                    lod_node.addChildNode(std::move(primary_node));
-                    primary_mesh_factory.incrementPrimaryIndex();
+
+            // 3D都市モデルをグループに分け、グループごとにメッシュをマージします。
+            std::vector<GridMergeResult> results(lod_count);
+            thread_pool.parallelFor(lod_count, [&](size_t lod_index) {
+                const auto lod = options.min_lod + static_cast<unsigned>(lod_index);
+                results.at(lod_index) = AreaMeshFactory::gridMerge(city_model, options, lod, geo_reference, extents, &polygon_index, &thread_pool, &texture_path_cache, &extent_index, &bounds_cache, progress);
+            });
+            // グループごとのノードを追加します。
+            for (unsigned lod_index = 0; lod_index < lod_count; lod_index++) {
+                for (auto& [group_id, mesh] : results.at(lod_index)) {
+                    sink(lod_index, Node("group" + std::to_string(group_id), std::move(mesh)));
                 }
             }
-            break;
-            default:
-                throw std::logic_error("Unknown enum type of options.mesh_granularity .");
+        }
+        break;
+        case MeshGranularity::PerPrimaryFeatureObject:
+        {
+            // 次のような階層構造を作ります：
+            // model -> LODノード -> 主要地物ごとのノード
+
+            // (LOD, 主要地物) の組ごとにメッシュを結合します。それぞれ独立しているため、全LODの全主要地物をまとめて並列に処理します。
+            // スレッド数によらず同じ順番になるよう、元の順番で渡します。
+            const LodProgressCounter progress_counter(progress, options.min_lod, lod_count, object_count);
+            createNodesInOrder(thread_pool, lod_count * object_count, window_size,
+                [&](size_t task_index) {
+                    progress_counter.throwIfCancelled();
+                    const auto lod_index = static_cast<unsigned>(task_index / object_count);
+                    const auto& primary_object = *primary_objects.at(task_index % object_count);
+                    auto node = Node(primary_object.getId(),
+                                     createPrimaryMesh(primary_object, options.min_lod + lod_index, city_model, options, extents, geo_reference, polygon_index, texture_path_cache, extent_index));
+                    progress_counter.countUp(lod_index);
+                    return node;
+                },
+                [&](size_t task_index, Node&& node) {
+                    sink(static_cast<unsigned>(task_index / object_count), std::move(node));
+                });
+        }
+        break;
+        case MeshGranularity::PerAtomicFeatureObject:
+        {
+            // 次のような階層構造を作ります：
+            // model -> LODノード -> 主要地物ごとのノード -> その子の最小地物ごとのノード
+
+            const LodProgressCounter progress_counter(progress, options.min_lod, lod_count, object_count);
+            createNodesInOrder(thread_pool, lod_count * object_count, window_size,
+                [&](size_t task_index) {
+                    progress_counter.throwIfCancelled();
+                    const auto lod_index = static_cast<unsigned>(task_index / object_count);
+                    const auto& primary_object = *primary_objects.at(task_index % object_count);
+                    auto node = createPrimaryNodeWithAtomicChildren(primary_object, options.min_lod + lod_index, city_model, options, extents, geo_reference, polygon_index, texture_path_cache, extent_index);
+                    progress_counter.countUp(lod_index);
+                    return node;
+                },
+                [&](size_t task_index, Node&& node) {
+                    sink(static_cast<unsigned>(task_index / object_count), std::move(node));
+                });
+        }
+        break;
+        default:
+            throw std::logic_error("Unknown enum type of options.mesh_granularity .");
+        }
+    }
+
+    /// node 以下のすべてのメッシュについて、マテリアルごとに SubMesh をまとめます。
+    void coalesceSubMeshesRecursive(const Node& node) {
+        if (node.getMesh() != nullptr) node.getMesh()->coalesceSubMeshes();
+        for (size_t i = 0; i < node.getChildCount(); i++) {
+            coalesceSubMeshesRecursive(node.getChildAt(i));
+        }
+    }
+
+    /// node 以下のすべてのメッシュについて、地物ごとの三角形の範囲の表を作ります。
+    void buildCityObjectRangesRecursive(const Node& node) {
+        if (node.getMesh() != nullptr) node.getMesh()->buildCityObjectRanges();
+        for (size_t i = 0; i < node.getChildCount(); i++) {
+            buildCityObjectRangesRecursive(node.getChildAt(i));
+        }
+    }
+
+    /// model のすべてのメッシュとインスタンスプロトタイプについて、地物ごとの三角形の範囲の表を作ります。
+    void buildCityObjectRanges(Model& model) {
+        for (const auto mesh : model.getAllMeshes()) {
+            mesh->buildCityObjectRanges();
+        }
+        for (size_t i = 0; i < model.getInstancePrototypeCount(); i++) {
+            model.getInstancePrototypeAt(i).buildCityObjectRanges();
+        }
+    }
+
+    /// 地形の地図タイルを保存する場所を返します。
+    fs::path getMapDownloadDest(const citygml::CityModel& city_model) {
+        const auto gml_path = fs::u8path(city_model.getGmlPath());
+        return gml_path.parent_path() / (gml_path.filename().u8string() + "_map");
+    }
+
+    /// 現在の都市モデルが地形であり、設定で有効であれば、地図タイルを貼り付けるべきとして true を返します。
+    bool shouldAttachMapTile(const citygml::CityModel& city_model, const MeshExtractOptions& options) {
+        auto package = GmlFile(city_model.getGmlPath()).getPackage();
+        return package == PredefinedCityModelPackage::Relief && options.attach_map_tile;
+    }
+
+    /// 現在の都市モデルが地形であり、設定で有効であれば、 TIN を格子状のメッシュに変換すべきとして true を返します。
+    bool shouldRasterizeRelief(const citygml::CityModel& city_model, const MeshExtractOptions& options) {
+        if (!options.rasterize_relief) return false;
+        return GmlFile(city_model.getGmlPath()).getPackage() == PredefinedCityModelPackage::Relief;
+    }
+
+    /**
+     * 設定で有効であり、メッシュ結合単位が地域単位であれば、LODノードの代わりに HLOD の階層を作るべきとして true を返します。
+     * 地形を格子状のメッシュに変換する場合は、変換が LODノードごとに行われ HLOD の階層を置き換えてしまうため、 HLOD は作りません。
+     */
+    bool shouldBuildHlod(const citygml::CityModel& city_model, const MeshExtractOptions& options) {
+        return options.build_hlod && options.mesh_granularity == MeshGranularity::PerCityModelArea &&
+               !shouldRasterizeRelief(city_model, options);
+    }
+
+    /**
+     * CityModel から形状を取り出して out_model に入れます。
+     * テクスチャ結合などの、三角形の並びが確定した後に行う処理は finishModel で行います。
+     */
+    void extractGeometry(
+        Model& out_model, const citygml::CityModel& city_model,
+        const MeshExtractOptions& options, const std::vector<geometry::Extent>& extents,
+        const geometry::GeoReference& geo_reference, const ExtractProgress* progress) {
+
+        if (options.max_lod < options.min_lod) throw std::logic_error("Invalid LOD range.");
+
+        if (shouldBuildHlod(city_model, options)) {
+            // HLOD の階層はLODをまたいで作るため、LODノードの代わりに1つのノードにまとめます。
+            TexturePathCache texture_path_cache(city_model);
+            const auto extent_index = geometry::ExtentIndex(extents);
+            out_model.addNode(AreaMeshFactory::buildHlod(city_model, options, geo_reference, extents,
+                                                         nullptr, nullptr, &texture_path_cache, &extent_index, nullptr, progress));
+        } else {
+            // rootNode として LODノード を作ります。
+            const unsigned lod_count = options.max_lod - options.min_lod + 1;
+            std::vector<Node> lod_nodes;
+            lod_nodes.reserve(lod_count);
+            for (unsigned lod = options.min_lod; lod <= options.max_lod; lod++) {
+                lod_nodes.emplace_back("LOD" + std::to_string(lod));
             }
 
-            out_model.addNode(std::move(lod_node));
+            extractNodes(city_model, options, extents, geo_reference, false, [&lod_nodes](unsigned lod_index, Node&& node) {
+                lod_nodes.at(lod_index).addChildNode(std::move(node));
+            }, progress);
+
+            out_model.reserveRootNodes(lod_count);
+            for (auto& lod_node : lod_nodes) {
+                out_model.addNode(std::move(lod_node));
+            }
         }
         out_model.eraseEmptyNodes();
 
+        // 地形の TIN を格子状のメッシュに置き換えます。テクスチャ結合や地図タイルの貼り付けは置き換えた後のメッシュに対して行います。
+        if (shouldRasterizeRelief(city_model, options)) {
+            out_model = ReliefRasterizer::rasterizeModel(out_model, geo_reference, options.relief_raster_cell_size,
+                                                         options.relief_chunk_size, options.relief_skirt_height);
+        }
+
+        // 暗黙的ジオメトリは頂点として展開せず、形状と配置に分けて出力します。
+        if (options.extract_implicit_geometry_as_instances) {
+            ImplicitGeometryInstancer(options, extents, geo_reference).extract(city_model, out_model);
+        }
+    }
+
+    /**
+     * extractGeometry で取り出した Model に対し、テクスチャ結合、地図タイルの貼り付け、 SubMesh の統合、地物ごとの三角形の範囲の表の作成を行います。
+     */
+    void finishModel(
+        Model& out_model, const citygml::CityModel& city_model, const MeshExtractOptions& options,
+        const geometry::GeoReference& geo_reference, ExtractSession& session, const ExtractProgress* progress) {
+
         // テクスチャを結合します。
+        // 進捗の通知と中断の確認ができるよう、メッシュを1つずつ処理します。
         if (options.enable_texture_packing) {
-            TexturePacker packer(options.texture_packing_resolution, options.texture_packing_resolution);
-            packer.process(out_model);
+            TexturePacker packer(options.texture_packing_resolution, options.texture_packing_resolution,
+                                 TexturePacker::default_internal_canvas_count, &session);
+            const auto meshes = out_model.getAllMeshes();
+            if (progress != nullptr) progress->report(ExtractStage::TexturePacking, ExtractProgress::no_lod, 0, meshes.size());
+            for (size_t i = 0; i < meshes.size(); i++) {
+                if (progress != nullptr) progress->throwIfCancelled();
+                packer.processMesh(meshes.at(i));
+                if (progress != nullptr) progress->report(ExtractStage::TexturePacking, ExtractProgress::no_lod, i + 1, meshes.size());
+            }
+            packer.flush();
         }
 
         // 現在の都市モデルが地形であるなら、衛星写真または地図用のUVを付与し、地図タイルをダウンロードします。
-        auto package = GmlFile(city_model.getGmlPath()).getPackage();
-        if(package == PredefinedCityModelPackage::Relief && options.attach_map_tile) {
-            const auto gml_path = fs::u8path(city_model.getGmlPath());
-            const auto map_download_dest = gml_path.parent_path() / (gml_path.filename().u8string() + "_map");
-            MapAttacher().attach(out_model, options.map_tile_url, map_download_dest, options.map_tile_zoom_level,
-                                geo_reference);
+        if(shouldAttachMapTile(city_model, options)) {
+            MapAttacher().attach(out_model, options.map_tile_url, getMapDownloadDest(city_model), options.map_tile_zoom_level,
+                                geo_reference, progress, &session);
+        }
+
+        // テクスチャ結合などでテクスチャが確定した後に、マテリアルごとに SubMesh をまとめます。
+        if (options.coalesce_sub_meshes_by_material) {
+            for (const auto mesh : out_model.getAllMeshes()) {
+                mesh->coalesceSubMeshes();
+            }
+        }
+
+        // 三角形の並びが確定した後に、地物ごとの三角形の範囲の表を作ります。
+        if (options.build_city_object_ranges) {
+            buildCityObjectRanges(out_model);
+        }
+    }
+
+    void extractInner(
+        Model& out_model, const citygml::CityModel& city_model,
+        const MeshExtractOptions& options,
+        const std::vector<geometry::Extent>& extents, const ExtractProgress* progress) {
+
+        const auto geo_reference = geometry::GeoReference(options.coordinate_zone_id, options.reference_point, options.unit_scale, options.mesh_axes);
+        // 書き出すファイルの名前を、同時に実行中の他の抽出と重ならないよう予約します。
+        ExtractSession session;
+        extractGeometry(out_model, city_model, options, extents, geo_reference, progress);
+        finishModel(out_model, city_model, options, geo_reference, session, progress);
+    }
+
+    /**
+     * extractInner と同じ処理を、Model にまとめる代わりにノードごとに行い、終わったノードから on_node_extracted に渡します。
+     */
+    void extractStreamingInner(
+        const citygml::CityModel& city_model, const MeshExtractOptions& options,
+        const std::vector<geometry::Extent>& extents, const MeshExtractor::NodeCallback& on_node_extracted,
+        const ExtractProgress* progress) {
+
+        const auto geo_reference = geometry::GeoReference(options.coordinate_zone_id, options.reference_point, options.unit_scale, options.mesh_axes);
+        // 書き出すファイルの名前を、同時に実行中の他の抽出と重ならないよう予約します。
+        ExtractSession session;
+
+        // テクスチャの結合先は抽出全体で共有し、結合後の画像は最後にまとめて書き出します。
+        std::optional<TexturePacker> packer;
+        if (options.enable_texture_packing) {
+            packer.emplace(options.texture_packing_resolution, options.texture_packing_resolution,
+                           TexturePacker::default_internal_canvas_count, &session);
+        }
+        const bool attach_map_tile = shouldAttachMapTile(city_model, options);
+
+        extractNodes(city_model, options, extents, geo_reference, true, [&](unsigned lod_index, Node&& node) {
+            // Model::eraseEmptyNodes と同じ基準で、空のノードは渡しません。
+            node.eraseEmptyChildren();
+            if (node.getChildCount() == 0 && !node.polygonExists()) return;
+
+            if (packer.has_value()) {
+                packer->processNodeRecursive(node);
+            }
+
+            if (attach_map_tile) {
+                // MapAttacher は Model を対象とするため、一時的に Model に入れて処理します。
+                Model model;
+                model.addNode(std::move(node));
+                MapAttacher().attach(model, options.map_tile_url, getMapDownloadDest(city_model), options.map_tile_zoom_level,
+                                    geo_reference, nullptr, &session);
+                node = std::move(model.getRootNodeAt(0));
+            }
+
+            if (options.coalesce_sub_meshes_by_material) {
+                coalesceSubMeshesRecursive(node);
+            }
+
+            if (options.build_city_object_ranges) {
+                buildCityObjectRangesRecursive(node);
+            }
+
+            on_node_extracted(options.min_lod + lod_index, std::move(node));
+        }, progress);
+
+        if (packer.has_value()) {
+            packer->flush();
         }
     }
 }
@@ -167,8 +538,8 @@ namespace plateau::polygonMesh {
     }
 
     void MeshExtractor::extract(Model& out_model, const citygml::CityModel& city_model,
-                                const MeshExtractOptions& options) {
-        extractInner(out_model, city_model, options, { plateau::geometry::Extent::all() });
+                                const MeshExtractOptions& options, const ExtractProgress* progress) {
+        extractInner(out_model, city_model, options, { plateau::geometry::Extent::all() }, progress);
     }
 
     std::shared_ptr<Model> MeshExtractor::extractInExtents(
@@ -183,9 +554,44 @@ namespace plateau::polygonMesh {
     void MeshExtractor::extractInExtents(
         Model& out_model, const citygml::CityModel& city_model,
         const MeshExtractOptions& options,
-        const std::vector<plateau::geometry::Extent>& extents) {
+        const std::vector<plateau::geometry::Extent>& extents, const ExtractProgress* progress) {
+
+        extractInner(out_model, city_model, options, extents, progress);
+    }
+
+    void MeshExtractor::extractStreaming(const citygml::CityModel& city_model, const MeshExtractOptions& options,
+                                         const NodeCallback& on_node_extracted, const ExtractProgress* progress) {
+        extractStreamingInner(city_model, options, { plateau::geometry::Extent::all() }, on_node_extracted, progress);
+    }
 
-        extractInner(out_model, city_model, options, extents);
+    void MeshExtractor::extractInExtentsStreaming(
+        const citygml::CityModel& city_model, const MeshExtractOptions& options,
+        const std::vector<plateau::geometry::Extent>& extents, const NodeCallback& on_node_extracted,
+        const ExtractProgress* progress) {
+
+        extractStreamingInner(city_model, options, extents, on_node_extracted, progress);
+    }
+
+    std::vector<std::shared_ptr<Model>> MeshExtractor::extractPerExtent(
+        const citygml::CityModel& city_model, const MeshExtractOptions& options,
+        const std::vector<plateau::geometry::Extent>& tile_extents, const ExtractProgress* progress) {
+
+        // 全範囲を合わせて1回で抽出してから、三角形を範囲ごとに振り分けます。
+        // HLOD の範囲と粗いメッシュは振り分けると意味を失うため、 HLOD は作りません。
+        auto split_options = options;
+        split_options.build_hlod = false;
+        const auto geo_reference = geometry::GeoReference(options.coordinate_zone_id, options.reference_point, options.unit_scale, options.mesh_axes);
+        Model model;
+        extractGeometry(model, city_model, split_options, tile_extents, geo_reference, progress);
+        auto tile_models = ModelTileSplitter::split(model, tile_extents, geo_reference);
+
+        // テクスチャ結合と地図タイルの貼り付けは振り分けた後にタイルごとに行い、各タイルが自身の範囲の画像だけを参照するようにします。
+        // 書き出す画像の名前がタイル間で重ならないよう、セッションはすべてのタイルで共有します。
+        ExtractSession session;
+        for (const auto& tile_model : tile_models) {
+            finishModel(*tile_model, city_model, split_options, geo_reference, session, progress);
+        }
+        return tile_models;
     }
 
 
@@ -4,10 +4,8 @@
 #include <plateau/geometry/geo_coordinate.h>
 #include <plateau/geometry/geo_reference.h>
 #include <cassert>
+#include "extent_clipper.h"
 
-#include <filesystem>
-
-#include "plateau/polygon_mesh/mesh_merger.h"
 #include "plateau/polygon_mesh/mesh_extractor.h"
 
 
@@ -22,77 +20,39 @@ namespace plateau::polygonMesh {
         }
 
         /**
-         * Plateau の Polygon を Mesh情報 に変換します。
-         * Mesh構築に必要な情報を Polygon から コピーします。すなわち:
-         * Vertices を極座標から平面直角座標に変換したうえでコピーします。座標軸は 入力も出力も ENU です。
-         * Indices, UV1 をコピーします。SubMeshを生成します。
-         * 引数の gml_path は、テクスチャパスを相対から絶対に変換するときの基準パスです。
-         * 結果は引数で out と名の付くものに格納されます。
+         * ポリゴンの UV1 と、 need_texture が true ならテクスチャを取得します。
+         * theme が nullptr でなければ、そのテーマのものだけを取得します。
+         * theme が nullptr のときは rgbTexture のテーマを探し、なければ最初に見つかったテーマのものを利用します。
+         * テーマ一覧の取得は UV1 とテクスチャで共有し、1ポリゴンにつき1回までとします。
+         * out_uv_1 は確保済みの容量を保ったまま上書きします。
+         * ただし libcitygml の getTexCoordsForTheme と getAllTextureThemes は値で返すため、その中でのメモリ確保は避けられません。
          */
-        void cityGmlPolygonToMesh(
-            const Polygon& polygon, const std::string& gml_path,
-            const GeoReference& geo_reference, Mesh& out_mesh) {
-
-            // マージ対象の情報を取得します。ここでの頂点は極座標です。
-            const auto& vertices_lat_lon = polygon.getVertices();
-            const auto& in_indices = polygon.getIndices();
-            auto in_uv_1 = polygon.getTexCoordsForTheme("rgbTexture", true);
-            // rgbTextureのthemeが存在しない場合
-            if (in_uv_1.empty()) {
-                auto themes = polygon.getAllTextureThemes(true);
-                if (!themes.empty())
-                    in_uv_1 = polygon.getTexCoordsForTheme(themes.at(0), true);
-            }
-
-            assert(in_indices.size() % 3 == 0);
-
-            if (vertices_lat_lon.empty() || in_indices.empty())
-                return;
-
-            // 極座標から平面直角座標へ変換します。
-            auto& out_vertices = out_mesh.getVertices();
-            out_vertices.reserve(vertices_lat_lon.size());
-            for (const auto& lat_lon : vertices_lat_lon) {
-                auto xyz = geo_reference.projectWithoutAxisConvert(lat_lon);
-                out_vertices.push_back(xyz);
-            }
-            assert(out_vertices.size() == vertices_lat_lon.size());
-
-            // Indicesをコピーします。
-            out_mesh.addIndicesList(in_indices, false, false);
+        void getUV1AndTexture(const Polygon& polygon, const std::string* theme, const bool need_texture,
+                              std::vector<TVec2f>& out_uv_1, std::shared_ptr<const Texture>& out_texture) {
+            // 戻り値を代入すると out_uv_1 の容量が戻り値のものに置き換わるため、要素をコピーします。
+            const auto& uv_1 = polygon.getTexCoordsForTheme(theme == nullptr ? "rgbTexture" : *theme, true);
+            out_uv_1.assign(uv_1.begin(), uv_1.end());
+            out_texture = need_texture ? polygon.getTextureFor(theme == nullptr ? "rgbTexture" : *theme) : nullptr;
+            const bool texture_missing = need_texture && out_texture == nullptr;
+            if (theme != nullptr || (!out_uv_1.empty() && !texture_missing)) return;
 
-            assert(out_mesh.getIndices().size() == in_indices.size());
-            assert(out_mesh.getIndices().size() % 3 == 0);
-
-            // UV1をコピーし、頂点数に足りない分を 0 で埋めます。
-            out_mesh.addUV1(in_uv_1, vertices_lat_lon.size());
-
-            // テクスチャパスを取得し SubMesh を作ります。
-            auto texture = polygon.getTextureFor("rgbTexture");
-            if (texture == nullptr) {
-                // rgbTextureのthemeが存在しない場合
-                auto themes = polygon.getAllTextureThemes(true);
-                if (!themes.empty())
-                    texture = polygon.getTextureFor(themes.at(0));
-            }
-            std::string texture_path;
-            if (texture == nullptr) {
-                texture_path = std::string("");
-            } else {
-                // テクスチャパスを相対から絶対に変換
-                texture_path = texture->getUrl();
-                const auto relative_texture_path = std::filesystem::u8path(texture_path);
-                if (relative_texture_path.is_relative()) {
-                    auto a_path = std::filesystem::u8path(gml_path);
-                    a_path = a_path.parent_path();
-                    a_path /= relative_texture_path;
-                    const auto abs_path = std::filesystem::absolute(a_path);
-
-                    texture_path = abs_path.u8string();
-                }
+            // rgbTextureのthemeが存在しない場合
+            const auto themes = polygon.getAllTextureThemes(true);
+            if (themes.empty()) return;
+            if (out_uv_1.empty()) {
+                const auto& theme_uv_1 = polygon.getTexCoordsForTheme(themes.at(0), true);
+                out_uv_1.assign(theme_uv_1.begin(), theme_uv_1.end());
             }
+            if (texture_missing)
+                out_texture = polygon.getTextureFor(themes.at(0));
+        }
 
-            // Materialを取得し SubMesh に設定します。設定されていない場合nullptrが設定されます。
+        /**
+         * ポリゴンの Material を取得します。設定されていない場合 nullptr を返します。
+         * テーマの扱いは getUV1AndTexture と同じです。
+         */
+        std::shared_ptr<const Material> getMaterial(const Polygon& polygon, const std::string* theme) {
+            if (theme != nullptr) return polygon.getMaterialFor(*theme);
             auto material = polygon.getMaterialFor("rgbTexture");
             if (material == nullptr) {
                 // rgbTextureのthemeが存在しない場合
@@ -100,66 +60,7 @@ namespace plateau::polygonMesh {
                 if (!themes.empty())
                     material = polygon.getMaterialFor(themes.at(0));
             }
-
-            out_mesh.addSubMesh(texture_path, material, 0, out_mesh.getIndices().size() - 1, -1);
-        }
-
-        void findAllPolygonsInGeometry(
-            const Geometry& geom, std::list<const citygml::Polygon*>& polygons,
-            const unsigned lod, long long& out_vertices_count) {
-
-            // 子のジオメトリのポリゴンをすべて取得
-            const unsigned int child_count = geom.getGeometriesCount();
-            for (unsigned int i = 0; i < child_count; i++) {
-                findAllPolygonsInGeometry(geom.getGeometry(i), polygons, lod, out_vertices_count);
-            }
-
-            if (geom.getLOD() != lod) return;
-
-            const unsigned int polygon_count = geom.getPolygonsCount();
-            for (unsigned int i = 0; i < polygon_count; i++) {
-                const auto& poly = geom.getPolygon(i);
-                polygons.push_back(poly.get());
-                out_vertices_count += static_cast<long long>(poly->getVertices().size());
-            }
-        }
-
-        void findAllPolygonsInGeometry(
-            const Geometry& geom, std::list<const citygml::Polygon*>& polygons,
-            const unsigned lod, long long& out_vertices_count,
-            const std::vector<plateau::geometry::Extent> extents) {
-
-            // 子のジオメトリのポリゴンをすべて取得
-            const unsigned int child_count = geom.getGeometriesCount();
-            for (unsigned int i = 0; i < child_count; i++) {
-                findAllPolygonsInGeometry(geom.getGeometry(i), polygons, lod, out_vertices_count, extents);
-            }
-
-            if (geom.getLOD() != lod) return;
-
-            // 1つでも頂点が範囲内にあるかどうかを探索
-            const unsigned int polygon_count = geom.getPolygonsCount();
-            for (unsigned int i = 0; i < polygon_count; i++) {
-                const auto& polygon = geom.getPolygon(i);
-                bool is_in_extent = false;
-                // TODO: 計算コストが頂点数と範囲数に比例するため高速化
-                for (const auto& vertex : polygon->getVertices()) {
-                    for (const auto& extent : extents) {
-                        if (extent.contains(vertex)) {
-                            is_in_extent = true;
-                            break;
-                        }
-                    }
-                    if (is_in_extent)
-                        break;
-                }
-
-                if (!is_in_extent)
-                    continue;
-
-                polygons.push_back(polygon.get());
-                out_vertices_count += static_cast<long long>(polygon->getVertices().size());
-            }
+            return material;
         }
     }
 
@@ -180,11 +81,17 @@ namespace plateau::polygonMesh {
         std::unique_ptr<Mesh>&& target,
         const MeshExtractOptions& mesh_extract_options,
         const std::vector<plateau::geometry::Extent>& extents,
-        const geometry::GeoReference& geo_reference)
+        const geometry::GeoReference& geo_reference,
+        const CityObjectPolygonIndex* polygon_index,
+        TexturePathCache* texture_path_cache,
+        const ExtentIndex* extent_index)
 
         : options_(mesh_extract_options)
         , geo_reference_(geo_reference)
-        , extents_(extents) {
+        , extents_(extents)
+        , polygon_index_(polygon_index)
+        , texture_path_cache_(texture_path_cache)
+        , extent_index_(extent_index) {
 
         if (target == nullptr)
             mesh_ = std::make_unique<Mesh>();
@@ -193,25 +100,70 @@ namespace plateau::polygonMesh {
     }
 
     void MeshFactory::addPolygon(const Polygon& polygon, const std::string& gml_path) const {
+        addPolygon(polygon, gml_path, false);
+    }
+
+    void MeshFactory::addPolygonInLocalCoordinates(const Polygon& polygon, const std::string& gml_path) const {
+        addPolygon(polygon, gml_path, true);
+    }
+
+    void MeshFactory::addPolygon(const Polygon& polygon, const std::string& gml_path, const bool is_local_coordinates) const {
         if (!isValidPolygon(polygon))
             return;
 
-        Mesh mesh;
-        cityGmlPolygonToMesh(polygon, gml_path, geo_reference_, mesh);
+        const auto& vertices_lat_lon = polygon.getVertices();
+        const auto& in_indices = polygon.getIndices();
+        if (in_indices.size() % 3 != 0) {
+            throw std::runtime_error("size of other_indices must be multiple of 3.");
+        }
 
-        const auto from_axis = geometry::CoordinateSystem::ENU;
-        const auto to_axis = options_.mesh_axes;
+        // キャッシュが同じ GMLファイルのものであれば、抽出の開始時に決めたテーマで直接引きます。
+        const bool is_cache_available = texture_path_cache_ != nullptr && texture_path_cache_->getGmlPath() == gml_path;
+        const auto theme = is_cache_available ? &texture_path_cache_->getTheme() : nullptr;
+        auto& uv_1 = scratch_.uv_1;
+        std::shared_ptr<const Texture> texture;
+        getUV1AndTexture(polygon, theme, options_.export_appearance, uv_1, texture);
+
+        const auto prev_index_count = mesh_->indices_.size();
+        if (options_.clip_polygons_to_extent && !is_local_coordinates) {
+            // 範囲の境界をまたぐ三角形を切り取ってから追加します。
+            auto& clipped_vertices_lat_lon = scratch_.clipped_vertices_lat_lon;
+            auto& clipped_indices = scratch_.clipped_indices;
+            auto& clipped_uv_1 = scratch_.clipped_uv_1;
+            clipped_vertices_lat_lon.clear();
+            clipped_indices.clear();
+            clipped_uv_1.clear();
+            ExtentClipper::clip(vertices_lat_lon, in_indices, uv_1, extents_,
+                                clipped_vertices_lat_lon, clipped_indices, clipped_uv_1);
+            if (clipped_indices.empty()) return;
+            appendShape(clipped_vertices_lat_lon, clipped_indices, clipped_uv_1, false);
+        } else {
+            appendShape(vertices_lat_lon, in_indices, uv_1, is_local_coordinates);
+        }
 
-        // 座標軸を変換します。
-        auto& vertices = mesh.getVertices();
-        const auto vertex_count = vertices.size();
-        for (size_t i = 0; i < vertex_count; ++i) {
-            const auto& before = vertices.at(i);
-            // BEFORE → ENU
-            const auto enu_vertex = GeoReference::convertAxisToENU(from_axis, before);
-            // ENU → AFTER
-            vertices.at(i) = GeoReference::convertAxisFromENUTo(to_axis, enu_vertex);
+        // テクスチャを含める場合は、テクスチャパスとマテリアルに応じて SubMesh を追加または延長します。
+        const auto last_index = mesh_->indices_.size() - 1;
+        if (options_.export_appearance) {
+            const auto material = getMaterial(polygon, theme);
+            if (texture == nullptr) {
+                mesh_->addSubMesh("", material, prev_index_count, last_index, -1);
+            } else if (is_cache_available) {
+                // 同じテクスチャのパス変換は抽出中に1回だけ行います。
+                mesh_->addSubMesh(texture_path_cache_->getAbsolutePath(*texture), material, prev_index_count, last_index, -1);
+            } else {
+                mesh_->addSubMesh(TexturePathCache::toAbsolutePath(texture->getUrl(), gml_path), material, prev_index_count, last_index, -1);
+            }
+        } else {
+            mesh_->extendLastSubMesh(last_index);
         }
+    }
+
+    void MeshFactory::appendShape(const std::vector<TVec3d>& vertices_lat_lon, const std::vector<unsigned>& in_indices,
+                                  const std::vector<TVec2f>& uv_1, const bool is_local_coordinates) const {
+        // 一時的な Mesh を作ってからマージするのではなく、変換結果を mesh_ の末尾に直接書き込みます。
+        // ポリゴンごとにメモリ確保とコピーが発生するのを避けるためです。
+        const auto from_axis = geometry::CoordinateSystem::ENU;
+        const auto to_axis = options_.mesh_axes;
 
         // 座標軸を変換するとき、符号の反転によってポリゴンが裏返ることがあります。それを補正するためにポリゴンを裏返す処理が必要かどうかを求めます。
         // 座標軸を FROM から TO に変換するとして、それは 下記の [1]と[2] の XOR で求まります。
@@ -219,12 +171,35 @@ namespace plateau::polygonMesh {
             shouldInvertIndicesOnMeshConvert(from_axis) !=  // [1] FROM → ENU に変換するときに反転の必要があるか
             shouldInvertIndicesOnMeshConvert(to_axis);     // [2] ENU → TO に変換するときに反転の必要があるか
 
-        MeshMerger::mergeMesh(
-            *mesh_,
-            mesh,
-            invert_mesh_front_back,
-            options_.export_appearance
-        );
+        // 極座標から平面直角座標へ変換し、さらに座標軸を変換して追加します。
+        auto& vertices = mesh_->vertices_;
+        const auto prev_vertex_count = static_cast<unsigned>(vertices.size());
+        const auto unit_scale = static_cast<double>(geo_reference_.getUnitScale());
+        for (const auto& lat_lon : vertices_lat_lon) {
+            const auto xyz = is_local_coordinates ? lat_lon / unit_scale : geo_reference_.projectWithoutAxisConvert(lat_lon);
+            // BEFORE → ENU
+            const auto enu_vertex = GeoReference::convertAxisToENU(from_axis, xyz);
+            // ENU → AFTER
+            vertices.push_back(GeoReference::convertAxisFromENUTo(to_axis, enu_vertex));
+        }
+
+        // Indicesを追加します。以前の頂点の数だけインデックスの数値を大きくします。
+        auto& indices = mesh_->indices_;
+        if (invert_mesh_front_back) {
+            // 三角形ごとに頂点の順番を反転させます。
+            for (size_t i = 0; i < in_indices.size(); i += 3) {
+                indices.push_back(in_indices[i + 2] + prev_vertex_count);
+                indices.push_back(in_indices[i + 1] + prev_vertex_count);
+                indices.push_back(in_indices[i] + prev_vertex_count);
+            }
+        } else {
+            for (const auto index : in_indices) {
+                indices.push_back(index + prev_vertex_count);
+            }
+        }
+
+        // UV1を追加し、頂点数に足りない分を 0 で埋めます。
+        mesh_->addUV1(uv_1, vertices_lat_lon.size());
     }
 
     void MeshFactory::addPolygonsInPrimaryCityObject(
@@ -232,26 +207,36 @@ namespace plateau::polygonMesh {
         const std::string& gml_path) {
 
         long long vertex_count = 0;
-        std::list<const Polygon*> polygons;
+        auto& polygons = scratch_.polygons;
+        polygons.clear();
 
         findAllPolygons(city_object, lod, polygons, vertex_count);
         mesh_->reserve(vertex_count);
+        const auto prev_vertex_count = mesh_->vertices_.size();
         for (const auto polygon : polygons) {
             addPolygon(*polygon, gml_path);
         }
 
         const auto& gml_id = city_object.getId();
 
+        // ポリゴンの切り取りによって頂点数が変わることがあるため、実際に追加された頂点数を使います。
         const auto primary_index = available_primary_index_.getPrimary();
-        mesh_->addUV4WithSameVal(primary_index.toUV(), vertex_count);
+        mesh_->addUV4WithSameVal(primary_index.toUV(), static_cast<long long>(mesh_->vertices_.size() - prev_vertex_count));
         mesh_->city_object_list_.add(primary_index, gml_id);
     }
 
     long long MeshFactory::countVertices(
         const CityObject& city_object, const unsigned lod) {
 
+        // 範囲によるポリゴンの除外がなければ、索引に記録済みの頂点数をそのまま使えます。
+        if (polygon_index_ != nullptr && !options_.exclude_polygons_outside_extent && !options_.clip_polygons_to_extent) {
+            const auto lod_polygons = polygon_index_->find(city_object, lod);
+            if (lod_polygons != nullptr) return lod_polygons->vertex_count;
+        }
+
         long long vertex_count = 0;
-        std::list<const Polygon*> polygons;
+        auto& polygons = scratch_.polygons;
+        polygons.clear();
         findAllPolygons(city_object, lod, polygons, vertex_count);
 
         return vertex_count;
@@ -280,14 +265,16 @@ namespace plateau::polygonMesh {
         last_parent_gml_id_cache_ = parent_city_object.getId();
 
         long long vertex_count = 0;
-        std::list<const Polygon*> polygons;
+        auto& polygons = scratch_.polygons;
+        polygons.clear();
         findAllPolygons(city_object, lod, polygons, vertex_count);
         mesh_->reserve(vertex_count);
+        const auto prev_vertex_count = mesh_->vertices_.size();
         for (const auto polygon : polygons) {
             addPolygon(*polygon, gml_path);
         }
 
-        mesh_->addUV4WithSameVal(city_object_index.toUV(), vertex_count);
+        mesh_->addUV4WithSameVal(city_object_index.toUV(), static_cast<long long>(mesh_->vertices_.size() - prev_vertex_count));
         mesh_->city_object_list_.add(city_object_index, city_object.getId());
     }
 
@@ -308,20 +295,21 @@ namespace plateau::polygonMesh {
             // スキップすべきタイプはスキップします。
             if(MeshExtractor::isTypeToSkip(city_object->getType())) continue;
 
-            auto gml_id = city_object->getId();
-
             long long vertex_count = 0;
-            std::list<const Polygon*> polygons;
+            auto& polygons = scratch_.polygons;
+            polygons.clear();
             findAllPolygons(*city_object, lod, polygons, vertex_count);
             mesh_->reserve(vertex_count);
+            const auto prev_vertex_count = mesh_->vertices_.size();
             for (const auto polygon : polygons) {
                 addPolygon(*polygon, gml_path);
             }
 
-            if (vertex_count > 0)
-                mesh_->addUV4WithSameVal(available_city_object_index.toUV(), vertex_count);
+            const auto added_vertex_count = static_cast<long long>(mesh_->vertices_.size() - prev_vertex_count);
+            if (added_vertex_count > 0)
+                mesh_->addUV4WithSameVal(available_city_object_index.toUV(), added_vertex_count);
 
-            mesh_->city_object_list_.add(available_city_object_index, gml_id);
+            mesh_->city_object_list_.add(available_city_object_index, city_object->getId());
             ++available_city_object_index.atomic_index;
         }
     }
@@ -332,19 +320,40 @@ namespace plateau::polygonMesh {
 
     void MeshFactory::findAllPolygons(
         const CityObject& city_obj, const unsigned lod,
-        std::list<const Polygon*>& out_polygons, long long& out_vertices_count) {
+        std::vector<const Polygon*>& out_polygons, long long& out_vertices_count) {
 
-        const auto geometry_count = city_obj.getGeometriesCount();
         out_vertices_count = 0;
+        if (lod > PolygonMeshUtils::max_lod_in_specification_) return;
+
+        // 索引があればそれを使い、なければその場で Geometry を走査します。
+        const LodPolygons* lod_polygons = polygon_index_ == nullptr ? nullptr : polygon_index_->find(city_obj, lod);
+        if (lod_polygons == nullptr) {
+            auto& collected = scratch_.lod_buckets;
+            CityObjectPolygonIndex::collect(city_obj, collected);
+            lod_polygons = &collected.at(lod);
+        }
 
-        std::vector<Extent> extents = { Extent::all() };
-        if (options_.exclude_polygons_outside_extent)
-            extents = extents_;
+        if (!options_.exclude_polygons_outside_extent && !options_.clip_polygons_to_extent) {
+            out_polygons.insert(out_polygons.end(), lod_polygons->polygons.begin(), lod_polygons->polygons.end());
+            out_vertices_count = lod_polygons->vertex_count;
+            return;
+        }
 
-        for (unsigned i = 0; i < geometry_count; i++) {
-            findAllPolygonsInGeometry(
-                city_obj.getGeometry(i), out_polygons, lod,
-                out_vertices_count, extents);
+        // 範囲外のポリゴンを除外します。1つでも頂点が範囲内にあれば範囲内とみなします。
+        // ポリゴンを切り取る場合は、頂点がすべて範囲外でも範囲と交わることがあるため、外接矩形が交わるものを残します。
+        if (extent_index_ == nullptr && !own_extent_index_.has_value()) {
+            own_extent_index_.emplace(extents_);
+        }
+        const auto& extent_index = extent_index_ != nullptr ? *extent_index_ : own_extent_index_.value();
+        for (const auto polygon : lod_polygons->polygons) {
+            const bool may_be_inside = options_.clip_polygons_to_extent ?
+                    extent_index.mayIntersect(polygon->getVertices()) :
+                    extent_index.containsAny(polygon->getVertices());
+            if (!may_be_inside)
+                continue;
+
+            out_polygons.push_back(polygon);
+            out_vertices_count += static_cast<long long>(polygon->getVertices().size());
         }
     }
 
@@ -77,4 +77,35 @@ namespace plateau::polygonMesh {
     void Model::reserveRootNodes(size_t reserve_count) {
         root_nodes_.reserve(reserve_count);
     }
+
+    size_t Model::addInstancePrototype(std::unique_ptr<Mesh>&& mesh) {
+        instance_prototypes_.push_back(std::move(mesh));
+        return instance_prototypes_.size() - 1;
+    }
+
+    size_t Model::getInstancePrototypeCount() const {
+        return instance_prototypes_.size();
+    }
+
+    Mesh& Model::getInstancePrototypeAt(size_t index) {
+        return *instance_prototypes_.at(index);
+    }
+
+    const Mesh& Model::getInstancePrototypeAt(size_t index) const {
+        return *instance_prototypes_.at(index);
+    }
+
+    void Model::addMeshInstance(MeshInstance&& instance) {
+        if (instance.prototype_index >= instance_prototypes_.size())
+            throw std::out_of_range("addMeshInstance : prototype_index is out of range.");
+        mesh_instances_.push_back(std::move(instance));
+    }
+
+    const std::vector<MeshInstance>& Model::getMeshInstances() const {
+        return mesh_instances_;
+    }
+
+    std::vector<MeshInstance>& Model::getMeshInstances() {
+        return mesh_instances_;
+    }
 }
@@ -0,0 +1,278 @@
+#include <plateau/polygon_mesh/model_batcher.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <unordered_map>
+
+namespace plateau::polygonMesh {
+
+    namespace {
+        /**
+         * 元のメッシュごとの CityObjectIndex を、結合後のメッシュで一意な CityObjectIndex に振り直します。
+         * gml:id が分かる地物は gml:id ごとに、分からない地物は元のメッシュとインデックスの組ごとに番号を割り当てます。
+         */
+        class CityObjectIndexRemapper {
+        public:
+            /// 以降の remap で src を元のメッシュとして扱います。
+            void beginSourceMesh(const Mesh& src) {
+                src_city_object_list_ = &src.getCityObjectList();
+                src_cache_.clear();
+            }
+
+            CityObjectIndex remap(const CityObjectIndex& src_index) {
+                // 同じ地物の頂点は同じ値を持つため、元のメッシュの中ではキャッシュで引きます。
+                const auto cached = src_cache_.find(src_index);
+                if (cached != src_cache_.end()) return cached->second;
+
+                const auto primary = remapPrimary(src_index.primary_index);
+                auto result = CityObjectIndex(primary, CityObjectIndex::invalidIndex());
+                if (src_index.atomic_index != CityObjectIndex::invalidIndex()) {
+                    std::string atomic_gml_id;
+                    if (src_city_object_list_->tryGetAtomicGmlID(src_index, atomic_gml_id)) {
+                        const auto key = std::make_pair(primary, atomic_gml_id);
+                        const auto found = atomic_by_gml_id_.find(key);
+                        if (found != atomic_by_gml_id_.end()) {
+                            result.atomic_index = found->second;
+                        } else {
+                            result.atomic_index = next_atomic_indices_[primary]++;
+                            atomic_by_gml_id_.emplace(key, result.atomic_index);
+                            gml_ids_.emplace(result, atomic_gml_id);
+                        }
+                    } else {
+                        result.atomic_index = next_atomic_indices_[primary]++;
+                    }
+                }
+                src_cache_.emplace(src_index, result);
+                return result;
+            }
+
+            /// 振り直した後の CityObjectIndex について、 gml:id が分かれば out_gml_id に格納して true を返します。
+            bool tryGetGmlId(const CityObjectIndex& index, std::string& out_gml_id) const {
+                const auto found = gml_ids_.find(index);
+                if (found == gml_ids_.end()) return false;
+                out_gml_id = found->second;
+                return true;
+            }
+
+        private:
+            int remapPrimary(const int src_primary) {
+                const auto src_key = CityObjectIndex(src_primary, CityObjectIndex::invalidIndex());
+                const auto cached = src_cache_.find(src_key);
+                if (cached != src_cache_.end()) return cached->second.primary_index;
+
+                int primary;
+                std::string primary_gml_id;
+                if (src_city_object_list_->tryGetPrimaryGmlID(src_primary, primary_gml_id)) {
+                    const auto found = primary_by_gml_id_.find(primary_gml_id);
+                    if (found != primary_by_gml_id_.end()) {
+                        primary = found->second;
+                    } else {
+                        primary = next_primary_index_++;
+                        primary_by_gml_id_.emplace(primary_gml_id, primary);
+                        gml_ids_.emplace(CityObjectIndex(primary, CityObjectIndex::invalidIndex()), primary_gml_id);
+                    }
+                } else {
+                    primary = next_primary_index_++;
+                }
+                src_cache_.emplace(src_key, CityObjectIndex(primary, CityObjectIndex::invalidIndex()));
+                return primary;
+            }
+
+            const CityObjectList* src_city_object_list_ = nullptr;
+            std::map<CityObjectIndex, CityObjectIndex> src_cache_;
+            std::map<std::string, int> primary_by_gml_id_;
+            std::map<std::pair<int, std::string>, int> atomic_by_gml_id_;
+            std::map<int, int> next_atomic_indices_;
+            std::map<CityObjectIndex, std::string> gml_ids_;
+            int next_primary_index_ = 0;
+        };
+
+        /// 1つのマテリアルの結合先となるメッシュを組み立てます。
+        class BatchBuilder {
+        public:
+            explicit BatchBuilder(const SubMesh& material) :
+                    material_(material) {
+            }
+
+            bool empty() const {
+                return indices_.empty();
+            }
+
+            /// 三角形 (src の indices の first_index から3つ) を追加したときに、新たに増える頂点の数を返します。
+            size_t countNewVertices(const Mesh& src, const size_t first_index) const {
+                if (current_src_ != &src) return 3;
+                size_t count = 0;
+                for (size_t i = first_index; i < first_index + 3; i++) {
+                    if (vertex_map_.find(src.getIndices()[i]) == vertex_map_.end()) count++;
+                }
+                return count;
+            }
+
+            size_t vertexCount() const {
+                return vertices_.size();
+            }
+
+            void addTriangle(const Mesh& src, const size_t first_index, CityObjectIndexRemapper& remapper) {
+                if (current_src_ != &src) {
+                    current_src_ = &src;
+                    vertex_map_.clear();
+                }
+                for (size_t i = first_index; i < first_index + 3; i++) {
+                    indices_.push_back(addVertex(src, src.getIndices()[i], remapper));
+                }
+            }
+
+            std::unique_ptr<Mesh> build(const CityObjectIndexRemapper& remapper) {
+                CityObjectList city_object_list;
+                std::string gml_id;
+                for (const auto& index : used_city_object_indices_) {
+                    if (remapper.tryGetGmlId(index, gml_id)) city_object_list.add(index, gml_id);
+                    const auto primary = index.getPrimary();
+                    if (remapper.tryGetGmlId(primary, gml_id)) city_object_list.add(primary, gml_id);
+                }
+                std::vector<SubMesh> sub_meshes = {
+                        SubMesh(0, indices_.size() - 1, material_.getTexturePath(), material_.getMaterial(),
+                                material_.getGameMaterialID())};
+                auto mesh = std::make_unique<Mesh>(
+                        std::move(vertices_), std::move(indices_), std::move(uv1_), std::move(uv4_),
+                        std::move(sub_meshes), std::move(city_object_list));
+                if (has_vertex_colors_) mesh->setVertexColors(vertex_colors_);
+                return mesh;
+            }
+
+        private:
+            unsigned addVertex(const Mesh& src, const unsigned src_index, CityObjectIndexRemapper& remapper) {
+                const auto found = vertex_map_.find(src_index);
+                if (found != vertex_map_.end()) return found->second;
+
+                const auto index = static_cast<unsigned>(vertices_.size());
+                vertices_.push_back(src.getVertices().at(src_index));
+                const auto& src_uv1 = src.getUV1();
+                uv1_.push_back(src_index < src_uv1.size() ? src_uv1[src_index] : TVec2f(0, 0));
+
+                const auto& src_uv4 = src.getUV4();
+                if (src_index < src_uv4.size()) {
+                    const auto city_object_index = remapper.remap(CityObjectIndex::fromUV(src_uv4[src_index]));
+                    used_city_object_indices_.insert(city_object_index);
+                    uv4_.push_back(city_object_index.toUV());
+                } else {
+                    uv4_.emplace_back(0, 0);
+                }
+
+                const auto& src_colors = src.getVertexColors();
+                if (src_index < src_colors.size()) {
+                    vertex_colors_.push_back(src_colors[src_index]);
+                    has_vertex_colors_ = true;
+                } else {
+                    vertex_colors_.emplace_back(0, 0, 0);
+                }
+
+                vertex_map_.emplace(src_index, index);
+                return index;
+            }
+
+            SubMesh material_;
+            std::vector<TVec3d> vertices_;
+            std::vector<unsigned> indices_;
+            UV uv1_;
+            UV uv4_;
+            std::vector<TVec3d> vertex_colors_;
+            bool has_vertex_colors_ = false;
+            std::set<CityObjectIndex> used_city_object_indices_;
+            /// current_src_ の頂点番号から、このメッシュでの頂点番号への対応です。
+            const Mesh* current_src_ = nullptr;
+            std::unordered_map<unsigned, unsigned> vertex_map_;
+        };
+
+        /// 1つのマテリアルについて、頂点数の上限ごとに分かれた結合先の列です。
+        struct MaterialGroup {
+            SubMesh material;
+            std::vector<BatchBuilder> batches;
+        };
+
+        void collectMeshes(const Node& node, std::vector<const Mesh*>& out_meshes) {
+            if (node.polygonExists()) out_meshes.push_back(node.getMesh());
+            for (size_t i = 0; i < node.getChildCount(); i++) {
+                collectMeshes(node.getChildAt(i), out_meshes);
+            }
+        }
+
+        /// 三角形の範囲 [start, end] をマテリアルのグループに追加します。
+        void addRange(const Mesh& src, const SubMesh& material, const size_t start, const size_t end,
+                      const unsigned max_vertex_count, std::vector<MaterialGroup>& groups,
+                      CityObjectIndexRemapper& remapper) {
+            auto group = groups.begin();
+            while (group != groups.end() && !group->material.isSameAs(material)) group++;
+            if (group == groups.end()) {
+                groups.push_back({material, {}});
+                group = groups.end() - 1;
+            }
+            if (group->batches.empty()) group->batches.emplace_back(material);
+
+            const auto end_index = std::min(end + 1, src.getIndices().size());
+            for (size_t i = start; i + 2 < end_index; i += 3) {
+                auto* batch = &group->batches.back();
+                // 頂点数の上限を超える場合は、新しいメッシュに分けます。
+                if (max_vertex_count > 0 && !batch->empty() &&
+                    batch->vertexCount() + batch->countNewVertices(src, i) > max_vertex_count) {
+                    batch = &group->batches.emplace_back(group->material);
+                }
+                batch->addTriangle(src, i, remapper);
+            }
+        }
+
+        /// src_root 以下のメッシュをマテリアルごとに結合し、 dst_root の子として追加します。
+        void batchRootNode(const Node& src_root, Node& dst_root, const unsigned max_vertex_count) {
+            std::vector<const Mesh*> meshes;
+            collectMeshes(src_root, meshes);
+
+            CityObjectIndexRemapper remapper;
+            std::vector<MaterialGroup> groups;
+            const auto no_material = SubMesh(0, 0, "", nullptr);
+            for (const auto mesh : meshes) {
+                remapper.beginSourceMesh(*mesh);
+                // SubMesh に含まれない三角形は、マテリアルなしとして扱います。
+                size_t covered_end = 0;
+                for (const auto& sub_mesh : mesh->getSubMeshes()) {
+                    if (sub_mesh.getStartIndex() > covered_end) {
+                        addRange(*mesh, no_material, covered_end, sub_mesh.getStartIndex() - 1, max_vertex_count, groups, remapper);
+                    }
+                    addRange(*mesh, sub_mesh, sub_mesh.getStartIndex(), sub_mesh.getEndIndex(), max_vertex_count, groups, remapper);
+                    covered_end = std::max(covered_end, sub_mesh.getEndIndex() + 1);
+                }
+                if (covered_end < mesh->getIndices().size()) {
+                    addRange(*mesh, no_material, covered_end, mesh->getIndices().size() - 1, max_vertex_count, groups, remapper);
+                }
+            }
+
+            size_t batch_count = 0;
+            for (auto& group : groups) {
+                for (auto& batch : group.batches) {
+                    if (batch.empty()) continue;
+                    dst_root.addChildNode(Node("batch_" + std::to_string(batch_count++), batch.build(remapper)));
+                }
+            }
+        }
+    }
+
+    Model ModelBatcher::batch(const Model& src, const unsigned max_vertex_count) {
+        Model dst;
+        dst.reserveRootNodes(src.getRootNodeCount());
+        for (size_t i = 0; i < src.getRootNodeCount(); i++) {
+            const auto& src_root = src.getRootNodeAt(i);
+            auto& dst_root = dst.addNode(Node(src_root.getName()));
+            batchRootNode(src_root, dst_root, max_vertex_count);
+        }
+        dst.eraseEmptyNodes();
+
+        // インスタンスプロトタイプと配置はノードの階層に含まれないため、結合せずにそのまま引き継ぎます。
+        for (size_t i = 0; i < src.getInstancePrototypeCount(); i++) {
+            dst.addInstancePrototype(std::make_unique<Mesh>(src.getInstancePrototypeAt(i)));
+        }
+        for (const auto& instance : src.getMeshInstances()) {
+            dst.addMeshInstance(MeshInstance(instance));
+        }
+        return dst;
+    }
+}
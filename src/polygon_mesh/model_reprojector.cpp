@@ -0,0 +1,223 @@
+#include <plateau/polygon_mesh/model_reprojector.h>
+#include <plateau/polygon_mesh/mesh_factory.h>
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace plateau::polygonMesh {
+    using namespace plateau::geometry;
+
+    namespace {
+        /// 座標 v を M * v + t に変換するアフィン変換です。
+        struct AffineTransform {
+            double m[3][3];
+            TVec3d t;
+
+            bool isIdentity() const {
+                for (int row = 0; row < 3; row++) {
+                    for (int col = 0; col < 3; col++) {
+                        if (m[row][col] != (row == col ? 1.0 : 0.0)) return false;
+                    }
+                }
+                return t.x == 0 && t.y == 0 && t.z == 0;
+            }
+        };
+
+        /**
+         * from の座標を to の座標に変換するアフィン変換を求めます。 from と to の系番号は同じである必要があります。
+         * GeoReference::project は 平面直角座標 p に対して A(p) / unit_scale - reference_point を返します。
+         * A は座標軸の変換で、符号付きの置換行列であり自身が逆行列です。
+         * したがって v_to = (s_from / s_to) * A_to * A_from * (v_from + r_from) - r_to となります。
+         */
+        AffineTransform computeAffine(const GeoReference& from, const GeoReference& to) {
+            const auto scale = static_cast<double>(from.getUnitScale()) / static_cast<double>(to.getUnitScale());
+            const auto linear = [&](const TVec3d& v) {
+                const auto enu = GeoReference::convertAxisToENU(from.getCoordinateSystem(), v);
+                return GeoReference::convertAxisFromENUTo(to.getCoordinateSystem(), enu) * scale;
+            };
+
+            AffineTransform affine{};
+            const TVec3d basis[3] = {TVec3d(1, 0, 0), TVec3d(0, 1, 0), TVec3d(0, 0, 1)};
+            for (int col = 0; col < 3; col++) {
+                const auto column = linear(basis[col]);
+                affine.m[0][col] = column.x;
+                affine.m[1][col] = column.y;
+                affine.m[2][col] = column.z;
+            }
+            affine.t = linear(from.getReferencePoint()) - to.getReferencePoint();
+            return affine;
+        }
+
+        TVec3d applyAffine(const TVec3d& v, const AffineTransform& affine) {
+            const auto& m = affine.m;
+            return {m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z + affine.t.x,
+                    m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z + affine.t.y,
+                    m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z + affine.t.z};
+        }
+
+        /**
+         * 全頂点にアフィン変換を適用します。
+         * 行列の要素をローカル変数に取り出し、ループ内で分岐やメモリの読み直しが起きないようにすることで、コンパイラのベクトル化を妨げないようにします。
+         */
+        void applyAffine(std::vector<TVec3d>& vertices, const AffineTransform& affine) {
+            const double m00 = affine.m[0][0], m01 = affine.m[0][1], m02 = affine.m[0][2];
+            const double m10 = affine.m[1][0], m11 = affine.m[1][1], m12 = affine.m[1][2];
+            const double m20 = affine.m[2][0], m21 = affine.m[2][1], m22 = affine.m[2][2];
+            const double tx = affine.t.x, ty = affine.t.y, tz = affine.t.z;
+
+            const auto count = vertices.size();
+            auto* const data = vertices.data();
+            for (size_t i = 0; i < count; i++) {
+                const double x = data[i].x;
+                const double y = data[i].y;
+                const double z = data[i].z;
+                data[i].x = m00 * x + m01 * y + m02 * z + tx;
+                data[i].y = m10 * x + m11 * y + m12 * z + ty;
+                data[i].z = m20 * x + m21 * y + m22 * z + tz;
+            }
+        }
+
+        /**
+         * 配置の変換行列 transform を、頂点に affine を掛けた座標系でのものに変換します。
+         * プロトタイプの頂点には affine の線形部分 M のみを掛けるため、配置の線形部分 R は M * R * M^-1 となります。
+         * 配置の基準点 (平行移動の成分) は translate_origin で変換します。
+         */
+        template<typename TranslateOrigin>
+        void transformInstance(std::array<double, 16>& transform, const AffineTransform& affine,
+                               const TranslateOrigin& translate_origin) {
+            const auto& m = affine.m;
+            // M は符号付きの置換行列の定数倍ですが、一般の 3×3 行列として逆行列を求めます。
+            const double det =
+                    m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                    m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                    m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+            double inv[3][3];
+            for (int row = 0; row < 3; row++) {
+                for (int col = 0; col < 3; col++) {
+                    // 余因子行列の転置を行列式で割ります。
+                    const int r0 = (col + 1) % 3, r1 = (col + 2) % 3;
+                    const int c0 = (row + 1) % 3, c1 = (row + 2) % 3;
+                    inv[row][col] = (m[r0][c0] * m[r1][c1] - m[r0][c1] * m[r1][c0]) / det;
+                }
+            }
+
+            double r[3][3];
+            for (int row = 0; row < 3; row++) {
+                for (int col = 0; col < 3; col++) {
+                    r[row][col] = transform[row * 4 + col];
+                }
+            }
+            for (int row = 0; row < 3; row++) {
+                for (int col = 0; col < 3; col++) {
+                    double value = 0;
+                    for (int i = 0; i < 3; i++) {
+                        for (int j = 0; j < 3; j++) {
+                            value += m[row][i] * r[i][j] * inv[j][col];
+                        }
+                    }
+                    transform[row * 4 + col] = value;
+                }
+            }
+
+            const auto origin = translate_origin(TVec3d(transform[3], transform[7], transform[11]));
+            transform[3] = origin.x;
+            transform[7] = origin.y;
+            transform[11] = origin.z;
+        }
+
+        /**
+         * node 以下の HlodInfo を、頂点に transform_point を掛けた座標系でのものに変換します。
+         * 範囲は直方体の8つの角を変換し、その最小・最大を取り直します。座標軸の変換で符号が反転すると最小と最大が入れ替わるためです。
+         * 表示を切り替える距離は単位の変換に合わせて scale 倍します。
+         */
+        template<typename TransformPoint>
+        void transformHlodInfoRecursive(Node& node, const TransformPoint& transform_point, const double scale) { // NOLINT(misc-no-recursion)
+            if (node.getHlodInfo().has_value()) {
+                auto hlod_info = node.getHlodInfo().value();
+                const auto& min = hlod_info.bounds_min;
+                const auto& max = hlod_info.bounds_max;
+                TVec3d new_min, new_max;
+                for (int corner = 0; corner < 8; corner++) {
+                    const auto point = transform_point(TVec3d(
+                            (corner & 1) ? max.x : min.x, (corner & 2) ? max.y : min.y, (corner & 4) ? max.z : min.z));
+                    if (corner == 0) {
+                        new_min = new_max = point;
+                        continue;
+                    }
+                    new_min = TVec3d(std::min(new_min.x, point.x), std::min(new_min.y, point.y), std::min(new_min.z, point.z));
+                    new_max = TVec3d(std::max(new_max.x, point.x), std::max(new_max.y, point.y), std::max(new_max.z, point.z));
+                }
+                hlod_info.bounds_min = new_min;
+                hlod_info.bounds_max = new_max;
+                hlod_info.switch_distance *= scale;
+                node.setHlodInfo(hlod_info);
+            }
+            for (unsigned i = 0; i < node.getChildCount(); i++) {
+                transformHlodInfoRecursive(node.getChildAt(i), transform_point, scale);
+            }
+        }
+
+        /// node 以下のメッシュをすべて集めます。 Model::getAllMeshes と異なり、三角形のないメッシュも含めます。
+        void collectMeshes(const Node& node, std::vector<Mesh*>& out_meshes) { // NOLINT(misc-no-recursion)
+            if (node.getMesh() != nullptr) out_meshes.push_back(node.getMesh());
+            for (size_t i = 0; i < node.getChildCount(); i++) {
+                collectMeshes(node.getChildAt(i), out_meshes);
+            }
+        }
+    }
+
+    void ModelReprojector::reproject(Model& model, const GeoReference& from, const GeoReference& to,
+                                     const unsigned thread_count) {
+        // 座標軸の変換で鏡像になるかどうかは、抽出時と同じく ENU から見た反転の有無の XOR で決まります。
+        const bool invert_mesh_front_back =
+                MeshFactory::shouldInvertIndicesOnMeshConvert(from.getCoordinateSystem()) !=
+                MeshFactory::shouldInvertIndicesOnMeshConvert(to.getCoordinateSystem());
+        const bool is_same_zone = from.getZoneID() == to.getZoneID();
+        const auto affine = computeAffine(from, to);
+        if (is_same_zone && affine.isIdentity() && !invert_mesh_front_back) return;
+
+        std::vector<Mesh*> meshes;
+        for (size_t i = 0; i < model.getRootNodeCount(); i++) {
+            collectMeshes(model.getRootNodeAt(i), meshes);
+        }
+        ThreadPool(thread_count).parallelFor(meshes.size(), [&](size_t i) {
+            auto& mesh = *meshes.at(i);
+            auto& vertices = mesh.getVertices();
+            if (is_same_zone) {
+                applyAffine(vertices, affine);
+            } else {
+                // 系番号が異なると平面直角座標どうしの関係は非線形なので、緯度・経度を経由します。
+                for (auto& vertex : vertices) {
+                    vertex = to.project(from.unproject(vertex));
+                }
+            }
+            if (invert_mesh_front_back) mesh.invertMeshFrontBack();
+            // 地物ごとの範囲の AABB は変換前の座標のままなので作り直します。
+            // 座標軸の変換で鏡像になると最小と最大が入れ替わり、系番号が異なると AABB はアフィン変換では求まらないためです。
+            if (!mesh.getCityObjectRanges().empty()) mesh.buildCityObjectRanges();
+        });
+
+        // HLOD の範囲は頂点と同じ座標、切り替えの距離は頂点と同じ単位なので、頂点に合わせて変換します。
+        const auto unit_scale = static_cast<double>(from.getUnitScale()) / static_cast<double>(to.getUnitScale());
+        for (size_t i = 0; i < model.getRootNodeCount(); i++) {
+            transformHlodInfoRecursive(model.getRootNodeAt(i), [&](const TVec3d& point) {
+                return is_same_zone ? applyAffine(point, affine) : to.project(from.unproject(point));
+            }, unit_scale);
+        }
+
+        // インスタンスプロトタイプは配置の基準点を原点とするローカル座標なので、座標軸と単位の変換 (線形部分) のみを掛けます。
+        auto linear = affine;
+        linear.t = TVec3d(0, 0, 0);
+        for (size_t i = 0; i < model.getInstancePrototypeCount(); i++) {
+            auto& prototype = model.getInstancePrototypeAt(i);
+            applyAffine(prototype.getVertices(), linear);
+            if (invert_mesh_front_back) prototype.invertMeshFrontBack();
+        }
+        for (auto& instance : model.getMeshInstances()) {
+            // 系番号が異なる場合、基準点は緯度・経度を経由して変換します。系の間の回転の違いは考慮しません。
+            transformInstance(instance.transform, affine, [&](const TVec3d& origin) {
+                return is_same_zone ? applyAffine(origin, affine) : to.project(from.unproject(origin));
+            });
+        }
+    }
+}
@@ -0,0 +1,346 @@
+#include "model_tile_splitter.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <map>
+
+namespace plateau::polygonMesh {
+    using namespace plateau::geometry;
+
+    namespace {
+        /**
+         * 三角形をどのタイルに振り分けるかを決めます。
+         * 三角形ごとに緯度・経度へ逆変換するのを避けるため、各タイルの四隅を最初に1回だけ平面直角座標に変換し、
+         * 平面上の四角形 (ENU の xy) との内外判定で振り分けます。
+         * 平面上ではタイルの辺を四隅を結ぶ直線とみなします。数km程度のタイルであれば、緯線・経線との差は無視できる大きさです。
+         */
+        class TileRouter {
+        public:
+            TileRouter(const std::vector<Extent>& tile_extents, const GeoReference& geo_reference) :
+                    geo_reference_(geo_reference),
+                    bounds_min_(std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), 0),
+                    bounds_max_(std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest(), 0) {
+                quads_.reserve(tile_extents.size());
+                TVec3d max_size(0, 0, 0);
+                for (const auto& extent : tile_extents) {
+                    auto& quad = quads_.emplace_back();
+                    const auto& min = extent.min;
+                    const auto& max = extent.max;
+                    // ENU で反時計回りになるよう、南西・南東・北東・北西の順に並べます。
+                    quad.corners = {
+                            toPlane(GeoCoordinate(min.latitude, min.longitude, 0)),
+                            toPlane(GeoCoordinate(min.latitude, max.longitude, 0)),
+                            toPlane(GeoCoordinate(max.latitude, max.longitude, 0)),
+                            toPlane(GeoCoordinate(max.latitude, min.longitude, 0))};
+                    quad.min = quad.max = quad.corners[0];
+                    for (const auto& corner : quad.corners) {
+                        quad.min.x = std::min(quad.min.x, corner.x);
+                        quad.min.y = std::min(quad.min.y, corner.y);
+                        quad.max.x = std::max(quad.max.x, corner.x);
+                        quad.max.y = std::max(quad.max.y, corner.y);
+                    }
+                    bounds_min_.x = std::min(bounds_min_.x, quad.min.x);
+                    bounds_min_.y = std::min(bounds_min_.y, quad.min.y);
+                    bounds_max_.x = std::max(bounds_max_.x, quad.max.x);
+                    bounds_max_.y = std::max(bounds_max_.y, quad.max.y);
+                    max_size.x = std::max(max_size.x, quad.max.x - quad.min.x);
+                    max_size.y = std::max(max_size.y, quad.max.y - quad.min.y);
+                }
+                buildBuckets(max_size);
+            }
+
+            /// 平面直角座標系の三角形 (a, b, c) が属するタイルの番号を返します。
+            size_t route(const TVec3d& a, const TVec3d& b, const TVec3d& c) const {
+                const auto centroid = geo_reference_.convertAxisToENU((a + b + c) / 3.0);
+                const auto found = find(centroid);
+                if (found >= 0) return static_cast<size_t>(found);
+
+                // 重心が範囲外になるのは、範囲で切り取らずに範囲をはみ出すポリゴンを抽出した場合です。
+                for (const auto& vertex : {a, b, c}) {
+                    const auto found_by_vertex = find(geo_reference_.convertAxisToENU(vertex));
+                    if (found_by_vertex >= 0) return static_cast<size_t>(found_by_vertex);
+                }
+                return nearestTile(centroid);
+            }
+
+            /// 平面直角座標系の点 point が属するタイルの番号を返します。
+            size_t route(const TVec3d& point) const {
+                const auto enu = geo_reference_.convertAxisToENU(point);
+                const auto found = find(enu);
+                if (found >= 0) return static_cast<size_t>(found);
+                return nearestTile(enu);
+            }
+
+        private:
+            struct Quad {
+                std::array<TVec3d, 4> corners;
+                TVec3d min;
+                TVec3d max;
+
+                bool contains(const TVec3d& enu) const {
+                    if (enu.x < min.x || enu.x > max.x || enu.y < min.y || enu.y > max.y) return false;
+                    for (size_t i = 0; i < corners.size(); i++) {
+                        const auto& from = corners[i];
+                        const auto& to = corners[(i + 1) % corners.size()];
+                        const auto cross = (to.x - from.x) * (enu.y - from.y) - (to.y - from.y) * (enu.x - from.x);
+                        if (cross < 0) return false;
+                    }
+                    return true;
+                }
+            };
+
+            TVec3d toPlane(const GeoCoordinate& coordinate) const {
+                return geo_reference_.convertAxisToENU(geo_reference_.project(coordinate));
+            }
+
+            /**
+             * タイル全体の外接矩形を、最も大きいタイルの外接矩形と同じ大きさの升目に分け、升目ごとに重なるタイルの番号を記録します。
+             * 点の判定ではその点の升目に記録されたタイルだけを調べるため、タイルの数が多くても判定の手間はほぼ一定です。
+             */
+            void buildBuckets(const TVec3d& max_size) {
+                if (quads_.empty()) return;
+                static constexpr size_t max_bucket_count_per_axis = 1024;
+                const auto cellCount = [](const double extent_size, const double cell_size) {
+                    if (cell_size <= 0) return size_t(1);
+                    const auto count = static_cast<size_t>(std::ceil(extent_size / cell_size));
+                    return std::clamp(count, size_t(1), max_bucket_count_per_axis);
+                };
+                bucket_count_x_ = cellCount(bounds_max_.x - bounds_min_.x, max_size.x);
+                bucket_count_y_ = cellCount(bounds_max_.y - bounds_min_.y, max_size.y);
+                cell_size_x_ = (bounds_max_.x - bounds_min_.x) / static_cast<double>(bucket_count_x_);
+                cell_size_y_ = (bounds_max_.y - bounds_min_.y) / static_cast<double>(bucket_count_y_);
+                buckets_.assign(bucket_count_x_ * bucket_count_y_, {});
+                // 番号の小さいタイルから登録するため、升目内の候補は番号順に並びます。
+                for (size_t i = 0; i < quads_.size(); i++) {
+                    const auto& quad = quads_.at(i);
+                    const auto x_begin = cellX(quad.min.x);
+                    const auto x_end = cellX(quad.max.x);
+                    const auto y_begin = cellY(quad.min.y);
+                    const auto y_end = cellY(quad.max.y);
+                    for (auto y = y_begin; y <= y_end; y++) {
+                        for (auto x = x_begin; x <= x_end; x++) {
+                            buckets_.at(y * bucket_count_x_ + x).push_back(i);
+                        }
+                    }
+                }
+            }
+
+            size_t cellX(const double x) const {
+                if (cell_size_x_ <= 0) return 0;
+                const auto cell = static_cast<long long>((x - bounds_min_.x) / cell_size_x_);
+                return static_cast<size_t>(std::clamp(cell, 0LL, static_cast<long long>(bucket_count_x_) - 1));
+            }
+
+            size_t cellY(const double y) const {
+                if (cell_size_y_ <= 0) return 0;
+                const auto cell = static_cast<long long>((y - bounds_min_.y) / cell_size_y_);
+                return static_cast<size_t>(std::clamp(cell, 0LL, static_cast<long long>(bucket_count_y_) - 1));
+            }
+
+            /// ENU の点を含むタイルのうち、番号が最も小さいものを返します。なければ -1 です。
+            long long find(const TVec3d& enu) const {
+                if (buckets_.empty() ||
+                    enu.x < bounds_min_.x || enu.x > bounds_max_.x || enu.y < bounds_min_.y || enu.y > bounds_max_.y) {
+                    return -1;
+                }
+                for (const auto tile : buckets_.at(cellY(enu.y) * bucket_count_x_ + cellX(enu.x))) {
+                    if (quads_.at(tile).contains(enu)) return static_cast<long long>(tile);
+                }
+                return -1;
+            }
+
+            size_t nearestTile(const TVec3d& enu) const {
+                size_t nearest = 0;
+                double nearest_distance = std::numeric_limits<double>::max();
+                for (size_t i = 0; i < quads_.size(); i++) {
+                    const auto& quad = quads_.at(i);
+                    const auto d_x = (quad.min.x + quad.max.x) / 2.0 - enu.x;
+                    const auto d_y = (quad.min.y + quad.max.y) / 2.0 - enu.y;
+                    const auto distance = d_x * d_x + d_y * d_y;
+                    if (distance < nearest_distance) {
+                        nearest_distance = distance;
+                        nearest = i;
+                    }
+                }
+                return nearest;
+            }
+
+            const GeoReference& geo_reference_;
+            std::vector<Quad> quads_;
+            TVec3d bounds_min_;
+            TVec3d bounds_max_;
+            size_t bucket_count_x_ = 0;
+            size_t bucket_count_y_ = 0;
+            double cell_size_x_ = 0;
+            double cell_size_y_ = 0;
+            /// 升目ごとの、その升目と外接矩形が重なるタイルの番号です。
+            std::vector<std::vector<size_t>> buckets_;
+        };
+
+        /// 1つのタイルに属するメッシュを組み立てます。
+        struct TileMeshBuilder {
+            std::vector<TVec3d> vertices;
+            std::vector<unsigned> indices;
+            UV uv1;
+            UV uv4;
+            std::vector<TVec3d> vertex_colors;
+            std::vector<SubMesh> sub_meshes;
+            /// 元のメッシュの頂点番号から、このタイルでの頂点番号への対応です。未登録は -1 です。
+            std::vector<long long> vertex_map;
+            /// 最後に追加したサブメッシュが元のメッシュの何番目のサブメッシュに由来するかです。
+            long long last_source_sub_mesh = -1;
+
+            unsigned addVertex(const Mesh& src, const unsigned src_index) {
+                if (vertex_map.empty()) vertex_map.assign(src.getVertices().size(), -1);
+                auto& mapped = vertex_map.at(src_index);
+                if (mapped < 0) {
+                    mapped = static_cast<long long>(vertices.size());
+                    vertices.push_back(src.getVertices().at(src_index));
+                    const auto& src_uv1 = src.getUV1();
+                    uv1.push_back(src_index < src_uv1.size() ? src_uv1.at(src_index) : TVec2f(0, 0));
+                    const auto& src_uv4 = src.getUV4();
+                    uv4.push_back(src_index < src_uv4.size() ? src_uv4.at(src_index) : TVec2f(0, 0));
+                    const auto& src_colors = src.getVertexColors();
+                    if (src_index < src_colors.size()) vertex_colors.push_back(src_colors.at(src_index));
+                }
+                return static_cast<unsigned>(mapped);
+            }
+
+            void addTriangle(const Mesh& src, const size_t first_index, const long long source_sub_mesh) {
+                const auto start = indices.size();
+                const auto& src_indices = src.getIndices();
+                for (size_t i = first_index; i < first_index + 3; i++) {
+                    indices.push_back(addVertex(src, src_indices.at(i)));
+                }
+                if (source_sub_mesh < 0) {
+                    // サブメッシュのない三角形を挟んだ後は、同じサブメッシュ由来でも新しいサブメッシュとします。
+                    last_source_sub_mesh = -1;
+                    return;
+                }
+
+                // 元のメッシュで同じサブメッシュに属する三角形が連続する限り、サブメッシュを広げます。
+                if (source_sub_mesh == last_source_sub_mesh && !sub_meshes.empty()) {
+                    sub_meshes.back().setEndIndex(indices.size() - 1);
+                    return;
+                }
+                const auto& src_sub_mesh = src.getSubMeshes().at(source_sub_mesh);
+                sub_meshes.emplace_back(start, indices.size() - 1, src_sub_mesh.getTexturePath(),
+                                        src_sub_mesh.getMaterial(), src_sub_mesh.getGameMaterialID());
+                last_source_sub_mesh = source_sub_mesh;
+            }
+
+            std::unique_ptr<Mesh> build(const Mesh& src) {
+                if (indices.empty()) return nullptr;
+                auto city_object_list = src.getCityObjectList();
+                auto mesh = std::make_unique<Mesh>(
+                        std::move(vertices), std::move(indices), std::move(uv1), std::move(uv4),
+                        std::move(sub_meshes), std::move(city_object_list));
+                if (!vertex_colors.empty()) mesh->setVertexColors(vertex_colors);
+                return mesh;
+            }
+        };
+
+        /// src を三角形ごとにタイルへ振り分け、タイルごとのメッシュを返します。三角形のないタイルは nullptr です。
+        std::vector<std::unique_ptr<Mesh>> splitMesh(const Mesh& src, const size_t tile_count, const TileRouter& router) {
+            std::vector<TileMeshBuilder> builders(tile_count);
+            const auto& vertices = src.getVertices();
+            const auto& indices = src.getIndices();
+            const auto& sub_meshes = src.getSubMeshes();
+
+            long long sub_mesh_index = sub_meshes.empty() ? -1 : 0;
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                // サブメッシュは indices の前から順に並んでいるため、三角形の位置に合わせて進めます。
+                while (sub_mesh_index >= 0 && sub_mesh_index < static_cast<long long>(sub_meshes.size()) &&
+                       sub_meshes.at(sub_mesh_index).getEndIndex() < i) {
+                    sub_mesh_index++;
+                }
+                const bool is_in_sub_mesh =
+                        sub_mesh_index >= 0 && sub_mesh_index < static_cast<long long>(sub_meshes.size()) &&
+                        sub_meshes.at(sub_mesh_index).getStartIndex() <= i;
+                const auto source_sub_mesh = is_in_sub_mesh ? sub_mesh_index : -1;
+
+                const auto tile = router.route(
+                        vertices.at(indices[i]), vertices.at(indices[i + 1]), vertices.at(indices[i + 2]));
+                builders.at(tile).addTriangle(src, i, source_sub_mesh);
+            }
+
+            std::vector<std::unique_ptr<Mesh>> meshes;
+            meshes.reserve(tile_count);
+            for (auto& builder : builders) {
+                meshes.push_back(builder.build(src));
+            }
+            return meshes;
+        }
+
+        /// src 以下の階層構造をタイルごとに複製し、メッシュはタイルごとに振り分けます。
+        std::vector<Node> splitNode(const Node& src, const size_t tile_count, const TileRouter& router) {
+            std::vector<std::unique_ptr<Mesh>> meshes(tile_count);
+            if (src.getMesh() != nullptr) {
+                meshes = splitMesh(*src.getMesh(), tile_count, router);
+            }
+
+            std::vector<Node> nodes;
+            nodes.reserve(tile_count);
+            for (size_t tile = 0; tile < tile_count; tile++) {
+                auto& node = nodes.emplace_back(src.getName(), std::move(meshes.at(tile)));
+                node.setLocalPosition(src.getLocalPosition());
+                node.setLocalRotation(src.getLocalRotation());
+                node.setLocalScale(src.getLocalScale());
+                node.reserveChild(src.getChildCount());
+            }
+
+            for (unsigned i = 0; i < src.getChildCount(); i++) {
+                auto children = splitNode(src.getChildAt(i), tile_count, router);
+                for (size_t tile = 0; tile < tile_count; tile++) {
+                    nodes.at(tile).addChildNode(std::move(children.at(tile)));
+                }
+            }
+            return nodes;
+        }
+    }
+
+    std::vector<std::shared_ptr<Model>> ModelTileSplitter::split(
+            const Model& model, const std::vector<Extent>& tile_extents, const GeoReference& geo_reference) {
+
+        const auto tile_count = tile_extents.size();
+        std::vector<std::shared_ptr<Model>> tile_models;
+        tile_models.reserve(tile_count);
+        for (size_t tile = 0; tile < tile_count; tile++) {
+            tile_models.push_back(std::make_shared<Model>());
+            tile_models.back()->reserveRootNodes(model.getRootNodeCount());
+        }
+        if (tile_count == 0) return tile_models;
+
+        const TileRouter router(tile_extents, geo_reference);
+        for (size_t i = 0; i < model.getRootNodeCount(); i++) {
+            auto nodes = splitNode(model.getRootNodeAt(i), tile_count, router);
+            for (size_t tile = 0; tile < tile_count; tile++) {
+                tile_models.at(tile)->addNode(std::move(nodes.at(tile)));
+            }
+        }
+
+        for (auto& tile_model : tile_models) {
+            tile_model->eraseEmptyNodes();
+        }
+
+        // 暗黙的ジオメトリの配置は、基準点が属するタイルに振り分けます。形状はそれを使うタイルにのみ複製します。
+        std::vector<std::map<size_t, size_t>> prototype_maps(tile_count);
+        for (const auto& instance : model.getMeshInstances()) {
+            const auto tile = router.route(TVec3d(instance.transform[3], instance.transform[7], instance.transform[11]));
+            auto& tile_model = *tile_models.at(tile);
+            auto& prototype_map = prototype_maps.at(tile);
+            auto found = prototype_map.find(instance.prototype_index);
+            if (found == prototype_map.end()) {
+                const auto new_index = tile_model.addInstancePrototype(
+                        std::make_unique<Mesh>(model.getInstancePrototypeAt(instance.prototype_index)));
+                found = prototype_map.emplace(instance.prototype_index, new_index).first;
+            }
+            auto tile_instance = instance;
+            tile_instance.prototype_index = found->second;
+            tile_model.addMeshInstance(std::move(tile_instance));
+        }
+        return tile_models;
+    }
+}
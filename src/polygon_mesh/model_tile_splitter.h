@@ -0,0 +1,32 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <plateau/polygon_mesh/model.h>
+#include <plateau/geometry/geo_coordinate.h>
+#include <plateau/geometry/geo_reference.h>
+
+namespace plateau::polygonMesh {
+
+    /**
+     * 抽出済みの Model を、タイルとなる範囲ごとの Model に分けます。
+     * 複数の範囲をまとめて1回で抽出し、その結果を範囲ごとに振り分けるために利用します。
+     *
+     * 三角形は重心が含まれる範囲に振り分けられ、どの三角形もちょうど1つのタイルに属します。
+     * 重心がどの範囲にも含まれない三角形は、頂点が含まれる範囲、それもなければ中心が最も近い範囲に振り分けます。
+     * 抽出時に clip_polygons_to_extent を指定しておけば、三角形は範囲の境界で分割済みなので、振り分けは範囲と正確に一致します。
+     */
+    class ModelTileSplitter {
+    public:
+        /**
+         * model を tile_extents の各範囲に分け、 tile_extents と同じ順番で Model を返します。
+         * geo_reference は各範囲の四隅を model と同じ平面直角座標に変換するために使い、抽出時と同じものである必要があります。
+         * 振り分けは平面上で行い、範囲の辺は四隅を結ぶ直線とみなします。
+         * 各タイルのノードの階層構造と名前は model と同じであり、そのタイルに三角形を持たないノードは除かれます。
+         * model が暗黙的ジオメトリの配置 (MeshInstance) を持つ場合、配置は基準点が含まれるタイルに振り分けます。
+         */
+        static std::vector<std::shared_ptr<Model>> split(
+                const Model& model, const std::vector<plateau::geometry::Extent>& tile_extents,
+                const plateau::geometry::GeoReference& geo_reference);
+    };
+}
@@ -75,6 +75,14 @@ namespace plateau::polygonMesh {
         return local_transform_;
     }
 
+    const std::optional<HlodInfo>& Node::getHlodInfo() const {
+        return hlod_info_;
+    }
+
+    void Node::setHlodInfo(const HlodInfo& hlod_info) {
+        hlod_info_ = hlod_info;
+    }
+
     bool Node::hasVertices() const {
         return mesh_ != nullptr && mesh_->hasVertices();
     }
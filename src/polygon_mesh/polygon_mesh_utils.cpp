@@ -36,22 +36,28 @@ namespace plateau::polygonMesh {
 
 
     TVec3d PolygonMeshUtils::cityObjPos(const CityObject& city_obj) {
+        const auto position = findCityObjPos(city_obj);
+        if (position.has_value()) return position.value();
+        // 位置が不明
+        throw std::invalid_argument("Could not find position of CityObject.");
+    }
+
+    std::optional<TVec3d> PolygonMeshUtils::findCityObjPos(const CityObject& city_obj) {
         auto& envelope = city_obj.getEnvelope();
         if (envelope.validBounds()) {
             // city_obj の envelope 情報がGMLファイル中に記載されていれば、その中心を返します。
             // しかし、CityObjectごとに記載されているケースは少ないです。
             return (envelope.getLowerBound() + envelope.getUpperBound()) * 0.5;
-        } else {
-            // envelope がなければ、ポリゴンを検索して見つかった最初の頂点の位置を返します。
-            for (int lod = 0; lod <= max_lod_in_specification_; lod++) {
-                auto poly = findFirstPolygon(&city_obj, lod);
-                if (poly) {
-                    return poly->getVertices().at(0);
-                }
+        }
+        // envelope がなければ、ポリゴンを検索して見つかった最初の頂点の位置を返します。
+        for (int lod = 0; lod <= max_lod_in_specification_; lod++) {
+            auto poly = findFirstPolygon(&city_obj, lod);
+            if (poly) {
+                return poly->getVertices().at(0);
             }
         }
         // 位置が不明
-        throw std::invalid_argument("Could not find position of CityObject.");
+        return std::nullopt;
     }
 
     TVec3d PolygonMeshUtils::getCenterPoint(const CityModel& city_model, int coordinate_zone_id) {
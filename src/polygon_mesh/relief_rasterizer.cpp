@@ -0,0 +1,379 @@
+#include <plateau/polygon_mesh/relief_rasterizer.h>
+#include <plateau/polygon_mesh/mesh_factory.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <stdexcept>
+
+namespace plateau::polygonMesh {
+    using namespace plateau::geometry;
+
+    namespace {
+        /// 標本点の位置を cell_size の整数倍に揃えるときの、浮動小数点の誤差の許容量です。
+        constexpr double grid_epsilon = 1e-9;
+
+        void collectMeshes(const Node& node, std::vector<const Mesh*>& out_meshes) {
+            if (node.polygonExists()) out_meshes.push_back(node.getMesh());
+            for (size_t i = 0; i < node.getChildCount(); i++) {
+                collectMeshes(node.getChildAt(i), out_meshes);
+            }
+        }
+
+        /// メッシュの頂点を、東・北・上を x, y, z とする座標に変換したものです。
+        struct EnuMesh {
+            const Mesh* mesh;
+            std::vector<TVec3d> vertices;
+        };
+
+        /// 三角形の高さを格子の標本点に書き込みます。
+        class TriangleRasterizer {
+        public:
+            explicit TriangleRasterizer(ReliefHeightMap& height_map) :
+                    height_map_(height_map) {
+            }
+
+            void rasterize(const TVec3d& a, const TVec3d& b, const TVec3d& c, const int city_object_index) {
+                // 真上から見た面積が 0 の三角形(垂直な面や潰れた三角形)は高さを決められないため除きます。
+                const auto det = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+                if (std::abs(det) <= std::numeric_limits<double>::epsilon()) return;
+
+                const auto& map = height_map_;
+                const auto column_range = toIndexRange(
+                        std::min({a.x, b.x, c.x}), std::max({a.x, b.x, c.x}), map.origin_east, map.column_count);
+                const auto row_range = toIndexRange(
+                        std::min({a.y, b.y, c.y}), std::max({a.y, b.y, c.y}), map.origin_north, map.row_count);
+
+                // 辺の上の標本点がどちらの三角形からも漏れないよう、わずかに外側も含みます。
+                constexpr double barycentric_epsilon = 1e-7;
+                for (auto row = row_range.first; row < row_range.second; row++) {
+                    const auto y = map.origin_north + static_cast<double>(row) * map.cell_size;
+                    for (auto column = column_range.first; column < column_range.second; column++) {
+                        const auto x = map.origin_east + static_cast<double>(column) * map.cell_size;
+                        const auto u = ((x - a.x) * (c.y - a.y) - (c.x - a.x) * (y - a.y)) / det;
+                        const auto v = ((b.x - a.x) * (y - a.y) - (x - a.x) * (b.y - a.y)) / det;
+                        if (u < -barycentric_epsilon || v < -barycentric_epsilon ||
+                            u + v > 1 + barycentric_epsilon) continue;
+
+                        const auto height = static_cast<float>(a.z + u * (b.z - a.z) + v * (c.z - a.z));
+                        const auto index = row * map.column_count + column;
+                        auto& current = height_map_.heights[index];
+                        if (std::isnan(current) || height > current) {
+                            current = height;
+                            height_map_.city_object_indices[index] = city_object_index;
+                        }
+                    }
+                }
+            }
+
+        private:
+            /// 座標の範囲 [min, max] に含まれる標本点の番号の範囲 [first, second) を返します。
+            std::pair<size_t, size_t> toIndexRange(const double min, const double max, const double origin,
+                                                   const size_t count) const {
+                const auto cell_size = height_map_.cell_size;
+                const auto first = std::max(0.0, std::ceil((min - origin) / cell_size - grid_epsilon));
+                const auto last = std::floor((max - origin) / cell_size + grid_epsilon);
+                if (last < first) return {0, 0};
+                return {static_cast<size_t>(first),
+                        std::min(count, static_cast<size_t>(last) + 1)};
+            }
+
+            ReliefHeightMap& height_map_;
+        };
+
+        /// 三角形の高さを与えた地物の gml:id に、 ReliefHeightMap での番号を振ります。
+        class CityObjectIdRegistry {
+        public:
+            explicit CityObjectIdRegistry(std::vector<std::string>& gml_ids) :
+                    gml_ids_(gml_ids) {
+            }
+
+            /// mesh の頂点 vertex_index が属する主要地物の番号を返します。 gml:id が分からなければ -1 です。
+            int find(const Mesh& mesh, const unsigned vertex_index) {
+                const auto& uv4 = mesh.getUV4();
+                if (vertex_index >= uv4.size()) return -1;
+                const auto primary = CityObjectIndex::fromUV(uv4[vertex_index]).primary_index;
+                std::string gml_id;
+                if (!mesh.getCityObjectList().tryGetPrimaryGmlID(primary, gml_id)) return -1;
+
+                const auto found = indices_.find(gml_id);
+                if (found != indices_.end()) return found->second;
+                const auto index = static_cast<int>(gml_ids_.size());
+                gml_ids_.push_back(gml_id);
+                indices_.emplace(gml_id, index);
+                return index;
+            }
+
+        private:
+            std::vector<std::string>& gml_ids_;
+            std::map<std::string, int> indices_;
+        };
+
+        /**
+         * ReliefHeightMap の標本点のうち、列・行の範囲を切り出した格子状のメッシュを作ります。
+         * スカートの深さが正のときは、範囲の外周に沿って、外周の頂点から真下に下ろした垂直な面(スカート)を加えます。
+         * 隣り合うメッシュの解像度が異なっていても、継ぎ目の隙間はスカートで隠れます。
+         */
+        class GridMeshBuilder {
+        public:
+            GridMeshBuilder(const ReliefHeightMap& height_map, const GeoReference& geo_reference) :
+                    height_map_(height_map),
+                    geo_reference_(geo_reference) {
+            }
+
+            /// 列 [column_begin, column_end]、行 [row_begin, row_end] の範囲のメッシュを作ります。三角形がなければ nullptr を返します。
+            std::unique_ptr<Mesh> build(const size_t column_begin, const size_t column_end,
+                                        const size_t row_begin, const size_t row_end, const double skirt_depth) const {
+                const auto column_count = column_end - column_begin + 1;
+                const auto row_count = row_end - row_begin + 1;
+
+                float lowest = std::numeric_limits<float>::max();
+                for (size_t row = row_begin; row <= row_end; row++) {
+                    for (size_t column = column_begin; column <= column_end; column++) {
+                        if (height_map_.hasHeight(column, row)) lowest = std::min(lowest, height_map_.getHeight(column, row));
+                    }
+                }
+                if (lowest == std::numeric_limits<float>::max()) return nullptr;
+
+                Buffers buffers;
+                const auto sample_count = column_count * row_count;
+                buffers.vertices.reserve(sample_count);
+                buffers.uv1.reserve(sample_count);
+                buffers.uv4.reserve(sample_count);
+                for (size_t row = row_begin; row <= row_end; row++) {
+                    for (size_t column = column_begin; column <= column_end; column++) {
+                        const auto height = height_map_.getHeight(column, row);
+                        addVertex(buffers, column, row, std::isnan(height) ? lowest : height,
+                                  column_count > 1 ? static_cast<float>(column - column_begin) / static_cast<float>(column_count - 1) : 0.0f,
+                                  row_count > 1 ? static_cast<float>(row - row_begin) / static_cast<float>(row_count - 1) : 0.0f);
+                    }
+                }
+                const auto vertexAt = [&](const size_t column, const size_t row) {
+                    return static_cast<unsigned>((row - row_begin) * column_count + (column - column_begin));
+                };
+
+                // 上から見て反時計回りになるよう、格子ごとに2つの三角形を作ります。
+                buffers.indices.reserve((column_count - 1) * (row_count - 1) * 6);
+                for (size_t row = row_begin; row < row_end; row++) {
+                    for (size_t column = column_begin; column < column_end; column++) {
+                        if (!height_map_.hasHeight(column, row) || !height_map_.hasHeight(column + 1, row) ||
+                            !height_map_.hasHeight(column, row + 1) || !height_map_.hasHeight(column + 1, row + 1)) continue;
+                        const auto south_west = vertexAt(column, row);
+                        const auto south_east = vertexAt(column + 1, row);
+                        const auto north_west = vertexAt(column, row + 1);
+                        const auto north_east = vertexAt(column + 1, row + 1);
+                        buffers.indices.insert(buffers.indices.end(), {south_west, south_east, north_east,
+                                                                       south_west, north_east, north_west});
+                    }
+                }
+                if (buffers.indices.empty()) return nullptr;
+
+                if (skirt_depth > 0) {
+                    // 外周の各辺を、外側から見て左から右へ進む順に辿ってスカートを作ります。
+                    std::vector<std::pair<size_t, size_t>> south, east, north, west;
+                    for (auto column = column_begin; column <= column_end; column++) south.emplace_back(column, row_begin);
+                    for (auto row = row_begin; row <= row_end; row++) east.emplace_back(column_end, row);
+                    for (auto column = column_end + 1; column-- > column_begin;) north.emplace_back(column, row_end);
+                    for (auto row = row_end + 1; row-- > row_begin;) west.emplace_back(column_begin, row);
+                    for (const auto edge : {&south, &east, &north, &west}) {
+                        addSkirt(buffers, *edge, vertexAt, skirt_depth);
+                    }
+                }
+
+                CityObjectList city_object_list;
+                for (size_t i = 0; i < height_map_.city_object_gml_ids.size(); i++) {
+                    city_object_list.add(CityObjectIndex(static_cast<int>(i), CityObjectIndex::invalidIndex()),
+                                         height_map_.city_object_gml_ids.at(i));
+                }
+
+                std::vector<SubMesh> sub_meshes = {SubMesh(0, buffers.indices.size() - 1, "", nullptr)};
+                auto mesh = std::make_unique<Mesh>(
+                        std::move(buffers.vertices), std::move(buffers.indices), std::move(buffers.uv1),
+                        std::move(buffers.uv4), std::move(sub_meshes), std::move(city_object_list));
+                if (MeshFactory::shouldInvertIndicesOnMeshConvert(geo_reference_.getCoordinateSystem())) {
+                    mesh->invertMeshFrontBack();
+                }
+                return mesh;
+            }
+
+        private:
+            struct Buffers {
+                std::vector<TVec3d> vertices;
+                std::vector<unsigned> indices;
+                UV uv1;
+                UV uv4;
+            };
+
+            void addVertex(Buffers& buffers, const size_t column, const size_t row, const double height,
+                           const float u, const float v) const {
+                const auto enu = TVec3d(height_map_.origin_east + static_cast<double>(column) * height_map_.cell_size,
+                                        height_map_.origin_north + static_cast<double>(row) * height_map_.cell_size,
+                                        height);
+                buffers.vertices.push_back(GeoReference::convertAxisFromENUTo(geo_reference_.getCoordinateSystem(), enu));
+                buffers.uv1.emplace_back(u, v);
+                const auto city_object_index = height_map_.city_object_indices.at(row * height_map_.column_count + column);
+                buffers.uv4.push_back(CityObjectIndex(std::max(city_object_index, 0), CityObjectIndex::invalidIndex()).toUV());
+            }
+
+            /**
+             * 外側から見て左から右へ並んだ外周の標本点 edge に沿って、スカートの面を加えます。
+             * 外周の頂点の真下に skirt_depth だけ下げた頂点を加え、外側を向いた四角形でつなぎます。
+             * 高さのない標本点をはさむ部分は、地形の面がないためスカートも作りません。
+             */
+            template<typename VertexAt>
+            void addSkirt(Buffers& buffers, const std::vector<std::pair<size_t, size_t>>& edge,
+                          const VertexAt& vertexAt, const double skirt_depth) const {
+                std::vector<unsigned> lowered;
+                lowered.reserve(edge.size());
+                for (const auto& [column, row] : edge) {
+                    const auto top = vertexAt(column, row);
+                    lowered.push_back(static_cast<unsigned>(buffers.vertices.size()));
+                    const auto top_enu = GeoReference::convertAxisToENU(geo_reference_.getCoordinateSystem(), buffers.vertices.at(top));
+                    const auto uv1 = buffers.uv1.at(top);
+                    addVertex(buffers, column, row, top_enu.z - skirt_depth, uv1.x, uv1.y);
+                }
+                for (size_t i = 0; i + 1 < edge.size(); i++) {
+                    const auto [left_column, left_row] = edge.at(i);
+                    const auto [right_column, right_row] = edge.at(i + 1);
+                    if (!height_map_.hasHeight(left_column, left_row) || !height_map_.hasHeight(right_column, right_row)) continue;
+                    const auto top_left = vertexAt(left_column, left_row);
+                    const auto top_right = vertexAt(right_column, right_row);
+                    buffers.indices.insert(buffers.indices.end(), {lowered.at(i), lowered.at(i + 1), top_right,
+                                                                   lowered.at(i), top_right, top_left});
+                }
+            }
+
+            const ReliefHeightMap& height_map_;
+            const GeoReference& geo_reference_;
+        };
+    }
+
+    bool ReliefHeightMap::hasHeight(const size_t column, const size_t row) const {
+        return !std::isnan(getHeight(column, row));
+    }
+
+    float ReliefHeightMap::getHeight(const size_t column, const size_t row) const {
+        return heights.at(row * column_count + column);
+    }
+
+    ReliefHeightMap ReliefRasterizer::rasterize(const Node& node, const GeoReference& geo_reference, const double cell_size) {
+        if (!(cell_size > 0)) throw std::invalid_argument("cell_size must be positive.");
+
+        ReliefHeightMap height_map;
+        height_map.cell_size = cell_size / geo_reference.getUnitScale();
+
+        std::vector<const Mesh*> meshes;
+        collectMeshes(node, meshes);
+
+        // 座標軸によらず、東・北・上の座標で標本化します。
+        std::vector<EnuMesh> enu_meshes;
+        enu_meshes.reserve(meshes.size());
+        auto min = TVec3d(std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), 0);
+        auto max = TVec3d(std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest(), 0);
+        for (const auto mesh : meshes) {
+            auto& enu_mesh = enu_meshes.emplace_back(EnuMesh{mesh, {}});
+            enu_mesh.vertices.reserve(mesh->getVertices().size());
+            for (const auto& vertex : mesh->getVertices()) {
+                const auto enu = geo_reference.convertAxisToENU(vertex);
+                min = TVec3d(std::min(min.x, enu.x), std::min(min.y, enu.y), 0);
+                max = TVec3d(std::max(max.x, enu.x), std::max(max.y, enu.y), 0);
+                enu_mesh.vertices.push_back(enu);
+            }
+        }
+        if (min.x > max.x) return height_map;
+
+        // 標本点は基準点から cell_size の整数倍の位置に置きます。
+        const auto first_column = std::ceil(min.x / height_map.cell_size - grid_epsilon);
+        const auto last_column = std::floor(max.x / height_map.cell_size + grid_epsilon);
+        const auto first_row = std::ceil(min.y / height_map.cell_size - grid_epsilon);
+        const auto last_row = std::floor(max.y / height_map.cell_size + grid_epsilon);
+        if (last_column < first_column || last_row < first_row) return height_map;
+
+        height_map.origin_east = first_column * height_map.cell_size;
+        height_map.origin_north = first_row * height_map.cell_size;
+        height_map.column_count = static_cast<size_t>(last_column - first_column) + 1;
+        height_map.row_count = static_cast<size_t>(last_row - first_row) + 1;
+        const auto sample_count = height_map.column_count * height_map.row_count;
+        height_map.heights.assign(sample_count, std::numeric_limits<float>::quiet_NaN());
+        height_map.city_object_indices.assign(sample_count, -1);
+
+        TriangleRasterizer triangle_rasterizer(height_map);
+        CityObjectIdRegistry city_object_ids(height_map.city_object_gml_ids);
+        for (const auto& enu_mesh : enu_meshes) {
+            const auto& indices = enu_mesh.mesh->getIndices();
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                triangle_rasterizer.rasterize(
+                        enu_mesh.vertices.at(indices[i]), enu_mesh.vertices.at(indices[i + 1]),
+                        enu_mesh.vertices.at(indices[i + 2]), city_object_ids.find(*enu_mesh.mesh, indices[i]));
+            }
+        }
+        return height_map;
+    }
+
+    std::unique_ptr<Mesh> ReliefRasterizer::createGridMesh(const ReliefHeightMap& height_map, const GeoReference& geo_reference) {
+        if (height_map.column_count == 0 || height_map.row_count == 0) return nullptr;
+        return GridMeshBuilder(height_map, geo_reference)
+                .build(0, height_map.column_count - 1, 0, height_map.row_count - 1, 0);
+    }
+
+    std::vector<ReliefChunk> ReliefRasterizer::createChunkMeshes(
+            const ReliefHeightMap& height_map, const GeoReference& geo_reference,
+            const double chunk_size, const double skirt_height) {
+        if (!(chunk_size > 0)) throw std::invalid_argument("chunk_size must be positive.");
+        std::vector<ReliefChunk> chunks;
+        if (height_map.column_count == 0 || height_map.row_count == 0) return chunks;
+
+        // チャンクの境界は、基準点から数えた標本点の番号が chunk_cell_count の倍数となる位置に置きます。
+        // 抽出範囲によらずチャンクの位置が決まるため、別々に抽出した地形でもチャンクの境界が一致します。
+        const auto cell_size_in_meters = height_map.cell_size * geo_reference.getUnitScale();
+        const auto chunk_cell_count = std::max<long long>(1, std::llround(chunk_size / cell_size_in_meters));
+        const auto first_column = std::llround(height_map.origin_east / height_map.cell_size);
+        const auto first_row = std::llround(height_map.origin_north / height_map.cell_size);
+        const auto last_column = first_column + static_cast<long long>(height_map.column_count) - 1;
+        const auto last_row = first_row + static_cast<long long>(height_map.row_count) - 1;
+        const auto floorDiv = [](const long long a, const long long b) {
+            return a >= 0 ? a / b : -((-a + b - 1) / b);
+        };
+
+        const GridMeshBuilder builder(height_map, geo_reference);
+        const auto skirt_depth = skirt_height / geo_reference.getUnitScale();
+        // 隣り合うチャンクは境界の標本点を共有します。最後の標本点がちょうど境界にある場合、その先のチャンクは三角形を持たないため作りません。
+        for (auto chunk_y = floorDiv(first_row, chunk_cell_count);
+             chunk_y * chunk_cell_count < last_row; chunk_y++) {
+            for (auto chunk_x = floorDiv(first_column, chunk_cell_count);
+                 chunk_x * chunk_cell_count < last_column; chunk_x++) {
+                const auto column_begin = std::max(chunk_x * chunk_cell_count, first_column) - first_column;
+                const auto column_end = std::min((chunk_x + 1) * chunk_cell_count, last_column) - first_column;
+                const auto row_begin = std::max(chunk_y * chunk_cell_count, first_row) - first_row;
+                const auto row_end = std::min((chunk_y + 1) * chunk_cell_count, last_row) - first_row;
+                auto mesh = builder.build(column_begin, column_end, row_begin, row_end, skirt_depth);
+                if (mesh == nullptr) continue;
+                chunks.push_back({chunk_x, chunk_y, std::move(mesh)});
+            }
+        }
+        return chunks;
+    }
+
+    Model ReliefRasterizer::rasterizeModel(const Model& src, const GeoReference& geo_reference, const double cell_size,
+                                           const double chunk_size, const double skirt_height) {
+        Model dst;
+        dst.reserveRootNodes(src.getRootNodeCount());
+        for (size_t i = 0; i < src.getRootNodeCount(); i++) {
+            const auto& src_root = src.getRootNodeAt(i);
+            auto& dst_root = dst.addNode(Node(src_root.getName()));
+            const auto height_map = rasterize(src_root, geo_reference, cell_size);
+            if (chunk_size > 0) {
+                for (auto& chunk : createChunkMeshes(height_map, geo_reference, chunk_size, skirt_height)) {
+                    dst_root.addChildNode(Node("relief_chunk_" + std::to_string(chunk.chunk_x) + "_" + std::to_string(chunk.chunk_y),
+                                               std::move(chunk.mesh)));
+                }
+                continue;
+            }
+            auto mesh = createGridMesh(height_map, geo_reference);
+            if (mesh != nullptr) dst_root.addChildNode(Node("relief_grid", std::move(mesh)));
+        }
+        dst.eraseEmptyNodes();
+        return dst;
+    }
+}
@@ -0,0 +1,67 @@
+#include <plateau/polygon_mesh/texture_path_cache.h>
+#include "citygml/texture.h"
+#include "citygml/citymodel.h"
+
+#include <algorithm>
+
+#include <filesystem>
+#include <mutex>
+
+namespace plateau::polygonMesh {
+
+    namespace {
+        const std::string default_theme = "rgbTexture";
+
+        std::string selectTheme(const std::vector<std::string>& themes) {
+            if (themes.empty() || std::find(themes.begin(), themes.end(), default_theme) != themes.end()) {
+                return default_theme;
+            }
+            // rgbTextureのthemeが存在しない場合
+            return themes.at(0);
+        }
+    }
+
+    TexturePathCache::TexturePathCache(std::string gml_path) :
+        gml_path_(std::move(gml_path)),
+        theme_(default_theme) {
+    }
+
+    TexturePathCache::TexturePathCache(const citygml::CityModel& city_model) :
+        gml_path_(city_model.getGmlPath()),
+        theme_(selectTheme(city_model.themes())) {
+    }
+
+    const std::string& TexturePathCache::getGmlPath() const {
+        return gml_path_;
+    }
+
+    const std::string& TexturePathCache::getTheme() const {
+        return theme_;
+    }
+
+    const std::string& TexturePathCache::getAbsolutePath(const citygml::Texture& texture) {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            const auto it = absolute_paths_.find(&texture);
+            if (it != absolute_paths_.end()) return it->second;
+        }
+
+        // パスの変換はロックの外で行います。
+        // 複数スレッドが同時に同じテクスチャを変換した場合は、先に登録されたものを使います。
+        auto absolute_path = toAbsolutePath(texture.getUrl(), gml_path_);
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        // unordered_map の要素への参照は、再ハッシュが起きても無効になりません。
+        return absolute_paths_.emplace(&texture, std::move(absolute_path)).first->second;
+    }
+
+    std::string TexturePathCache::toAbsolutePath(const std::string& texture_url, const std::string& gml_path) {
+        const auto relative_texture_path = std::filesystem::u8path(texture_url);
+        if (!relative_texture_path.is_relative()) return texture_url;
+
+        auto a_path = std::filesystem::u8path(gml_path);
+        a_path = a_path.parent_path();
+        a_path /= relative_texture_path;
+        const auto abs_path = std::filesystem::absolute(a_path);
+        return abs_path.u8string();
+    }
+}
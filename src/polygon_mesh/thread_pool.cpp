@@ -0,0 +1,204 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <exception>
+
+namespace plateau::polygonMesh {
+
+    struct ThreadPool::Job {
+        Job(const std::function<void(size_t)>& task, const size_t count) :
+            task(task),
+            count(count) {
+        }
+
+        const std::function<void(size_t)>& task;
+        /// タスクの数です。例外が起きたときは、それ以降の番号を取り出さないよう取り出し済みの数まで減らします。
+        size_t count;
+        size_t next_index = 0;
+        size_t finished_count = 0;
+        std::exception_ptr first_exception = nullptr;
+        std::condition_variable finished;
+
+        bool isExhausted() const {
+            return next_index >= count;
+        }
+
+        bool isFinished() const {
+            return isExhausted() && finished_count == next_index;
+        }
+    };
+
+    ThreadPool::ThreadPool(const unsigned thread_count) :
+        thread_count_(thread_count),
+        stopping_(false) {
+        if (thread_count_ == 0) {
+            // hardware_concurrency は不明な場合に 0 を返します。
+            thread_count_ = std::max(1u, std::thread::hardware_concurrency());
+        }
+        // 呼び出し元のスレッドもワーカーの1つとして利用するため、作るのは thread_count - 1 個です。
+        workers_.reserve(thread_count_ - 1);
+        try {
+            for (unsigned i = 0; i + 1 < thread_count_; i++) {
+                workers_.emplace_back([this] { workerLoop(); });
+            }
+        } catch (...) {
+            // スレッドを作れなかった分は、作れたスレッドと呼び出し元スレッドで処理します。
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        job_available_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::parallelFor(const size_t count, const std::function<void(size_t)>& task) const {
+        if (workers_.empty() || count <= 1) {
+            for (size_t i = 0; i < count; i++) {
+                task(i);
+            }
+            return;
+        }
+
+        const auto job = std::make_shared<Job>(task, count);
+        std::unique_lock<std::mutex> lock(mutex_);
+        jobs_.push_back(job);
+        job_available_.notify_all();
+
+        // 呼び出し元のスレッドも、自身のジョブの番号がなくなるまで処理します。
+        while (!job->isExhausted()) {
+            const auto index = claimIndex(*job);
+            runTask(*job, index, lock);
+        }
+        // 他のスレッドが処理中のタスクの終了を待ちます。
+        job->finished.wait(lock, [&job] { return job->isFinished(); });
+
+        if (job->first_exception != nullptr) std::rethrow_exception(job->first_exception);
+    }
+
+    void ThreadPool::parallelForInOrder(const size_t count, const size_t window_size,
+                                        const std::function<void(size_t)>& produce,
+                                        const std::function<void(size_t)>& consume) const {
+        if (count == 0) return;
+        const auto window = window_size == 0 ? count : std::min(window_size, count);
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        // 番号ごとに produce が終わったかどうかです。 window 個の場所を使い回します。
+        std::vector<bool> produced(window, false);
+        size_t next_produce = 0;
+        size_t next_consume = 0;
+        std::exception_ptr first_exception = nullptr;
+        const auto consumer_thread = std::this_thread::get_id();
+
+        // スレッドごとに1つのタスクを割り当て、各タスクの中で番号を次々に取り出します。
+        // 呼び出し元のスレッドは、先頭の番号の produce が終わっていれば consume を優先します。
+        parallelFor(thread_count_, [&](size_t) {
+            const bool is_consumer = std::this_thread::get_id() == consumer_thread;
+            std::unique_lock<std::mutex> lock(mutex);
+            while (first_exception == nullptr) {
+                if (is_consumer && next_consume < count && produced.at(next_consume % window)) {
+                    const auto index = next_consume;
+                    lock.unlock();
+                    std::exception_ptr exception = nullptr;
+                    try {
+                        consume(index);
+                    } catch (...) {
+                        exception = std::current_exception();
+                    }
+                    lock.lock();
+                    if (exception != nullptr) {
+                        first_exception = exception;
+                    } else {
+                        produced.at(index % window) = false;
+                        next_consume++;
+                    }
+                    changed.notify_all();
+                    continue;
+                }
+                if (is_consumer && next_consume >= count) break;
+
+                if (next_produce < count && next_produce < next_consume + window) {
+                    const auto index = next_produce++;
+                    lock.unlock();
+                    std::exception_ptr exception = nullptr;
+                    try {
+                        produce(index);
+                    } catch (...) {
+                        exception = std::current_exception();
+                    }
+                    lock.lock();
+                    if (exception != nullptr) {
+                        if (first_exception == nullptr) first_exception = exception;
+                    } else {
+                        produced.at(index % window) = true;
+                    }
+                    changed.notify_all();
+                    continue;
+                }
+                if (!is_consumer && next_produce >= count) break;
+
+                // 呼び出し元のスレッドは先頭の produce の終了を、その他のスレッドは consume による空きを待ちます。
+                changed.wait(lock);
+            }
+        });
+
+        if (first_exception != nullptr) std::rethrow_exception(first_exception);
+    }
+
+    unsigned ThreadPool::getThreadCount() const {
+        return thread_count_;
+    }
+
+    void ThreadPool::workerLoop() const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            job_available_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+            if (jobs_.empty()) return;
+
+            // runTask の間にキューからジョブが外れても参照が残るよう、 shared_ptr をコピーします。
+            const auto job = jobs_.front();
+            const auto index = claimIndex(*job);
+            runTask(*job, index, lock);
+        }
+    }
+
+    void ThreadPool::runTask(Job& job, const size_t index, std::unique_lock<std::mutex>& lock) const {
+        lock.unlock();
+        std::exception_ptr exception = nullptr;
+        try {
+            job.task(index);
+        } catch (...) {
+            exception = std::current_exception();
+        }
+        lock.lock();
+
+        if (exception != nullptr) {
+            if (job.first_exception == nullptr) job.first_exception = exception;
+            // 残りのタスクは実行しません。
+            if (!job.isExhausted()) {
+                job.count = job.next_index;
+                removeJob(job);
+            }
+        }
+        job.finished_count++;
+        if (job.isFinished()) job.finished.notify_all();
+    }
+
+    size_t ThreadPool::claimIndex(Job& job) const {
+        const auto index = job.next_index++;
+        if (job.isExhausted()) removeJob(job);
+        return index;
+    }
+
+    void ThreadPool::removeJob(const Job& job) const {
+        const auto found = std::find_if(jobs_.begin(), jobs_.end(),
+                                        [&job](const std::shared_ptr<Job>& queued) { return queued.get() == &job; });
+        if (found != jobs_.end()) jobs_.erase(found);
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace plateau::polygonMesh {
+    /**
+     * 互いに独立したタスクを複数スレッドで並列に実行します。
+     * ワーカースレッドはコンストラクタで thread_count - 1 個だけ作り、デストラクタまで使い回します。
+     * parallelFor はタスクの一覧をジョブとしてキューに積み、ワーカーと呼び出し元のスレッドが未処理のタスク番号を1つずつ取り出して実行します。
+     * そのため、処理時間にばらつきがあっても早く終わったスレッドが残りのタスクを引き受けます。
+     *
+     * タスクの中から同じ ThreadPool の parallelFor を入れ子で呼ぶこともできます。
+     * そのときも新たにスレッドは作らず、呼び出し元のスレッドと手の空いたワーカーが入れ子のジョブを処理します。
+     * したがって、同時に動くスレッド数は入れ子の深さによらず thread_count 以下になります。
+     */
+    class ThreadPool {
+    public:
+        /**
+         * thread_count は並列数です。 0 のときハードウェアの並列数を利用します。 1 のとき逐次実行となります。
+         */
+        explicit ThreadPool(unsigned thread_count);
+        ~ThreadPool();
+
+        /// ワーカースレッドを所有するため、コピーを禁止します。
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /**
+         * 0 から count - 1 までの各番号について task を実行し、すべて終わるまで待機します。
+         * 実行順序は保証されないため、結果は番号ごとに別の場所に格納してください。
+         * タスクが例外を投げた場合、残りのタスクは実行されず、最初の例外を呼び出し元に投げ直します。
+         */
+        void parallelFor(size_t count, const std::function<void(size_t)>& task) const;
+
+        /**
+         * 0 から count - 1 までの各番号について、 produce を複数スレッドで並列に実行し、
+         * 終わったものから番号順に consume を呼び出し元のスレッドで実行します。
+         * produce(i) は consume(i - window_size) が終わるまで始めないため、 produce の結果を
+         * 番号 % window_size の場所に格納すれば、結果を保持する場所は window_size 個で足ります。
+         * window_size が 0 のときは制限しません。
+         * スレッドは window_size 個のタスクを処理し終えるのを待たず、先頭のタスクが終わり次第その分だけ次のタスクに進みます。
+         * produce または consume が例外を投げた場合、残りのタスクは実行されず、最初の例外を呼び出し元に投げ直します。
+         * 待機中のスレッドが他のジョブを処理することはないため、 produce の中から同じ ThreadPool を使わないでください。
+         */
+        void parallelForInOrder(size_t count, size_t window_size,
+                                const std::function<void(size_t)>& produce,
+                                const std::function<void(size_t)>& consume) const;
+
+        unsigned getThreadCount() const;
+
+    private:
+        struct Job;
+
+        void workerLoop() const;
+        /// job のタスク index を実行し、終了を記録します。 lock は mutex_ を保持した状態で渡し、実行中だけ解放します。
+        void runTask(Job& job, size_t index, std::unique_lock<std::mutex>& lock) const;
+        /// job のタスク番号を1つ取り出します。最後の番号を取り出したらジョブをキューから外します。 mutex_ を保持して呼びます。
+        size_t claimIndex(Job& job) const;
+        void removeJob(const Job& job) const;
+
+        unsigned thread_count_;
+        std::vector<std::thread> workers_;
+        mutable std::mutex mutex_;
+        mutable std::condition_variable job_available_;
+        /// 未処理のタスク番号が残っているジョブです。ワーカーは先頭のジョブから番号を取り出します。
+        mutable std::deque<std::shared_ptr<Job>> jobs_;
+        bool stopping_;
+    };
+}
@@ -4,25 +4,23 @@
 
 namespace plateau::texture {
     namespace fs = std::filesystem;
-    void TextureAtlasCanvas::setDefaultSaveFilePathIfEmpty(const std::string& original_file_path) {
+    void TextureAtlasCanvas::setDefaultSaveFilePathIfEmpty(const std::string& original_file_path, polygonMesh::ExtractSession& session) {
         if (!save_file_path_.empty())
             return;
 
-        auto original_path = std::filesystem::u8path(original_file_path);
+        const auto original_path = std::filesystem::u8path(original_file_path);
         const auto original_filename_without_ext = original_path.filename().replace_extension("").u8string();
 
-        for (int cnt = 0;; ++cnt) {
+        // 書き出しは flush 時なので、それまで他のキャンバスや他の抽出が同じ名前を選ばないよう予約します。
+        const auto path = session.reserveUniquePath([&](const int cnt) {
             std::stringstream ss;
             ss << std::setw(6) << std::setfill('0') << cnt;
             std::string num = ss.str();
 
             const auto new_filename = std::string("packed_image_").append(original_filename_without_ext).append("_").append(num).append(".png");
-            const auto& path = original_path.replace_filename(new_filename);
-            if (!std::filesystem::is_regular_file(path)) {
-                save_file_path_ = path.u8string();
-                break;
-            }
-        }
+            return fs::path(original_path).replace_filename(new_filename);
+        });
+        save_file_path_ = path.u8string();
     }
 
     void TextureAtlasCanvas::setSaveFilePath(const std::filesystem::path& path){
@@ -12,9 +12,14 @@ namespace plateau::texture {
     using namespace polygonMesh;
     namespace fs = std::filesystem;
 
-    TexturePacker::TexturePacker(size_t width, size_t height, const int internal_canvas_count)
+    TexturePacker::TexturePacker(size_t width, size_t height, const int internal_canvas_count, ExtractSession* session)
             : canvas_width_(width)
-            , canvas_height_(height) {
+            , canvas_height_(height)
+            , session_(session) {
+        if (session_ == nullptr) {
+            own_session_ = std::make_unique<ExtractSession>();
+            session_ = own_session_.get();
+        }
         for (auto i = 0; i < internal_canvas_count; ++i) {
             canvases_.push_back(std::make_shared<TextureAtlasCanvas>(width, height));
         }
@@ -186,7 +191,7 @@ namespace plateau::texture {
 
         auto& target_canvas = canvases_.at(out_target_canvas_id);
         image->packTo(&target_canvas->getCanvas(), info.getLeft(), info.getTop());
-        target_canvas->setDefaultSaveFilePathIfEmpty(image->getFilePath());
+        target_canvas->setDefaultSaveFilePathIfEmpty(image->getFilePath(), *session_);
         return info;
     }
 
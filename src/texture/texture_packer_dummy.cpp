@@ -11,9 +11,11 @@ namespace plateau::texture {
      * texture_packer.cpp はモバイル向けのビルドが通らないので、CMakeによって texture_packer_dummy.cpp に置き換えられます。
      */
 
-    TexturePacker::TexturePacker(size_t width, size_t height, const int internal_canvas_count)
+    TexturePacker::TexturePacker(size_t width, size_t height, const int internal_canvas_count,
+                                 plateau::polygonMesh::ExtractSession* session)
         : canvas_width_(width)
-        , canvas_height_(height) {
+        , canvas_height_(height)
+        , session_(session) {
         throw std::runtime_error("not implemented");
     }
 
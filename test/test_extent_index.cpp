@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <plateau/geometry/extent_index.h>
+#include <plateau/dataset/mesh_code.h>
+#include "../src/polygon_mesh/extent_clipper.h"
+
+using namespace plateau::dataset;
+using namespace plateau::geometry;
+
+namespace {
+    bool containsBruteForce(const std::vector<Extent>& extents, const TVec3d& point) {
+        for (const auto& extent : extents) {
+            if (extent.contains(point)) return true;
+        }
+        return false;
+    }
+}
+
+TEST(ExtentIndex, containsMatchesExtentContainsForRandomPoints) {
+    // 隣接するメッシュコードと、離れた範囲を混ぜます。
+    const std::vector<Extent> extents = {
+        MeshCode("53394525").getExtent(),
+        MeshCode("53394526").getExtent(),
+        MeshCode("53394535").getExtent(),
+        MeshCode("5339353714").getExtent(),
+        Extent(GeoCoordinate(35.5, 139.5, 0), GeoCoordinate(35.55, 139.6, 0))
+    };
+    const auto index = ExtentIndex(extents);
+
+    std::mt19937 random(0);
+    std::uniform_real_distribution<double> lat_dist(35.4, 35.8);
+    std::uniform_real_distribution<double> lon_dist(139.4, 139.8);
+    for (int i = 0; i < 10000; i++) {
+        const auto point = TVec3d(lat_dist(random), lon_dist(random), 0);
+        ASSERT_EQ(containsBruteForce(extents, point), index.contains(point));
+    }
+
+    // 境界上の点は範囲内です。
+    for (const auto& extent : extents) {
+        ASSERT_TRUE(index.contains(TVec3d(extent.min.latitude, extent.min.longitude, 0)));
+        ASSERT_TRUE(index.contains(TVec3d(extent.max.latitude, extent.max.longitude, 0)));
+    }
+}
+
+TEST(ExtentIndex, zeroSizeExtentContainsOnlyItsPoint) {
+    const auto point = GeoCoordinate(35.6, 139.7, 0);
+    const auto index = ExtentIndex({Extent(point, point)});
+    ASSERT_TRUE(index.contains(TVec3d(point.latitude, point.longitude, 100)));
+    ASSERT_FALSE(index.contains(TVec3d(point.latitude + 0.000001, point.longitude, 0)));
+}
+
+TEST(ExtentIndex, containsAnyRejectsVerticesOutsideAllExtents) {
+    const auto index = ExtentIndex({MeshCode("53394525").getExtent()});
+    const auto center = MeshCode("53394525").getExtent().centerPoint();
+    const std::vector<TVec3d> far_vertices = {TVec3d(0, 0, 0), TVec3d(1, 1, 0)};
+    const std::vector<TVec3d> crossing_vertices = {TVec3d(0, 0, 0), TVec3d(center.latitude, center.longitude, 0)};
+    ASSERT_FALSE(index.containsAny(far_vertices));
+    ASSERT_TRUE(index.containsAny(crossing_vertices));
+    ASSERT_FALSE(ExtentIndex({}).containsAny(crossing_vertices));
+}
+
+TEST(ExtentClipper, clippedTrianglesOfAdjacentExtentsShareBoundaryWithoutOverlap) {
+    // 2つの範囲にまたがる正方形を、それぞれの範囲で切り取ります。
+    const std::vector<TVec3d> vertices = {TVec3d(0, 0, 0), TVec3d(3, 0, 0), TVec3d(3, 3, 0), TVec3d(0, 3, 0)};
+    const std::vector<unsigned> indices = {0, 1, 2, 0, 2, 3};
+    const std::vector<TVec2f> uv = {TVec2f(0, 0), TVec2f(1, 0), TVec2f(1, 1), TVec2f(0, 1)};
+    const std::vector<Extent> extents = {
+        Extent(GeoCoordinate(1, 1, 0), GeoCoordinate(2, 2, 0)),
+        Extent(GeoCoordinate(2, 1, 0), GeoCoordinate(4, 2, 0))
+    };
+
+    double total_area = 0;
+    for (const auto& extent : extents) {
+        std::vector<TVec3d> out_vertices;
+        std::vector<unsigned> out_indices;
+        std::vector<TVec2f> out_uv;
+        plateau::polygonMesh::ExtentClipper::clip(vertices, indices, uv, {extent}, out_vertices, out_indices, out_uv);
+        ASSERT_EQ(out_vertices.size(), out_uv.size());
+        for (size_t i = 0; i < out_vertices.size(); i++) {
+            ASSERT_TRUE(extent.contains(out_vertices.at(i)));
+            // 元の UV は緯度・経度に比例しているため、補間した UV も同じ関係になります。
+            ASSERT_FLOAT_EQ(out_uv.at(i).x, static_cast<float>(out_vertices.at(i).x / 3));
+            ASSERT_FLOAT_EQ(out_uv.at(i).y, static_cast<float>(out_vertices.at(i).y / 3));
+        }
+        for (size_t i = 0; i < out_indices.size(); i += 3) {
+            const auto& a = out_vertices.at(out_indices.at(i));
+            const auto& b = out_vertices.at(out_indices.at(i + 1));
+            const auto& c = out_vertices.at(out_indices.at(i + 2));
+            const auto area = ((b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x)) / 2;
+            // 三角形の向きは元と同じです。
+            ASSERT_GT(area, 0);
+            total_area += area;
+        }
+    }
+    // 範囲の和集合の面積と一致し、重複がありません。
+    ASSERT_DOUBLE_EQ(total_area, 2.0);
+}
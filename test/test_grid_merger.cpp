@@ -1,6 +1,8 @@
 #include "gtest/gtest.h"
 #include "citygml/citygml.h"
 #include "../src/polygon_mesh/area_mesh_factory.h"
+#include <plateau/polygon_mesh/primary_city_object_types.h>
+#include <map>
 
 using namespace citygml;
 using namespace plateau::polygonMesh;
@@ -41,3 +43,168 @@ TEST_F(GridMergerTest, gridMerge_uv_size_matches_num_of_vertices) { // NOLINT
         ASSERT_EQ(size_of_uv4, num_of_vertices);
     }
 }
+
+TEST_F(GridMergerTest, gridMerge_with_shared_polygon_index_returns_same_meshes) { // NOLINT
+    const auto& primary_objects = city_model_->getAllCityObjectsOfType(PrimaryCityObjectTypes::getPrimaryTypeMask());
+    CityObjectPolygonIndex polygon_index;
+    polygon_index.build(std::vector<const CityObject*>(primary_objects.begin(), primary_objects.end()));
+
+    for (unsigned lod = 0; lod <= 2; lod++) {
+        auto expected = AreaMeshFactory::gridMerge(*city_model_, mesh_extract_options_, lod, geo_reference_, { Extent::all() });
+        auto actual = AreaMeshFactory::gridMerge(*city_model_, mesh_extract_options_, lod, geo_reference_, { Extent::all() }, &polygon_index);
+        ASSERT_EQ(expected.size(), actual.size());
+        for (const auto& [group_id, mesh] : expected) {
+            ASSERT_TRUE(actual.find(group_id) != actual.end());
+            ASSERT_EQ(mesh->getVertices().size(), actual.at(group_id)->getVertices().size());
+            ASSERT_EQ(mesh->getIndices(), actual.at(group_id)->getIndices());
+        }
+    }
+}
+
+TEST_F(GridMergerTest, lod_mask_in_polygon_index_matches_find_first_polygon) { // NOLINT
+    const auto& primary_objects = city_model_->getAllCityObjectsOfType(PrimaryCityObjectTypes::getPrimaryTypeMask());
+    CityObjectPolygonIndex polygon_index;
+    polygon_index.build(std::vector<const CityObject*>(primary_objects.begin(), primary_objects.end()));
+
+    for (const auto primary_object : primary_objects) {
+        const auto lod_mask = polygon_index.getLodMaskRecursive(*primary_object);
+        for (unsigned lod = 0; lod <= PolygonMeshUtils::max_lod_in_specification_; lod++) {
+            ASSERT_EQ(PolygonMeshUtils::findFirstPolygon(primary_object, lod) != nullptr,
+                      CityObjectPolygonIndex::lodMaskContains(lod_mask, lod));
+        }
+    }
+}
+
+TEST_F(GridMergerTest, bounds_cache_position_matches_city_obj_pos) { // NOLINT
+    const auto& primary_objects = city_model_->getAllCityObjectsOfType(PrimaryCityObjectTypes::getPrimaryTypeMask());
+    auto city_objects = std::vector<const CityObject*>(primary_objects.begin(), primary_objects.end());
+    for (const auto primary_object : primary_objects) {
+        for (const auto child : PolygonMeshUtils::getChildCityObjectsRecursive(*primary_object)) {
+            city_objects.push_back(child);
+        }
+    }
+    CityObjectBoundsCache bounds_cache;
+    bounds_cache.build(city_objects, 4);
+
+    int found_count = 0;
+    for (const auto city_object : city_objects) {
+        const auto expected = PolygonMeshUtils::findCityObjPos(*city_object);
+        const auto actual = bounds_cache.find(*city_object);
+        ASSERT_EQ(expected.has_value(), actual.has_value());
+        if (!actual.has_value()) continue;
+        found_count++;
+        const auto& bounds = actual.value();
+        ASSERT_EQ(expected.value(), bounds.position);
+        ASSERT_TRUE(bounds.min.x <= bounds.position.x && bounds.position.x <= bounds.max.x);
+        ASSERT_TRUE(bounds.min.y <= bounds.position.y && bounds.position.y <= bounds.max.y);
+        ASSERT_TRUE(bounds.min.z <= bounds.position.z && bounds.position.z <= bounds.max.z);
+    }
+    ASSERT_GT(found_count, 0);
+}
+
+TEST_F(GridMergerTest, gridMerge_with_multiple_threads_returns_same_groups) { // NOLINT
+    auto multi_thread_options = mesh_extract_options_;
+    multi_thread_options.thread_count = 4;
+    auto expected = AreaMeshFactory::gridMerge(*city_model_, mesh_extract_options_, 2, geo_reference_, { Extent::all() });
+    auto actual = AreaMeshFactory::gridMerge(*city_model_, multi_thread_options, 2, geo_reference_, { Extent::all() });
+    ASSERT_EQ(expected.size(), actual.size());
+    auto expected_it = expected.begin();
+    auto actual_it = actual.begin();
+    for (; expected_it != expected.end(); ++expected_it, ++actual_it) {
+        ASSERT_EQ(expected_it->first, actual_it->first);
+        ASSERT_EQ(expected_it->second->getIndices(), actual_it->second->getIndices());
+        ASSERT_EQ(expected_it->second->getVertices().size(), actual_it->second->getVertices().size());
+    }
+}
+
+TEST_F(GridMergerTest, gridMerge_with_triangle_budget_splits_dense_grids) { // NOLINT
+    auto options = mesh_extract_options_;
+    options.grid_count_of_side = 1;
+    const auto uniform_result = AreaMeshFactory::gridMerge(*city_model_, options, 0, geo_reference_, { Extent::all() });
+
+    options.max_triangle_count_in_grid = 100;
+    const auto adaptive_result = AreaMeshFactory::gridMerge(*city_model_, options, 0, geo_reference_, { Extent::all() });
+    ASSERT_GT(adaptive_result.size(), uniform_result.size());
+
+    // 分割しても全体の三角形数は変わりません。
+    const auto count_indices = [](const GridMergeResult& result) {
+        size_t count = 0;
+        for (const auto& [id, mesh] : result) count += mesh->getIndices().size();
+        return count;
+    };
+    ASSERT_EQ(count_indices(uniform_result), count_indices(adaptive_result));
+}
+
+TEST_F(GridMergerTest, gridMerge_with_triangle_budget_uses_same_grids_in_all_lods) { // NOLINT
+    auto options = mesh_extract_options_;
+    options.grid_count_of_side = 1;
+    options.max_triangle_count_in_grid = 100;
+    options.min_lod = 0;
+    options.max_lod = 2;
+
+    // LODごとに、主要地物の gml:id からその地物を含むグリッドの番号を引く表を作ります。
+    constexpr unsigned group_count_per_grid = PolygonMeshUtils::max_lod_in_specification_ + 1;
+    std::vector<std::map<std::string, unsigned>> grid_ids_per_lod;
+    for (unsigned lod = options.min_lod; lod <= options.max_lod; lod++) {
+        const auto result = AreaMeshFactory::gridMerge(*city_model_, options, lod, geo_reference_, { Extent::all() });
+        auto& grid_ids = grid_ids_per_lod.emplace_back();
+        for (const auto& [group_id, mesh] : result) {
+            const auto& city_object_list = mesh->getCityObjectList();
+            for (const auto& primary_index : city_object_list.getAllPrimaryIndices()) {
+                grid_ids.emplace(city_object_list.getAtomicGmlID(primary_index), group_id / group_count_per_grid);
+            }
+        }
+    }
+
+    // 複数のLODに現れる主要地物は、どのLODでも同じ番号のグリッドに含まれます。
+    size_t compared_count = 0;
+    for (const auto& [gml_id, grid_id] : grid_ids_per_lod.at(0)) {
+        for (size_t lod_index = 1; lod_index < grid_ids_per_lod.size(); lod_index++) {
+            const auto found = grid_ids_per_lod.at(lod_index).find(gml_id);
+            if (found == grid_ids_per_lod.at(lod_index).end()) continue;
+            ASSERT_EQ(grid_id, found->second) << gml_id;
+            compared_count++;
+        }
+    }
+    ASSERT_GT(compared_count, 0);
+}
+
+TEST_F(GridMergerTest, buildHlod_builds_quadtree_with_bounds_containing_children) { // NOLINT
+    auto options = MeshExtractOptions();
+    options.mesh_granularity = MeshGranularity::PerCityModelArea;
+    options.min_lod = 0;
+    options.max_lod = 2;
+    options.grid_count_of_side = 4;
+    auto hlod = AreaMeshFactory::buildHlod(*city_model_, options, geo_reference_, { Extent::all() });
+    hlod.eraseEmptyChildren();
+
+    ASSERT_EQ("HLOD", hlod.getName());
+    ASSERT_EQ(1, hlod.getChildCount());
+    const auto& root = hlod.getChildAt(0);
+    ASSERT_TRUE(root.polygonExists());
+    ASSERT_GT(root.getChildCount(), 0);
+
+    // 各ノードの範囲は子の範囲を含み、子を持つノードだけが切り替えの距離を持ちます。
+    const std::function<void(const Node&)> check = [&check](const Node& node) {
+        const auto& info = node.getHlodInfo();
+        ASSERT_TRUE(info.has_value());
+        if (node.getChildCount() == 0) {
+            ASSERT_EQ(0, info->switch_distance);
+            ASSERT_EQ(0, node.getName().rfind("grid_", 0));
+        } else {
+            ASSERT_GT(info->switch_distance, 0);
+        }
+        for (size_t i = 0; i < node.getChildCount(); i++) {
+            const auto& child_info = node.getChildAt(i).getHlodInfo();
+            ASSERT_TRUE(child_info.has_value());
+            ASSERT_LE(info->bounds_min.x, child_info->bounds_min.x);
+            ASSERT_LE(info->bounds_min.y, child_info->bounds_min.y);
+            ASSERT_LE(info->bounds_min.z, child_info->bounds_min.z);
+            ASSERT_GE(info->bounds_max.x, child_info->bounds_max.x);
+            ASSERT_GE(info->bounds_max.y, child_info->bounds_max.y);
+            ASSERT_GE(info->bounds_max.z, child_info->bounds_max.z);
+            check(node.getChildAt(i));
+        }
+    };
+    check(root);
+}
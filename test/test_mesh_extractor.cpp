@@ -7,7 +7,16 @@
 #include "../src/c_wrapper/citygml_c.cpp"
 #include "../src/polygon_mesh/area_mesh_factory.h"
 #include <plateau/polygon_mesh/mesh_extractor.h>
+#include <plateau/polygon_mesh/mesh_factory.h>
+#include <plateau/polygon_mesh/primary_city_object_types.h>
+#include <plateau/polygon_mesh/texture_path_cache.h>
 #include <plateau/dataset/mesh_code.h>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <cstring>
+#include <thread>
+#include <atomic>
 
 using namespace citygml;
 using namespace plateau::geometry;
@@ -78,6 +87,49 @@ namespace plateau::polygonMesh {
         ASSERT_TRUE(found_texture_num > 5);
     }
 
+    TEST_F(MeshExtractorTest, extract_result_texture_paths_are_absolute_and_exist) { // NOLINT
+        auto model = MeshExtractor::extract(*city_model_, mesh_extract_options_);
+        const auto& lod_node = model->getRootNodeAt(0);
+        int checked_texture_num = 0;
+        for (int i = 0; i < lod_node.getChildCount(); i++) {
+            const auto mesh = lod_node.getChildAt(i).getMesh();
+            if (mesh == nullptr) continue;
+            for (const auto& sub_mesh : mesh->getSubMeshes()) {
+                const auto& tex_path = sub_mesh.getTexturePath();
+                if (tex_path.empty()) continue;
+                const auto path = std::filesystem::u8path(tex_path);
+                ASSERT_TRUE(path.is_absolute());
+                ASSERT_TRUE(std::filesystem::exists(path));
+                checked_texture_num++;
+            }
+        }
+        ASSERT_TRUE(checked_texture_num > 5);
+    }
+
+    TEST_F(MeshExtractorTest, texture_path_cache_theme_gives_same_sub_meshes_as_searching_themes) { // NOLINT
+        TexturePathCache texture_path_cache(*city_model_);
+        ASSERT_EQ("rgbTexture", texture_path_cache.getTheme());
+
+        // キャッシュのテーマで直接引いた結果と、ポリゴンごとにテーマを探した結果を比べます。
+        const std::vector<Extent> extents = {Extent::all()};
+        const auto geo_reference = GeoReference(mesh_extract_options_.coordinate_zone_id);
+        MeshFactory with_cache(nullptr, mesh_extract_options_, extents, geo_reference, nullptr, &texture_path_cache);
+        MeshFactory without_cache(nullptr, mesh_extract_options_, extents, geo_reference);
+        for (const auto primary_object : city_model_->getAllCityObjectsOfType(PrimaryCityObjectTypes::getPrimaryTypeMask())) {
+            with_cache.addPolygonsInPrimaryCityObject(*primary_object, 2, gml_path_);
+            without_cache.addPolygonsInPrimaryCityObject(*primary_object, 2, gml_path_);
+        }
+        const auto expected = without_cache.releaseMesh();
+        const auto actual = with_cache.releaseMesh();
+        ASSERT_EQ(expected->getUV1(), actual->getUV1());
+        ASSERT_EQ(expected->getSubMeshes().size(), actual->getSubMeshes().size());
+        ASSERT_FALSE(actual->getSubMeshes().empty());
+        for (size_t i = 0; i < actual->getSubMeshes().size(); i++) {
+            ASSERT_EQ(expected->getSubMeshes().at(i).getTexturePath(), actual->getSubMeshes().at(i).getTexturePath());
+            ASSERT_EQ(expected->getSubMeshes().at(i).getMaterial(), actual->getSubMeshes().at(i).getMaterial());
+        }
+    }
+
     TEST_F(MeshExtractorTest, extract_can_exec_multiple_times) { // NOLINT
         for (int i = 0; i < 3; i++) {
             testExtractFromCWrapper();
@@ -204,6 +256,442 @@ namespace plateau::polygonMesh {
         }
     }
 
+    namespace {
+        void assertSameMesh(const Mesh* expected, const Mesh* actual) {
+            ASSERT_EQ(expected == nullptr, actual == nullptr);
+            if (expected == nullptr) return;
+            const auto& expected_vertices = expected->getVertices();
+            const auto& actual_vertices = actual->getVertices();
+            ASSERT_EQ(expected_vertices.size(), actual_vertices.size());
+            for (size_t i = 0; i < expected_vertices.size(); i++) {
+                ASSERT_EQ(expected_vertices.at(i).x, actual_vertices.at(i).x);
+                ASSERT_EQ(expected_vertices.at(i).y, actual_vertices.at(i).y);
+                ASSERT_EQ(expected_vertices.at(i).z, actual_vertices.at(i).z);
+            }
+            ASSERT_EQ(expected->getIndices(), actual->getIndices());
+            ASSERT_EQ(expected->getUV1().size(), actual->getUV1().size());
+            ASSERT_EQ(expected->getUV4().size(), actual->getUV4().size());
+            for (size_t i = 0; i < expected->getUV4().size(); i++) {
+                ASSERT_EQ(expected->getUV4().at(i).x, actual->getUV4().at(i).x);
+                ASSERT_EQ(expected->getUV4().at(i).y, actual->getUV4().at(i).y);
+            }
+            ASSERT_EQ(expected->getSubMeshes(), actual->getSubMeshes());
+            ASSERT_TRUE(expected->getCityObjectList() == actual->getCityObjectList());
+        }
+
+        void assertSameNodeRecursive(const Node& expected, const Node& actual) {
+            ASSERT_EQ(expected.getName(), actual.getName());
+            assertSameMesh(expected.getMesh(), actual.getMesh());
+            ASSERT_EQ(expected.getChildCount(), actual.getChildCount());
+            for (unsigned i = 0; i < expected.getChildCount(); i++) {
+                assertSameNodeRecursive(expected.getChildAt(i), actual.getChildAt(i));
+            }
+        }
+    }
+
+    TEST_F(MeshExtractorTest, multi_thread_extraction_returns_same_model_as_single_thread) { // NOLINT
+        auto options = mesh_extract_options_;
+        options.min_lod = 0;
+        options.max_lod = 2;
+        for (const auto granularity : { MeshGranularity::PerCityModelArea, MeshGranularity::PerPrimaryFeatureObject, MeshGranularity::PerAtomicFeatureObject }) {
+            options.mesh_granularity = granularity;
+            options.thread_count = 1;
+            const auto single_thread_model = MeshExtractor::extract(*city_model_, options);
+            options.thread_count = 4;
+            const auto multi_thread_model = MeshExtractor::extract(*city_model_, options);
+
+            ASSERT_EQ(single_thread_model->getRootNodeCount(), multi_thread_model->getRootNodeCount());
+            for (size_t i = 0; i < single_thread_model->getRootNodeCount(); i++) {
+                assertSameNodeRecursive(single_thread_model->getRootNodeAt(i), multi_thread_model->getRootNodeAt(i));
+            }
+        }
+    }
+
+    TEST_F(MeshExtractorTest, streaming_extraction_passes_same_nodes_as_extract) { // NOLINT
+        auto options = mesh_extract_options_;
+        options.min_lod = 0;
+        options.max_lod = 2;
+        options.thread_count = 4;
+        for (const auto granularity : { MeshGranularity::PerCityModelArea, MeshGranularity::PerPrimaryFeatureObject, MeshGranularity::PerAtomicFeatureObject }) {
+            options.mesh_granularity = granularity;
+            const auto model = MeshExtractor::extract(*city_model_, options);
+
+            std::map<unsigned, std::vector<Node>> streamed_nodes;
+            MeshExtractor::extractStreaming(*city_model_, options, [&streamed_nodes](unsigned lod, Node&& node) {
+                streamed_nodes[lod].push_back(std::move(node));
+            });
+
+            ASSERT_EQ(model->getRootNodeCount(), streamed_nodes.size());
+            for (size_t i = 0; i < model->getRootNodeCount(); i++) {
+                const auto& lod_node = model->getRootNodeAt(i);
+                const auto& nodes = streamed_nodes.at(std::stoi(lod_node.getName().substr(3)));
+                ASSERT_EQ(lod_node.getChildCount(), nodes.size());
+                for (unsigned j = 0; j < lod_node.getChildCount(); j++) {
+                    assertSameNodeRecursive(lod_node.getChildAt(j), nodes.at(j));
+                }
+            }
+        }
+    }
+
+    TEST_F(MeshExtractorTest, extract_reports_geometry_progress_of_each_lod) { // NOLINT
+        auto options = mesh_extract_options_;
+        options.min_lod = 0;
+        options.max_lod = 2;
+        options.thread_count = 4;
+        for (const auto granularity : { MeshGranularity::PerCityModelArea, MeshGranularity::PerPrimaryFeatureObject }) {
+            options.mesh_granularity = granularity;
+            std::map<unsigned, std::pair<size_t, size_t>> max_processed_and_total;
+            ExtractProgress progress([&max_processed_and_total](ExtractStage stage, unsigned lod, size_t processed, size_t total) {
+                if (stage != ExtractStage::Geometry) return;
+                auto& [max_processed, last_total] = max_processed_and_total[lod];
+                max_processed = std::max(max_processed, processed);
+                last_total = total;
+            });
+            Model model;
+            MeshExtractor::extract(model, *city_model_, options, &progress);
+
+            ASSERT_EQ(max_processed_and_total.size(), 3);
+            for (const auto& [lod, max_processed_and_total_of_lod] : max_processed_and_total) {
+                ASSERT_GT(max_processed_and_total_of_lod.second, 0);
+                ASSERT_EQ(max_processed_and_total_of_lod.first, max_processed_and_total_of_lod.second);
+            }
+        }
+    }
+
+    TEST_F(MeshExtractorTest, extract_throws_when_cancelled_during_extraction) { // NOLINT
+        auto options = mesh_extract_options_;
+        options.thread_count = 4;
+        ExtractProgress* progress_ptr = nullptr;
+        ExtractProgress progress([&progress_ptr](ExtractStage, unsigned, size_t processed, size_t) {
+            if (processed == 1) progress_ptr->cancel();
+        });
+        progress_ptr = &progress;
+        Model model;
+        ASSERT_THROW(MeshExtractor::extract(model, *city_model_, options, &progress), ExtractCancelledException);
+        ASSERT_TRUE(progress.isCancelled());
+    }
+
+    namespace {
+        std::atomic<size_t> c_wrapper_geometry_report_count = 0;
+        std::atomic<bool> c_wrapper_reported_lod_for_texture_packing = false;
+
+        void onProgressFromCWrapper(const int stage, const unsigned lod, unsigned long long, unsigned long long) {
+            if (stage == static_cast<int>(ExtractStage::Geometry)) c_wrapper_geometry_report_count++;
+            if (stage == static_cast<int>(ExtractStage::TexturePacking) && lod != ExtractProgress::no_lod) {
+                c_wrapper_reported_lod_for_texture_packing = true;
+            }
+        }
+    }
+
+    TEST_F(MeshExtractorTest, extract_with_progress_from_c_wrapper_reports_progress_and_cancels) { // NOLINT
+        const CityModelHandle* city_model_handle;
+        plateau_load_citygml(gml_path_.c_str(), plateau_citygml_parser_params(), &city_model_handle,
+                             DllLogLevel::LL_WARNING, nullptr, nullptr, nullptr);
+        auto options = mesh_extract_options_;
+        options.enable_texture_packing = true;
+
+        ExtractProgress* progress;
+        ASSERT_EQ(plateau_create_extract_progress(&progress, onProgressFromCWrapper), APIResult::Success);
+        Model* model;
+        plateau_create_model(&model);
+        ASSERT_EQ(plateau_mesh_extractor_extract_with_progress(city_model_handle, options, progress, model), APIResult::Success);
+        ASSERT_GT(c_wrapper_geometry_report_count.load(), 0);
+        ASSERT_FALSE(c_wrapper_reported_lod_for_texture_packing.load());
+        plateau_delete_model(model);
+
+        // 中断済みであれば、抽出は ErrorCancelled を返します。ストリーミング版も同様です。
+        plateau_extract_progress_cancel(progress);
+        plateau_create_model(&model);
+        ASSERT_EQ(plateau_mesh_extractor_extract_with_progress(city_model_handle, options, progress, model), APIResult::ErrorCancelled);
+        plateau_delete_model(model);
+        const std::vector<plateau::geometry::Extent> extents = { plateau::geometry::Extent::all() };
+        ASSERT_EQ(plateau_mesh_extractor_extract_in_extents_streaming(
+                city_model_handle, options, &extents, [](unsigned, const Node*) {}, progress), APIResult::ErrorCancelled);
+
+        plateau_delete_extract_progress(progress);
+        plateau_delete_city_model(city_model_handle);
+    }
+
+    namespace {
+        size_t countIndicesRecursive(const Node& node) {
+            size_t count = node.getMesh() == nullptr ? 0 : node.getMesh()->getIndices().size();
+            for (unsigned i = 0; i < node.getChildCount(); i++) {
+                count += countIndicesRecursive(node.getChildAt(i));
+            }
+            return count;
+        }
+
+        bool hasHlodInfoRecursive(const Node& node) {
+            if (node.getHlodInfo().has_value()) return true;
+            for (unsigned i = 0; i < node.getChildCount(); i++) {
+                if (hasHlodInfoRecursive(node.getChildAt(i))) return true;
+            }
+            return false;
+        }
+
+        size_t countIndices(const Model& model) {
+            size_t count = 0;
+            for (size_t i = 0; i < model.getRootNodeCount(); i++) {
+                count += countIndicesRecursive(model.getRootNodeAt(i));
+            }
+            return count;
+        }
+    }
+
+    TEST_F(MeshExtractorTest, extract_per_extent_splits_triangles_of_extraction_in_all_extents) { // NOLINT
+        auto options = mesh_extract_options_;
+        options.exclude_city_object_outside_extent = true;
+        options.exclude_polygons_outside_extent = false;
+        options.mesh_granularity = MeshGranularity::PerPrimaryFeatureObject;
+
+        std::vector<Extent> extents;
+        for (int i = 1; i <= 4; ++i) {
+            for (int j = 1; j <= 4; ++j) {
+                const auto mesh_code_str = "53392642" + std::to_string(i) + std::to_string(j);
+                extents.push_back(plateau::dataset::MeshCode(mesh_code_str).getExtent());
+            }
+        }
+
+        const auto union_model = MeshExtractor::extractInExtents(*city_model_, options, extents);
+        const auto tile_models = MeshExtractor::extractPerExtent(*city_model_, options, extents);
+        ASSERT_EQ(tile_models.size(), extents.size());
+
+        // 各三角形はちょうど1つのタイルに振り分けられます。
+        size_t tile_index_count = 0;
+        size_t non_empty_tile_count = 0;
+        for (const auto& tile_model : tile_models) {
+            const auto count = countIndices(*tile_model);
+            tile_index_count += count;
+            if (count > 0) non_empty_tile_count++;
+        }
+        ASSERT_GT(countIndices(*union_model), 0);
+        ASSERT_EQ(countIndices(*union_model), tile_index_count);
+        ASSERT_GT(non_empty_tile_count, 1);
+    }
+
+    TEST_F(MeshExtractorTest, extract_per_extent_ignores_build_hlod) { // NOLINT
+        auto options = mesh_extract_options_;
+        options.mesh_granularity = MeshGranularity::PerCityModelArea;
+        std::vector<Extent> extents;
+        for (int i = 1; i <= 4; ++i) {
+            for (int j = 1; j <= 4; ++j) {
+                const auto mesh_code_str = "53392642" + std::to_string(i) + std::to_string(j);
+                extents.push_back(plateau::dataset::MeshCode(mesh_code_str).getExtent());
+            }
+        }
+        const auto expected_models = MeshExtractor::extractPerExtent(*city_model_, options, extents);
+
+        options.build_hlod = true;
+        const auto tile_models = MeshExtractor::extractPerExtent(*city_model_, options, extents);
+        ASSERT_EQ(expected_models.size(), tile_models.size());
+        for (size_t i = 0; i < tile_models.size(); i++) {
+            const auto& tile_model = *tile_models.at(i);
+            ASSERT_EQ(countIndices(*expected_models.at(i)), countIndices(tile_model));
+            for (size_t j = 0; j < tile_model.getRootNodeCount(); j++) {
+                ASSERT_EQ("LOD2", tile_model.getRootNodeAt(j).getName());
+                ASSERT_FALSE(hasHlodInfoRecursive(tile_model.getRootNodeAt(j)));
+            }
+        }
+    }
+
+    TEST_F(MeshExtractorTest, extract_per_extent_builds_city_object_ranges_for_each_tile) { // NOLINT
+        auto options = mesh_extract_options_;
+        options.mesh_granularity = MeshGranularity::PerCityModelArea;
+        options.build_city_object_ranges = true;
+        std::vector<Extent> extents;
+        for (int i = 1; i <= 4; ++i) {
+            for (int j = 1; j <= 4; ++j) {
+                const auto mesh_code_str = "53392642" + std::to_string(i) + std::to_string(j);
+                extents.push_back(plateau::dataset::MeshCode(mesh_code_str).getExtent());
+            }
+        }
+
+        const auto tile_models = MeshExtractor::extractPerExtent(*city_model_, options, extents);
+        size_t mesh_count = 0;
+        for (const auto& tile_model : tile_models) {
+            for (const auto mesh : tile_model->getAllMeshes()) {
+                // 表はタイルのメッシュのすべての三角形を覆います。
+                size_t covered_index_count = 0;
+                for (const auto& range : mesh->getCityObjectRanges()) {
+                    covered_index_count += range.index_count;
+                }
+                ASSERT_EQ(mesh->getIndices().size(), covered_index_count);
+                mesh_count++;
+            }
+        }
+        ASSERT_GT(mesh_count, 0);
+    }
+
+    TEST_F(MeshExtractorTest, implicit_geometry_instances_place_shared_prototype_like_flattened_template) { // NOLINT
+        // 1つのテンプレートを3本の樹木が xlink で共有し、3本目だけが抽出範囲の外にある GML を作ります。
+        // テンプレートは (x, y, z) → (-2y + 1, x + 2, z + 3) と変換して配置します。
+        const auto gml_dir = std::filesystem::temp_directory_path() / "plateau_test_implicit_geometry";
+        std::filesystem::create_directories(gml_dir);
+        const auto gml_path = gml_dir / "53392642_veg_6697_op.gml";
+        {
+            std::ofstream gml(gml_path);
+            const auto tree = [](const std::string& id, const std::string& reference_point, bool defines_template) {
+                const std::string geometry = defines_template ?
+                        R"(<core:relativeGMLGeometry><gml:MultiSurface gml:id="tree_template"><gml:surfaceMember><gml:Polygon><gml:exterior><gml:LinearRing>)"
+                        R"(<gml:posList>0 0 0 1 0 0 0 1 2 0 0 0</gml:posList></gml:LinearRing></gml:exterior></gml:Polygon></gml:surfaceMember></gml:MultiSurface></core:relativeGMLGeometry>)" :
+                        R"(<core:relativeGMLGeometry xlink:href="#tree_template"/>)";
+                return R"(<core:cityObjectMember><veg:SolitaryVegetationObject gml:id=")" + id + R"("><veg:lod1ImplicitRepresentation><core:ImplicitGeometry>)"
+                       R"(<core:transformationMatrix>0 -2 0 1 1 0 0 2 0 0 1 3 0 0 0 1</core:transformationMatrix>)" + geometry +
+                       R"(<core:referencePoint><gml:Point><gml:pos>)" + reference_point + R"(</gml:pos></gml:Point></core:referencePoint>)"
+                       R"(</core:ImplicitGeometry></veg:lod1ImplicitRepresentation></veg:SolitaryVegetationObject></core:cityObjectMember>)";
+            };
+            gml << R"(<?xml version="1.0" encoding="UTF-8"?>)"
+                << R"(<core:CityModel xmlns:core="http://www.opengis.net/citygml/2.0" xmlns:veg="http://www.opengis.net/citygml/vegetation/2.0")"
+                << R"( xmlns:gml="http://www.opengis.net/gml" xmlns:xlink="http://www.w3.org/1999/xlink">)"
+                << tree("tree_1", "35.540 139.776 5", true)
+                << tree("tree_2", "35.541 139.777 6", false)
+                << tree("tree_3", "35.600 139.900 7", false)
+                << "</core:CityModel>";
+        }
+        const auto city_model = load(gml_path.u8string(), params_);
+
+        auto options = MeshExtractOptions();
+        options.min_lod = 1;
+        options.max_lod = 1;
+        options.mesh_axes = CoordinateSystem::EUN;
+        options.unit_scale = 0.01f;
+        options.reference_point = TVec3d(-100, 20, 300);
+        options.extract_implicit_geometry_as_instances = true;
+        const auto extent = Extent(GeoCoordinate(35.5, 139.7, -10000), GeoCoordinate(35.55, 139.8, 10000));
+        const auto model = MeshExtractor::extractInExtents(*city_model, options, {extent});
+        std::filesystem::remove_all(gml_dir);
+
+        // テンプレートは (Geometry, LOD) ごとに1つだけ作られ、範囲内の2本がそれを共有します。
+        ASSERT_EQ(1, model->getInstancePrototypeCount());
+        const auto& instances = model->getMeshInstances();
+        ASSERT_EQ(2, instances.size());
+        ASSERT_EQ("tree_1", instances.at(0).gml_id);
+        ASSERT_EQ("tree_2", instances.at(1).gml_id);
+
+        // 平面直角座標 (ENU, メートル) 上でテンプレートを配置してから、出力の座標に変換したものを期待値とします。
+        const auto enu = GeoReference(options.coordinate_zone_id, TVec3d(0, 0, 0), 1.0, CoordinateSystem::ENU);
+        const auto output = GeoReference(options.coordinate_zone_id, options.reference_point, options.unit_scale, options.mesh_axes);
+        const auto flatten = [&](const TVec3d& reference_point, const TVec3d& t) {
+            const auto placed = enu.project(reference_point) + TVec3d(-2 * t.y + 1, t.x + 2, t.z + 3);
+            return output.project(enu.unproject(placed));
+        };
+        const TVec3d reference_points[] = {TVec3d(35.540, 139.776, 5), TVec3d(35.541, 139.777, 6)};
+        const TVec3d template_vertices[] = {TVec3d(0, 0, 0), TVec3d(1, 0, 0), TVec3d(0, 1, 2)};
+
+        const auto& prototype = model->getInstancePrototypeAt(0);
+        ASSERT_EQ(3, prototype.getVertices().size());
+        for (const auto& vertex : prototype.getVertices()) {
+            // プロトタイプの頂点は、テンプレートの頂点に座標軸と単位の変換のみを掛けたものです。
+            const TVec3d* template_vertex = nullptr;
+            for (const auto& t : template_vertices) {
+                const auto expected = GeoReference::convertAxisFromENUTo(options.mesh_axes, t) / static_cast<double>(options.unit_scale);
+                if ((expected - vertex).length() < 1e-3) template_vertex = &t;
+            }
+            ASSERT_NE(nullptr, template_vertex);
+
+            for (size_t i = 0; i < instances.size(); i++) {
+                ASSERT_EQ(0, instances.at(i).prototype_index);
+                ASSERT_EQ(1, instances.at(i).lod);
+                const auto expected = flatten(reference_points[i], *template_vertex);
+                const auto actual = instances.at(i).apply(vertex);
+                ASSERT_NEAR(expected.x, actual.x, 1e-3);
+                ASSERT_NEAR(expected.y, actual.y, 1e-3);
+                ASSERT_NEAR(expected.z, actual.z, 1e-3);
+            }
+        }
+    }
+
+    TEST_F(MeshExtractorTest, extract_excludes_primary_objects_not_matching_type_mask) { // NOLINT
+        auto options = mesh_extract_options_;
+        for (const auto granularity : { MeshGranularity::PerCityModelArea, MeshGranularity::PerPrimaryFeatureObject }) {
+            options.mesh_granularity = granularity;
+            options.city_object_type_mask = CityObject::CityObjectsType::COT_Building;
+            ASSERT_GT(countIndices(*MeshExtractor::extract(*city_model_, options)), 0);
+            options.city_object_type_mask = CityObject::CityObjectsType::COT_Road;
+            ASSERT_EQ(countIndices(*MeshExtractor::extract(*city_model_, options)), 0);
+        }
+    }
+
+    TEST_F(MeshExtractorTest, extract_filters_primary_objects_by_attribute) { // NOLINT
+        auto options = mesh_extract_options_;
+        strncpy(options.attribute_filter_key, "bldg:measuredheight", sizeof(options.attribute_filter_key) - 1);
+        const auto count_with = [&](const AttributeFilterComparison comparison, const char* value) {
+            options.attribute_filter_comparison = comparison;
+            strncpy(options.attribute_filter_value, value, sizeof(options.attribute_filter_value) - 1);
+            return countIndices(*MeshExtractor::extract(*city_model_, options));
+        };
+
+        for (const auto granularity : { MeshGranularity::PerCityModelArea, MeshGranularity::PerPrimaryFeatureObject }) {
+            options.mesh_granularity = granularity;
+            const auto exists_count = count_with(AttributeFilterComparison::Exists, "");
+            // 数値として比較されるため、 "9.3" は "10" より小さいと判定されます。
+            const auto higher_count = count_with(AttributeFilterComparison::Greater, "10");
+            const auto lower_count = count_with(AttributeFilterComparison::LessOrEqual, "10");
+            ASSERT_GT(higher_count, 0);
+            ASSERT_GT(lower_count, 0);
+            ASSERT_EQ(higher_count + lower_count, exists_count);
+            ASSERT_EQ(count_with(AttributeFilterComparison::Greater, "1000"), 0);
+        }
+
+        strncpy(options.attribute_filter_key, "bldg:not_existing_attribute", sizeof(options.attribute_filter_key) - 1);
+        ASSERT_EQ(count_with(AttributeFilterComparison::Exists, ""), 0);
+    }
+
+    TEST_F(MeshExtractorTest, concurrent_extractions_write_packed_textures_to_distinct_files) { // NOLINT
+        constexpr int session_count = 4;
+        auto options = mesh_extract_options_;
+        options.enable_texture_packing = true;
+        // 結合先の画像を小さくして、1回の抽出で複数の画像が書き出されるようにします。
+        options.texture_packing_resolution = 512;
+
+        // 同じ GML ファイルを別々の CityModel として読み込み、同じフォルダに結合後の画像を書き出させます。
+        std::vector<std::shared_ptr<const CityModel>> city_models;
+        for (int i = 0; i < session_count; i++) {
+            city_models.push_back(load(gml_path_, params_));
+        }
+
+        std::vector<std::shared_ptr<Model>> models(session_count);
+        std::atomic<bool> failed(false);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < session_count; i++) {
+            threads.emplace_back([&, i] {
+                try {
+                    models.at(i) = MeshExtractor::extract(*city_models.at(i), options);
+                } catch (...) {
+                    failed = true;
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        ASSERT_FALSE(failed);
+
+        // 結合後の画像は、抽出ごとに別のファイルになります。
+        std::map<std::string, int> session_of_packed_image;
+        bool is_shared_between_sessions = false;
+        for (int i = 0; i < session_count; i++) {
+            for (const auto mesh : models.at(i)->getAllMeshes()) {
+                for (const auto& sub_mesh : mesh->getSubMeshes()) {
+                    const auto& texture_path = sub_mesh.getTexturePath();
+                    if (std::filesystem::u8path(texture_path).filename().u8string().rfind("packed_image_", 0) != 0) continue;
+                    const auto [it, inserted] = session_of_packed_image.emplace(texture_path, i);
+                    if (!inserted && it->second != i) is_shared_between_sessions = true;
+                }
+            }
+        }
+
+        bool all_files_exist = true;
+        for (const auto& [texture_path, session] : session_of_packed_image) {
+            const auto path = std::filesystem::u8path(texture_path);
+            if (!std::filesystem::exists(path)) all_files_exist = false;
+            std::filesystem::remove(path);
+        }
+        ASSERT_GE(session_of_packed_image.size(), session_count);
+        ASSERT_FALSE(is_shared_between_sessions);
+        ASSERT_TRUE(all_files_exist);
+    }
+
     void MeshExtractorTest::testExtractFromCWrapper() const {
 
         const CityModelHandle* city_model_handle;
@@ -0,0 +1,101 @@
+#include "gtest/gtest.h"
+#include "citygml/citygml.h"
+#include <plateau/polygon_mesh/mesh_factory.h>
+#include <plateau/polygon_mesh/city_object_polygon_index.h>
+#include <plateau/polygon_mesh/primary_city_object_types.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// このファイルは operator new を置き換えるため、他のテストに影響しないよう plateau_allocation_test として単独でビルドします。
+
+namespace {
+    /// このテストプログラム全体での operator new の呼び出し回数です。
+    std::atomic<size_t> allocation_count(0);
+}
+
+void* operator new(std::size_t size) {
+    allocation_count++;
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+
+using namespace citygml;
+using namespace plateau::polygonMesh;
+using namespace plateau::geometry;
+
+class MeshFactoryAllocationTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        params_.tesselate = true;
+        params_.keepVertices = true;
+        mesh_extract_options_.min_lod = 2;
+        mesh_extract_options_.max_lod = 2;
+        mesh_extract_options_.mesh_granularity = MeshGranularity::PerCityModelArea;
+    }
+
+    ParserParams params_;
+    const std::string gml_path_ = "../data/日本語パステスト/udx/bldg/53392642_bldg_6697_op2.gml";
+    MeshExtractOptions mesh_extract_options_ = MeshExtractOptions();
+    const std::shared_ptr<const CityModel> city_model_ = load(gml_path_, params_);
+};
+
+TEST_F(MeshFactoryAllocationTest, add_polygon_allocates_only_inside_libcitygml_after_warm_up) {
+#ifdef LIBPLATEAU_BUILD_DYNAMIC
+    GTEST_SKIP() << "DLL の中でのメモリ確保は、このテストプログラムの operator new では数えられません。";
+#endif
+    std::vector<const citygml::Polygon*> polygons;
+    long long element_count = 0;
+    const auto& primary_objects = city_model_->getAllCityObjectsOfType(PrimaryCityObjectTypes::getPrimaryTypeMask());
+    for (const auto primary_object : primary_objects) {
+        const auto buckets = CityObjectPolygonIndex::collect(*primary_object);
+        for (const auto polygon : buckets.at(2).polygons) {
+            polygons.push_back(polygon);
+            element_count += static_cast<long long>(polygon->getVertices().size() + polygon->getIndices().size());
+        }
+    }
+    ASSERT_FALSE(polygons.empty());
+
+    // libcitygml の値で返す関数の中での確保の回数を、 MeshFactory と同じ呼び出し方で数えます。
+    const auto count_library_allocations = [&polygons] {
+        const auto before = allocation_count.load();
+        for (const auto polygon : polygons) {
+            const auto uv_1 = polygon->getTexCoordsForTheme("rgbTexture", true);
+            if (!uv_1.empty()) continue;
+            const auto themes = polygon->getAllTextureThemes(true);
+            if (!themes.empty()) polygon->getTexCoordsForTheme(themes.at(0), true);
+        }
+        return allocation_count.load() - before;
+    };
+
+    auto options = mesh_extract_options_;
+    options.export_appearance = false;
+    // 2回分の追加でメッシュの配列が伸びないよう、先に容量を確保しておきます。
+    auto target = std::make_unique<Mesh>();
+    target->reserve(2 * element_count);
+    const std::vector<Extent> extents = {Extent::all()};
+    MeshFactory mesh_factory(std::move(target), options, extents, GeoReference(9));
+
+    // 1回目で一時的な配列の容量が確保されます。
+    for (const auto polygon : polygons) {
+        mesh_factory.addPolygon(*polygon, gml_path_);
+    }
+
+    // 2回目は、 libcitygml の中での確保以外にメモリを確保しません。
+    const auto library_allocations = count_library_allocations();
+    const auto before = allocation_count.load();
+    for (const auto polygon : polygons) {
+        mesh_factory.addPolygon(*polygon, gml_path_);
+    }
+    const auto factory_allocations = allocation_count.load() - before;
+    ASSERT_EQ(library_allocations, factory_allocations);
+}
@@ -3,6 +3,7 @@
 #include "citygml/citygml.h"
 #include "plateau/polygon_mesh/mesh_extractor.h"
 #include "../src/c_wrapper/mesh_merger_c.cpp"
+#include <plateau/polygon_mesh/primary_city_object_types.h>
 
 
 using namespace citygml;
@@ -140,3 +141,109 @@ TEST_F(MeshMergerTest, mesh_merger_merge) {
     ASSERT_EQ(static_cast<float>(0.32), mesh.getUV1().at(5).y);
 
 }
+
+TEST_F(MeshMergerTest, coalesce_sub_meshes_groups_triangles_by_material_and_keeps_uv4) {
+    // テクスチャあり・なしの三角形が交互に並ぶメッシュを作ります。
+    std::vector<TVec3d> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<TVec2f> uv_4;
+    for (unsigned tri = 0; tri < 4; tri++) {
+        for (unsigned i = 0; i < 3; i++) {
+            vertices.emplace_back(tri, i, 0);
+            indices.push_back(tri * 3 + i);
+            uv_4.emplace_back(static_cast<float>(tri), 0);
+        }
+    }
+    std::vector<TVec2f> uv_1(vertices.size(), TVec2f(0, 0));
+    std::vector<SubMesh> sub_meshes = {
+            SubMesh(0, 2, "a.png", nullptr),
+            SubMesh(3, 5, "", nullptr),
+            SubMesh(6, 8, "a.png", nullptr),
+            SubMesh(9, 11, "", nullptr)
+    };
+    const auto expected_uv_4 = uv_4;
+    auto mesh = Mesh(std::move(vertices), std::move(indices), std::move(uv_1), std::move(uv_4), std::move(sub_meshes), CityObjectList());
+
+    mesh.coalesceSubMeshes();
+
+    const auto& result_sub_meshes = mesh.getSubMeshes();
+    ASSERT_EQ(2, result_sub_meshes.size());
+    ASSERT_EQ("a.png", result_sub_meshes.at(0).getTexturePath());
+    ASSERT_EQ(0, result_sub_meshes.at(0).getStartIndex());
+    ASSERT_EQ(5, result_sub_meshes.at(0).getEndIndex());
+    ASSERT_EQ("", result_sub_meshes.at(1).getTexturePath());
+    ASSERT_EQ(6, result_sub_meshes.at(1).getStartIndex());
+    ASSERT_EQ(11, result_sub_meshes.at(1).getEndIndex());
+    // 同じマテリアルの三角形は元の順番のまま並びます。
+    const std::vector<unsigned> expected_indices = {0, 1, 2, 6, 7, 8, 3, 4, 5, 9, 10, 11};
+    ASSERT_EQ(expected_indices, mesh.getIndices());
+    // 頂点は並べ替えないため、UV4 は変わりません。
+    ASSERT_EQ(expected_uv_4.size(), mesh.getUV4().size());
+    for (size_t i = 0; i < expected_uv_4.size(); i++) {
+        ASSERT_EQ(expected_uv_4.at(i).x, mesh.getUV4().at(i).x);
+    }
+}
+
+TEST_F(MeshMergerTest, build_city_object_ranges_groups_ranges_by_city_object) {
+    // 三角形 0,1 は地物(0,-1)、三角形 2,3 は地物(1,-1)、三角形 4 は地物0の最小地物(0,0) とし、
+    // SubMesh は三角形 0-2 と 3-4 に分けます。
+    const std::vector<CityObjectIndex> triangle_objects = {
+            {0, -1}, {0, -1}, {1, -1}, {1, -1}, {0, 0}
+    };
+    std::vector<TVec3d> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<TVec2f> uv_4;
+    for (unsigned tri = 0; tri < triangle_objects.size(); tri++) {
+        const auto& city_object_index = triangle_objects.at(tri);
+        for (unsigned i = 0; i < 3; i++) {
+            vertices.emplace_back(tri, i, city_object_index.primary_index);
+            indices.push_back(tri * 3 + i);
+            uv_4.push_back(city_object_index.toUV());
+        }
+    }
+    std::vector<TVec2f> uv_1(vertices.size(), TVec2f(0, 0));
+    std::vector<SubMesh> sub_meshes = {
+            SubMesh(0, 8, "a.png", nullptr),
+            SubMesh(9, 14, "", nullptr)
+    };
+    auto mesh = Mesh(std::move(vertices), std::move(indices), std::move(uv_1), std::move(uv_4), std::move(sub_meshes), CityObjectList());
+    ASSERT_TRUE(mesh.getCityObjectRanges().empty());
+
+    mesh.buildCityObjectRanges();
+
+    // CityObjectIndex の順に並び、同じ地物でも SubMesh の境界で範囲を分けます。
+    const auto& ranges = mesh.getCityObjectRanges();
+    ASSERT_EQ(4, ranges.size());
+    ASSERT_EQ(CityObjectIndex(0, -1), ranges.at(0).city_object_index);
+    ASSERT_EQ(0, ranges.at(0).index_start);
+    ASSERT_EQ(6, ranges.at(0).index_count);
+    ASSERT_EQ(CityObjectIndex(0, 0), ranges.at(1).city_object_index);
+    ASSERT_EQ(12, ranges.at(1).index_start);
+    ASSERT_EQ(3, ranges.at(1).index_count);
+    ASSERT_EQ(CityObjectIndex(1, -1), ranges.at(2).city_object_index);
+    ASSERT_EQ(6, ranges.at(2).index_start);
+    ASSERT_EQ(3, ranges.at(2).index_count);
+    ASSERT_EQ(CityObjectIndex(1, -1), ranges.at(3).city_object_index);
+    ASSERT_EQ(9, ranges.at(3).index_start);
+    ASSERT_EQ(3, ranges.at(3).index_count);
+
+    ASSERT_DOUBLE_EQ(0, ranges.at(0).bounds_min.x);
+    ASSERT_DOUBLE_EQ(1, ranges.at(0).bounds_max.x);
+    ASSERT_DOUBLE_EQ(0, ranges.at(0).bounds_min.y);
+    ASSERT_DOUBLE_EQ(2, ranges.at(0).bounds_max.y);
+    ASSERT_DOUBLE_EQ(3, ranges.at(3).bounds_min.x);
+    ASSERT_DOUBLE_EQ(3, ranges.at(3).bounds_max.x);
+    ASSERT_DOUBLE_EQ(1, ranges.at(3).bounds_min.z);
+    ASSERT_DOUBLE_EQ(1, ranges.at(3).bounds_max.z);
+
+    // 地物ごと、主要地物ごとに表の中の位置を引けます。
+    ASSERT_EQ((std::pair<size_t, size_t>(2, 2)), mesh.findCityObjectRanges(CityObjectIndex(1, -1)));
+    ASSERT_EQ((std::pair<size_t, size_t>(0, 1)), mesh.findCityObjectRanges(CityObjectIndex(0, -1)));
+    ASSERT_EQ((std::pair<size_t, size_t>(0, 2)), mesh.findPrimaryCityObjectRanges(0));
+    ASSERT_EQ(0, mesh.findCityObjectRanges(CityObjectIndex(5, -1)).second);
+    ASSERT_EQ(0, mesh.findPrimaryCityObjectRanges(5).second);
+
+    // indices を変更すると表は破棄されます。
+    mesh.addIndicesList({0, 1, 2}, 0, false);
+    ASSERT_TRUE(mesh.getCityObjectRanges().empty());
+}
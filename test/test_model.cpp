@@ -1,6 +1,10 @@
 
 #include "gtest/gtest.h"
 #include "plateau/polygon_mesh/mesh_extractor.h"
+#include "plateau/polygon_mesh/model_reprojector.h"
+#include "plateau/polygon_mesh/model_batcher.h"
+#include "plateau/polygon_mesh/relief_rasterizer.h"
+#include <map>
 #include "citygml/citymodel.h"
 #include "citygml/citygml.h"
 
@@ -29,4 +33,344 @@ namespace plateau::polygonMesh {
         ASSERT_EQ(model->getRootNodeAt(1).getName(), "LOD1");
         ASSERT_EQ(model->getRootNodeAt(2).getName(), "LOD2");
     }
+
+    TEST_F(ModelTest, reproject_returns_same_vertices_as_extraction_with_new_reference) { // NOLINT
+        auto from_options = MeshExtractOptions();
+        from_options.mesh_granularity = MeshGranularity::PerPrimaryFeatureObject;
+        from_options.max_lod = 2;
+        auto to_options = from_options;
+        to_options.reference_point = TVec3d(-12345.5, 250.25, 30);
+        to_options.mesh_axes = geometry::CoordinateSystem::EUN;
+        to_options.unit_scale = 0.01f;
+
+        auto model = MeshExtractor::extract(*city_model_, from_options);
+        const auto expected = MeshExtractor::extract(*city_model_, to_options);
+        const auto toGeoReference = [](const MeshExtractOptions& options) {
+            return geometry::GeoReference(options.coordinate_zone_id, options.reference_point, options.unit_scale, options.mesh_axes);
+        };
+        ModelReprojector::reproject(*model, toGeoReference(from_options), toGeoReference(to_options), 4);
+
+        const auto actual_meshes = model->getAllMeshes();
+        const auto expected_meshes = expected->getAllMeshes();
+        ASSERT_EQ(actual_meshes.size(), expected_meshes.size());
+        ASSERT_FALSE(actual_meshes.empty());
+        for (size_t i = 0; i < actual_meshes.size(); i++) {
+            const auto& actual_vertices = actual_meshes.at(i)->getVertices();
+            const auto& expected_vertices = expected_meshes.at(i)->getVertices();
+            ASSERT_EQ(actual_vertices.size(), expected_vertices.size());
+            for (size_t j = 0; j < actual_vertices.size(); j++) {
+                ASSERT_NEAR(actual_vertices.at(j).x, expected_vertices.at(j).x, 1e-3);
+                ASSERT_NEAR(actual_vertices.at(j).y, expected_vertices.at(j).y, 1e-3);
+                ASSERT_NEAR(actual_vertices.at(j).z, expected_vertices.at(j).z, 1e-3);
+            }
+            // ENU から EUN への変換ではメッシュが裏返るため、抽出時と同じく頂点の順番が反転します。
+            ASSERT_EQ(actual_meshes.at(i)->getIndices(), expected_meshes.at(i)->getIndices());
+        }
+    }
+
+    namespace {
+        void assertSameHlodInfoRecursive(const Node& actual, const Node& expected) { // NOLINT(misc-no-recursion)
+            ASSERT_EQ(actual.getHlodInfo().has_value(), expected.getHlodInfo().has_value());
+            if (actual.getHlodInfo().has_value()) {
+                const auto& actual_info = actual.getHlodInfo().value();
+                const auto& expected_info = expected.getHlodInfo().value();
+                for (int axis = 0; axis < 3; axis++) {
+                    ASSERT_NEAR(actual_info.bounds_min[axis], expected_info.bounds_min[axis], 1e-3);
+                    ASSERT_NEAR(actual_info.bounds_max[axis], expected_info.bounds_max[axis], 1e-3);
+                }
+                ASSERT_NEAR(actual_info.switch_distance, expected_info.switch_distance, 1e-3);
+            }
+            ASSERT_EQ(actual.getChildCount(), expected.getChildCount());
+            for (unsigned i = 0; i < actual.getChildCount(); i++) {
+                assertSameHlodInfoRecursive(actual.getChildAt(i), expected.getChildAt(i));
+            }
+        }
+    }
+
+    TEST_F(ModelTest, reproject_transforms_hlod_bounds_and_switch_distance) { // NOLINT
+        auto from_options = MeshExtractOptions();
+        from_options.mesh_granularity = MeshGranularity::PerCityModelArea;
+        from_options.max_lod = 2;
+        from_options.grid_count_of_side = 4;
+        from_options.build_hlod = true;
+        auto to_options = from_options;
+        to_options.reference_point = TVec3d(-12345.5, 250.25, 30);
+        // ENU から ESU への変換では y の符号が反転するため、範囲の最小と最大が入れ替わります。
+        to_options.mesh_axes = geometry::CoordinateSystem::ESU;
+        to_options.unit_scale = 0.01f;
+
+        auto model = MeshExtractor::extract(*city_model_, from_options);
+        const auto expected = MeshExtractor::extract(*city_model_, to_options);
+        const auto toGeoReference = [](const MeshExtractOptions& options) {
+            return geometry::GeoReference(options.coordinate_zone_id, options.reference_point, options.unit_scale, options.mesh_axes);
+        };
+        ModelReprojector::reproject(*model, toGeoReference(from_options), toGeoReference(to_options), 4);
+
+        ASSERT_EQ(model->getRootNodeCount(), expected->getRootNodeCount());
+        ASSERT_GT(model->getRootNodeCount(), 0);
+        for (size_t i = 0; i < model->getRootNodeCount(); i++) {
+            assertSameHlodInfoRecursive(model->getRootNodeAt(i), expected->getRootNodeAt(i));
+        }
+    }
+
+    TEST_F(ModelTest, reproject_rebuilds_city_object_ranges_in_new_coordinates) { // NOLINT
+        auto from_options = MeshExtractOptions();
+        from_options.mesh_granularity = MeshGranularity::PerCityModelArea;
+        from_options.max_lod = 2;
+        from_options.build_city_object_ranges = true;
+        auto to_options = from_options;
+        to_options.reference_point = TVec3d(-12345.5, 250.25, 30);
+        // ENU から ESU への変換は鏡像であり、 y の符号が反転するため変換前の最小と最大が入れ替わります。
+        to_options.mesh_axes = geometry::CoordinateSystem::ESU;
+        to_options.unit_scale = 0.01f;
+
+        auto model = MeshExtractor::extract(*city_model_, from_options);
+        const auto expected = MeshExtractor::extract(*city_model_, to_options);
+        const auto toGeoReference = [](const MeshExtractOptions& options) {
+            return geometry::GeoReference(options.coordinate_zone_id, options.reference_point, options.unit_scale, options.mesh_axes);
+        };
+        ModelReprojector::reproject(*model, toGeoReference(from_options), toGeoReference(to_options), 4);
+
+        const auto actual_meshes = model->getAllMeshes();
+        const auto expected_meshes = expected->getAllMeshes();
+        ASSERT_EQ(actual_meshes.size(), expected_meshes.size());
+        ASSERT_FALSE(actual_meshes.empty());
+        for (size_t i = 0; i < actual_meshes.size(); i++) {
+            const auto& actual_ranges = actual_meshes.at(i)->getCityObjectRanges();
+            const auto& expected_ranges = expected_meshes.at(i)->getCityObjectRanges();
+            ASSERT_FALSE(actual_ranges.empty());
+            ASSERT_EQ(actual_ranges.size(), expected_ranges.size());
+            for (size_t j = 0; j < actual_ranges.size(); j++) {
+                const auto& actual = actual_ranges.at(j);
+                const auto& expected_range = expected_ranges.at(j);
+                ASSERT_EQ(actual.city_object_index, expected_range.city_object_index);
+                ASSERT_EQ(actual.index_start, expected_range.index_start);
+                ASSERT_EQ(actual.index_count, expected_range.index_count);
+                ASSERT_LE(actual.bounds_min.x, actual.bounds_max.x);
+                ASSERT_LE(actual.bounds_min.y, actual.bounds_max.y);
+                ASSERT_LE(actual.bounds_min.z, actual.bounds_max.z);
+                ASSERT_NEAR(actual.bounds_min.x, expected_range.bounds_min.x, 1e-3);
+                ASSERT_NEAR(actual.bounds_min.y, expected_range.bounds_min.y, 1e-3);
+                ASSERT_NEAR(actual.bounds_min.z, expected_range.bounds_min.z, 1e-3);
+                ASSERT_NEAR(actual.bounds_max.x, expected_range.bounds_max.x, 1e-3);
+                ASSERT_NEAR(actual.bounds_max.y, expected_range.bounds_max.y, 1e-3);
+                ASSERT_NEAR(actual.bounds_max.z, expected_range.bounds_max.z, 1e-3);
+            }
+        }
+    }
+
+    TEST_F(ModelTest, batch_merges_meshes_by_material_and_keeps_city_objects) { // NOLINT
+        auto options = MeshExtractOptions();
+        options.mesh_granularity = MeshGranularity::PerPrimaryFeatureObject;
+        options.min_lod = 2;
+        options.max_lod = 2;
+        const auto model = MeshExtractor::extract(*city_model_, options);
+
+        // 元のモデルでの、地物ごとの三角形の頂点数を数えます。
+        const auto countByGmlId = [](const std::vector<Mesh*>& meshes) {
+            std::map<std::string, size_t> counts;
+            for (const auto mesh : meshes) {
+                const auto& uv4 = mesh->getUV4();
+                for (const auto index : mesh->getIndices()) {
+                    const auto city_object_index = CityObjectIndex::fromUV(uv4.at(index));
+                    counts[mesh->getCityObjectList().getAtomicGmlID(city_object_index)]++;
+                }
+            }
+            return counts;
+        };
+        const auto src_meshes = model->getAllMeshes();
+
+        constexpr unsigned max_vertex_count = 1000;
+        const auto batched = ModelBatcher::batch(*model, max_vertex_count);
+        const auto batched_meshes = batched.getAllMeshes();
+
+        ASSERT_EQ(1, batched.getRootNodeCount());
+        ASSERT_EQ("LOD2", batched.getRootNodeAt(0).getName());
+        ASSERT_FALSE(batched_meshes.empty());
+        ASSERT_LT(batched_meshes.size(), src_meshes.size());
+        for (const auto mesh : batched_meshes) {
+            ASSERT_EQ(1, mesh->getSubMeshes().size());
+            ASSERT_LE(mesh->getVertices().size(), max_vertex_count);
+            ASSERT_EQ(mesh->getVertices().size(), mesh->getUV4().size());
+        }
+        // 地物ごとの三角形がすべて残り、 UV4 から gml:id を引けることを確認します。
+        ASSERT_EQ(countByGmlId(src_meshes), countByGmlId(batched_meshes));
+    }
+
+    TEST_F(ModelTest, mesh_instances_refer_to_shared_prototypes) { // NOLINT
+        auto model = Model();
+        auto prototype = std::make_unique<Mesh>();
+        prototype->addVerticesList({TVec3d(0, 0, 0), TVec3d(1, 0, 0), TVec3d(0, 1, 0)});
+        const auto prototype_index = model.addInstancePrototype(std::move(prototype));
+
+        // x 方向に 2倍、さらに (10, 20, 30) だけ平行移動する配置です。
+        MeshInstance instance{};
+        instance.prototype_index = prototype_index;
+        instance.transform = {2, 0, 0, 10,
+                              0, 1, 0, 20,
+                              0, 0, 1, 30,
+                              0, 0, 0, 1};
+        instance.gml_id = "tree_1";
+        instance.lod = 1;
+        model.addMeshInstance(MeshInstance(instance));
+        model.addMeshInstance(MeshInstance(instance));
+
+        ASSERT_EQ(1, model.getInstancePrototypeCount());
+        ASSERT_EQ(2, model.getMeshInstances().size());
+        const auto& placed = model.getMeshInstances().at(1);
+        const auto vertex = placed.apply(model.getInstancePrototypeAt(placed.prototype_index).getVertices().at(1));
+        ASSERT_DOUBLE_EQ(12, vertex.x);
+        ASSERT_DOUBLE_EQ(20, vertex.y);
+        ASSERT_DOUBLE_EQ(30, vertex.z);
+
+        instance.prototype_index = 1;
+        ASSERT_THROW(model.addMeshInstance(std::move(instance)), std::out_of_range);
+    }
+
+    TEST_F(ModelTest, reproject_transforms_prototypes_and_mesh_instances) { // NOLINT
+        const auto from = geometry::GeoReference(9, TVec3d(0, 0, 0), 1.0, geometry::CoordinateSystem::ENU);
+        const auto to = geometry::GeoReference(9, TVec3d(-12345.5, 250.25, 30), 0.01, geometry::CoordinateSystem::EUN);
+        auto model = Model();
+        auto prototype = std::make_unique<Mesh>();
+        prototype->addVerticesList({TVec3d(0, 0, 0), TVec3d(1, 0, 0), TVec3d(0, 1, 2)});
+        prototype->addIndicesList({0, 1, 2}, 0, false);
+        model.addInstancePrototype(std::move(prototype));
+
+        // z 軸まわりに 90度回転してから y 方向に 2倍し、 (10, 20, 30) に置く配置です。
+        MeshInstance instance{};
+        instance.prototype_index = 0;
+        instance.transform = {0, -1, 0, 10,
+                              2, 0, 0, 20,
+                              0, 0, 1, 30,
+                              0, 0, 0, 1};
+        instance.gml_id = "tree_1";
+        instance.lod = 1;
+        model.addMeshInstance(MeshInstance(instance));
+
+        // 配置後の頂点を to の座標に変換したものが期待値です。
+        std::vector<TVec3d> expected;
+        for (const auto& vertex : model.getInstancePrototypeAt(0).getVertices()) {
+            expected.push_back(to.project(from.unproject(instance.apply(vertex))));
+        }
+
+        ModelReprojector::reproject(model, from, to, 1);
+
+        const auto& reprojected = model.getMeshInstances().at(0);
+        const auto& prototype_vertices = model.getInstancePrototypeAt(0).getVertices();
+        ASSERT_EQ(expected.size(), prototype_vertices.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            const auto actual = reprojected.apply(prototype_vertices.at(i));
+            ASSERT_NEAR(expected.at(i).x, actual.x, 1e-3);
+            ASSERT_NEAR(expected.at(i).y, actual.y, 1e-3);
+            ASSERT_NEAR(expected.at(i).z, actual.z, 1e-3);
+        }
+        // プロトタイプは単位と座標軸だけが変わり、 ENU から EUN への変換で裏返ります。
+        ASSERT_NEAR(100, prototype_vertices.at(1).x, 1e-4);
+        ASSERT_EQ((std::vector<unsigned>{2, 1, 0}), model.getInstancePrototypeAt(0).getIndices());
+    }
+
+    TEST_F(ModelTest, batch_keeps_prototypes_and_mesh_instances) { // NOLINT
+        auto options = MeshExtractOptions();
+        options.mesh_granularity = MeshGranularity::PerPrimaryFeatureObject;
+        options.min_lod = 2;
+        options.max_lod = 2;
+        auto model = MeshExtractor::extract(*city_model_, options);
+        auto prototype = std::make_unique<Mesh>();
+        prototype->addVerticesList({TVec3d(0, 0, 0), TVec3d(1, 0, 0), TVec3d(0, 1, 0)});
+        prototype->addIndicesList({0, 1, 2}, 0, false);
+        const auto prototype_index = model->addInstancePrototype(std::move(prototype));
+        MeshInstance instance{};
+        instance.prototype_index = prototype_index;
+        instance.transform = {1, 0, 0, 10,
+                              0, 1, 0, 20,
+                              0, 0, 1, 30,
+                              0, 0, 0, 1};
+        instance.gml_id = "tree_1";
+        instance.lod = 2;
+        model->addMeshInstance(MeshInstance(instance));
+        model->addMeshInstance(MeshInstance(instance));
+
+        const auto batched = ModelBatcher::batch(*model);
+
+        ASSERT_EQ(1, batched.getInstancePrototypeCount());
+        ASSERT_EQ(model->getInstancePrototypeAt(0).getVertices(), batched.getInstancePrototypeAt(0).getVertices());
+        ASSERT_EQ(model->getInstancePrototypeAt(0).getIndices(), batched.getInstancePrototypeAt(0).getIndices());
+        ASSERT_EQ(2, batched.getMeshInstances().size());
+        for (const auto& batched_instance : batched.getMeshInstances()) {
+            ASSERT_EQ(prototype_index, batched_instance.prototype_index);
+            ASSERT_EQ(instance.transform, batched_instance.transform);
+            ASSERT_EQ("tree_1", batched_instance.gml_id);
+            ASSERT_EQ(2, batched_instance.lod);
+        }
+    }
+
+    TEST_F(ModelTest, relief_rasterizer_samples_tin_on_regular_grid) { // NOLINT
+        const auto geo_reference = geometry::GeoReference(9, TVec3d(0, 0, 0), 1.0, geometry::CoordinateSystem::EUN);
+        // 東に向かって 0.5 の勾配で上がる 10m 四方の地形を、 EUN の座標で作ります。
+        const auto toEUN = [](double east, double north) {
+            return geometry::GeoReference::convertAxisFromENUTo(geometry::CoordinateSystem::EUN, TVec3d(east, north, 0.5 * east));
+        };
+        auto mesh = std::make_unique<Mesh>();
+        mesh->addVerticesList({toEUN(0.2, 0.2), toEUN(10.2, 0.2), toEUN(10.2, 10.2), toEUN(0.2, 10.2)});
+        mesh->addIndicesList({0, 1, 2, 0, 2, 3}, 0, false);
+        auto relief = Node("LOD1");
+        relief.addChildNode(Node("dem", std::move(mesh)));
+
+        const auto height_map = ReliefRasterizer::rasterize(relief, geo_reference, 1.0);
+        // 標本点は基準点から 1m の整数倍の位置に置かれます。
+        ASSERT_EQ(10, height_map.column_count);
+        ASSERT_EQ(10, height_map.row_count);
+        ASSERT_DOUBLE_EQ(1.0, height_map.origin_east);
+        ASSERT_DOUBLE_EQ(1.0, height_map.origin_north);
+        for (size_t row = 0; row < height_map.row_count; row++) {
+            for (size_t column = 0; column < height_map.column_count; column++) {
+                ASSERT_TRUE(height_map.hasHeight(column, row));
+                ASSERT_NEAR(0.5 * (1.0 + column), height_map.getHeight(column, row), 1e-5);
+            }
+        }
+
+        const auto grid_mesh = ReliefRasterizer::createGridMesh(height_map, geo_reference);
+        ASSERT_EQ(100, grid_mesh->getVertices().size());
+        ASSERT_EQ(9 * 9 * 2 * 3, grid_mesh->getIndices().size());
+        // 列 c・行 r の頂点の番号は r * column_count + c です。
+        const auto& vertex = grid_mesh->getVertices().at(3 * 10 + 2);
+        ASSERT_NEAR(3.0, vertex.x, 1e-9);
+        ASSERT_NEAR(1.5, vertex.y, 1e-5);
+        ASSERT_NEAR(4.0, vertex.z, 1e-9);
+
+        ASSERT_THROW(ReliefRasterizer::rasterize(relief, geo_reference, 0), std::invalid_argument);
+    }
+
+    TEST_F(ModelTest, relief_chunks_share_borders_and_have_skirts) { // NOLINT
+        const auto geo_reference = geometry::GeoReference(9, TVec3d(0, 0, 0), 1.0, geometry::CoordinateSystem::ENU);
+        auto mesh = std::make_unique<Mesh>();
+        mesh->addVerticesList({TVec3d(0.2, 0.2, 0), TVec3d(10.2, 0.2, 5), TVec3d(10.2, 10.2, 5), TVec3d(0.2, 10.2, 0)});
+        mesh->addIndicesList({0, 1, 2, 0, 2, 3}, 0, false);
+        auto relief = Node("LOD1");
+        relief.addChildNode(Node("dem", std::move(mesh)));
+        const auto height_map = ReliefRasterizer::rasterize(relief, geo_reference, 1.0);
+
+        // 標本点は 1m から 10m までの 10個で、チャンクの境界は 0m, 4m, 8m にあります。
+        constexpr double skirt_height = 3.0;
+        const auto chunks = ReliefRasterizer::createChunkMeshes(height_map, geo_reference, 4.0, skirt_height);
+        ASSERT_EQ(9, chunks.size());
+        const auto& first = chunks.at(0);
+        ASSERT_EQ(0, first.chunk_x);
+        ASSERT_EQ(0, first.chunk_y);
+        // 1m から 4m までの 4×4 個の標本点と、外周の4辺それぞれに沿ったスカートの頂点です。
+        ASSERT_EQ(4 * 4 + 4 * 4, first.mesh->getVertices().size());
+        ASSERT_EQ((3 * 3 * 2 + 4 * 3 * 2) * 3, first.mesh->getIndices().size());
+
+        // 隣のチャンクとは境界の標本点を共有し、スカートは真上の頂点から skirt_height だけ下がります。
+        const auto& east = chunks.at(1);
+        ASSERT_EQ(1, east.chunk_x);
+        ASSERT_EQ(0, east.chunk_y);
+        const auto& first_border = first.mesh->getVertices().at(3);
+        const auto& east_border = east.mesh->getVertices().at(0);
+        ASSERT_NEAR(first_border.x, east_border.x, 1e-9);
+        ASSERT_NEAR(first_border.z, east_border.z, 1e-5);
+        const auto& skirt = first.mesh->getVertices().at(4 * 4);
+        const auto& above_skirt = first.mesh->getVertices().at(0);
+        ASSERT_NEAR(above_skirt.z - skirt_height, skirt.z, 1e-5);
+    }
 }
@@ -14,7 +14,8 @@ namespace PLATEAU.Interop
         ErrorIndexOutOfBounds,
         ErrorFileSystem,
         ErrorInvalidArgument,
-        ErrorValueIsInvalid
+        ErrorValueIsInvalid,
+        ErrorCancelled
     }
     
     /// <summary>
@@ -214,6 +215,10 @@ namespace PLATEAU.Interop
             {
                 throw new IndexOutOfRangeException("Index is out of range.");
             }
+            if (result == APIResult.ErrorCancelled)
+            {
+                throw new OperationCanceledException("Operation is cancelled.");
+            }
             if (result != APIResult.Success)
             {
                 throw new Exception($"Error in Lib Plateau DLL. APIResult = {result}");
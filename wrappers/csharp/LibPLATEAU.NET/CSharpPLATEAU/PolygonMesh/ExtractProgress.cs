@@ -0,0 +1,98 @@
+﻿using System;
+using System.Runtime.InteropServices;
+using PLATEAU.Interop;
+using PLATEAU.Native;
+
+namespace PLATEAU.PolygonMesh
+{
+    /// <summary>
+    /// メッシュ抽出の処理段階です。
+    /// </summary>
+    public enum ExtractStage
+    {
+        /// <summary> 地物からメッシュを生成する段階です。 </summary>
+        Geometry = 0,
+        /// <summary> テクスチャを結合する段階です。 </summary>
+        TexturePacking = 1,
+        /// <summary> 地形に地図タイルを貼り付ける段階です。 </summary>
+        MapAttach = 2
+    }
+
+    /// <summary>
+    /// メッシュ抽出の進捗の通知先と、抽出を中断するためのフラグをまとめたものです。
+    /// <see cref="MeshExtractor.Extract(ref Model, PLATEAU.CityGML.CityModel, MeshExtractOptions, ExtractProgress)"/> などに渡して利用します。
+    /// 進捗のコールバックは抽出処理のスレッドから呼ばれます。
+    /// </summary>
+    public class ExtractProgress : PInvokeDisposable
+    {
+        /// <summary>
+        /// LODの区別がない進捗であることを示す lod の値です。
+        /// </summary>
+        public const uint NoLod = uint.MaxValue;
+
+        /// <summary>
+        /// 処理段階 stage について、処理済みの数 processed と全体の数 total を受け取るコールバックの型です。
+        /// 段階ごとの lod と数の意味は次のとおりです。
+        /// <list type="bullet">
+        /// <item><description><see cref="ExtractStage.Geometry"/>: lod はそのLODであり、数は lod で処理する主要地物の数です。
+        /// ただし HLOD を作るときは lod は <see cref="NoLod"/> であり、数は HLOD の4分木のノードの数です。</description></item>
+        /// <item><description><see cref="ExtractStage.TexturePacking"/> と <see cref="ExtractStage.MapAttach"/>:
+        /// lod は <see cref="NoLod"/> であり、数は全LODを合わせたメッシュの数です。</description></item>
+        /// </list>
+        /// 複数のスレッドから通知されるため、同じ段階とLODについて processed の小さい通知が後から届くことがあります。
+        /// </summary>
+        public delegate void ProgressCallbackFuncType(ExtractStage stage, uint lod, ulong processed, ulong total);
+
+        /// <summary> ネイティブ側から呼ばれる間に delegate が回収されないよう保持します。 </summary>
+        private readonly ProgressCallbackFuncType callback;
+
+        private ExtractProgress(IntPtr handle, ProgressCallbackFuncType callback) : base(handle)
+        {
+            this.callback = callback;
+        }
+
+        /// <summary>
+        /// 進捗を <paramref name="onProgress"/> に通知する <see cref="ExtractProgress"/> を生成します。
+        /// <paramref name="onProgress"/> が null のときは通知せず、中断のみに利用します。
+        /// </summary>
+        public static ExtractProgress Create(ProgressCallbackFuncType onProgress)
+        {
+            var callbackPtr = onProgress == null ? IntPtr.Zero : Marshal.GetFunctionPointerForDelegate(onProgress);
+            var result = NativeMethods.plateau_create_extract_progress(out var handle, callbackPtr);
+            DLLUtil.CheckDllError(result);
+            return new ExtractProgress(handle, onProgress);
+        }
+
+        /// <summary>
+        /// 抽出の中断を要求します。抽出中に別スレッドから呼ぶことができます。
+        /// 中断された抽出は <see cref="OperationCanceledException"/> を投げます。
+        /// </summary>
+        public void Cancel()
+        {
+            ThrowIfDisposed();
+            var result = NativeMethods.plateau_extract_progress_cancel(Handle);
+            DLLUtil.CheckDllError(result);
+        }
+
+        protected override void DisposeNative()
+        {
+            NativeMethods.plateau_delete_extract_progress(Handle);
+        }
+
+        private static class NativeMethods
+        {
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_create_extract_progress(
+                out IntPtr outProgressPtr,
+                [In] IntPtr callbackPtr);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_delete_extract_progress(
+                [In] IntPtr progressPtr);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_extract_progress_cancel(
+                [In] IntPtr progressPtr);
+        }
+    }
+}
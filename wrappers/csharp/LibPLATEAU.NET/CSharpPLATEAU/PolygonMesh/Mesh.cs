@@ -8,6 +8,22 @@ using PLATEAU.Util;
 
 namespace PLATEAU.PolygonMesh
 {
+    /// <summary>
+    /// メッシュの Indices のうち、1つの <see cref="CityObjectIndex"/> の三角形が連続して並ぶ範囲と、その範囲の AABB です。
+    /// 詳しくは <see cref="Mesh.BuildCityObjectRanges"/> をご覧ください。
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct CityObjectRange
+    {
+        public CityObjectIndex CityObjectIndex;
+        /// <summary> 範囲の先頭の、 Indices での位置です。 </summary>
+        public uint IndexStart;
+        /// <summary> 範囲に含まれる Indices の数です。3の倍数になります。 </summary>
+        public uint IndexCount;
+        public PlateauVector3d BoundsMin;
+        public PlateauVector3d BoundsMax;
+    }
+
     /// <summary>
     /// メッシュ情報です。
     /// Unity や Unreal Engine でメッシュを生成するために必要な情報が含まれるよう意図されています。
@@ -180,6 +196,75 @@ namespace PLATEAU.PolygonMesh
             DLLUtil.CheckDllError(result);
         }
 
+        /// <summary>
+        /// 同じマテリアルの三角形が連続するよう三角形を並べ替え、 SubMesh をマテリアルごとに1つにまとめます。
+        /// 頂点は並べ替えないため、 UV4 の CityObjectIndex はそのまま保たれます。
+        /// </summary>
+        public void CoalesceSubMeshes()
+        {
+            ThrowIfInvalid();
+            var result = NativeMethods.plateau_mesh_coalesce_sub_meshes(Handle);
+            DLLUtil.CheckDllError(result);
+        }
+
+        /// <summary>
+        /// UV4 の <see cref="CityObjectIndex"/> をもとに、地物ごとの三角形の範囲と AABB の表を作ります。
+        /// 範囲は SubMesh の境界で分かれるため、1つの地物が複数の範囲を持つことがあります。
+        /// Indices を並べ替える操作 (<see cref="CoalesceSubMeshes"/>, <see cref="MergeMesh"/>) を行うと表は破棄されます。
+        /// </summary>
+        public void BuildCityObjectRanges()
+        {
+            ThrowIfInvalid();
+            var result = NativeMethods.plateau_mesh_build_city_object_ranges(Handle);
+            DLLUtil.CheckDllError(result);
+        }
+
+        public int CityObjectRangeCount
+        {
+            get
+            {
+                ThrowIfInvalid();
+                return DLLUtil.GetNativeValue<int>(Handle,
+                    NativeMethods.plateau_mesh_get_city_object_range_count);
+            }
+        }
+
+        /// <summary>
+        /// 地物ごとの三角形の範囲の表を返します。
+        /// <see cref="BuildCityObjectRanges"/> を呼んでいないか、表が破棄された後は空です。
+        /// </summary>
+        public CityObjectRange[] GetCityObjectRanges()
+        {
+            ThrowIfInvalid();
+            var ranges = new CityObjectRange[CityObjectRangeCount];
+            var result = NativeMethods.plateau_mesh_get_city_object_ranges(Handle, ranges);
+            DLLUtil.CheckDllError(result);
+            return ranges;
+        }
+
+        /// <summary>
+        /// <see cref="GetCityObjectRanges"/> の表は <see cref="CityObjectIndex"/> の順に並んでいます。
+        /// そのうち <paramref name="cityObjectIndex"/> の範囲が並ぶ位置を返します。
+        /// 該当する範囲がなければ <paramref name="count"/> は 0 です。
+        /// </summary>
+        public void FindCityObjectRanges(CityObjectIndex cityObjectIndex, out int first, out int count)
+        {
+            ThrowIfInvalid();
+            var result = NativeMethods.plateau_mesh_find_city_object_ranges(Handle, cityObjectIndex, out first, out count);
+            DLLUtil.CheckDllError(result);
+        }
+
+        /// <summary>
+        /// <see cref="GetCityObjectRanges"/> の表のうち、主要地物 <paramref name="primaryIndex"/> とその最小地物の範囲が並ぶ位置を返します。
+        /// 該当する範囲がなければ <paramref name="count"/> は 0 です。
+        /// </summary>
+        public void FindPrimaryCityObjectRanges(int primaryIndex, out int first, out int count)
+        {
+            ThrowIfInvalid();
+            var result = NativeMethods.plateau_mesh_find_primary_city_object_ranges(Handle, primaryIndex, out first, out count);
+            DLLUtil.CheckDllError(result);
+        }
+
         /// <summary>
         /// 取扱注意:
         /// 通常は <see cref="Node"/> が廃棄されるときに C++側で <see cref="Mesh"/> も廃棄されるので、このメソッドを呼ぶ必要はありません。
@@ -272,6 +357,38 @@ namespace PLATEAU.PolygonMesh
                 out IntPtr plateauSubMeshPtr,
                 int index);
 
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_mesh_coalesce_sub_meshes(
+                [In] IntPtr meshPtr);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_mesh_build_city_object_ranges(
+                [In] IntPtr meshPtr);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_mesh_get_city_object_range_count(
+                [In] IntPtr meshPtr,
+                out int outCount);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_mesh_get_city_object_ranges(
+                [In] IntPtr meshPtr,
+                [Out] CityObjectRange[] outRanges);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_mesh_find_city_object_ranges(
+                [In] IntPtr meshPtr,
+                [In] CityObjectIndex cityObjectIndex,
+                out int outFirst,
+                out int outCount);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_mesh_find_primary_city_object_ranges(
+                [In] IntPtr meshPtr,
+                int primaryIndex,
+                out int outFirst,
+                out int outCount);
+
             [DllImport(DLLUtil.DllName)]
             internal static extern APIResult plateau_mesh_get_vertex_color_count(
                 [In] IntPtr meshPtr,
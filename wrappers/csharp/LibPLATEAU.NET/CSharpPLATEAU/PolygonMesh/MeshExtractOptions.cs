@@ -1,5 +1,6 @@
 ﻿using System;
 using System.Runtime.InteropServices;
+using PLATEAU.CityGML;
 using PLATEAU.Geometries;
 using PLATEAU.Interop;
 using PLATEAU.Native;
@@ -43,6 +44,31 @@ namespace PLATEAU.PolygonMesh
             }
         }
     }
+
+    /// <summary>
+    /// 主要地物を属性で絞り込むときの比較方法です。
+    /// 属性値とフィルタ値の両方が数値として読める場合は数値として、そうでなければ文字列として比較します。
+    /// 属性を持たない地物は、比較方法によらず除外されます。
+    /// </summary>
+    public enum AttributeFilterComparison
+    {
+        /// <summary> 属性で絞り込みません。 </summary>
+        None = 0,
+        /// <summary> 属性が存在すれば値によらず残します。 </summary>
+        Exists = 1,
+        /// <summary> 属性値 == フィルタ値 であれば残します。 </summary>
+        Equal = 2,
+        /// <summary> 属性値 != フィルタ値 であれば残します。 </summary>
+        NotEqual = 3,
+        /// <summary> 属性値 &lt; フィルタ値 であれば残します。 </summary>
+        Less = 4,
+        /// <summary> 属性値 &lt;= フィルタ値 であれば残します。 </summary>
+        LessOrEqual = 5,
+        /// <summary> 属性値 &gt; フィルタ値 であれば残します。 </summary>
+        Greater = 6,
+        /// <summary> 属性値 &gt;= フィルタ値 であれば残します。 </summary>
+        GreaterOrEqual = 7
+    }
         
 
 
@@ -75,7 +101,23 @@ namespace PLATEAU.PolygonMesh
             this.AttachMapTile = attachMapTile;
             this.MapTileZoomLevel = mapTileZoomLevel;
             this.mapTileURL = mapTileURL;
+            this.ThreadCount = 1;
+            this.MaxTriangleCountInGrid = 0;
+            this.ClipPolygonsToExtent = false;
+            this.CityObjectTypeMask = CityObjectType.COT_All;
+            this.AttributeFilterComparison = AttributeFilterComparison.None;
+            this.attributeFilterKey = "";
+            this.attributeFilterValue = "";
 
+            this.CoalesceSubMeshesByMaterial = false;
+            this.ExtractImplicitGeometryAsInstances = false;
+            this.RasterizeRelief = false;
+            this.ReliefRasterCellSize = 5.0f;
+            this.ReliefChunkSize = 0;
+            this.ReliefSkirtHeight = 10.0f;
+            this.BuildHlod = false;
+            this.HlodSwitchDistanceFactor = 4.0f;
+            this.BuildCityObjectRanges = false;
             // 上で全てのメンバー変数を設定できてますが、バリデーションをするため念のためメソッドやプロパティも呼びます。
             SetLODRange(minLOD, maxLOD);
             UnitScale = unitScale;
@@ -209,6 +251,119 @@ namespace PLATEAU.PolygonMesh
             }
         }
 
+        /// <summary>
+        /// メッシュ抽出に利用するスレッド数です。
+        /// 1 のとき単一スレッドで処理し、 0 のときハードウェアの並列数を利用します。
+        /// </summary>
+        public uint ThreadCount;
+
+        /// <summary>
+        /// メッシュ結合の粒度が「都市モデル単位」の時のみ有効です。
+        /// 0 より大きいとき、グリッド内の三角形数がこの値を超える間、そのグリッドを4分割することを繰り返します。
+        /// 0 のとき、 <see cref="GridCountOfSide"/> による均等なグリッドのみで分割します。
+        /// </summary>
+        public uint MaxTriangleCountInGrid;
+
+        /// <summary>
+        /// 範囲の境界をまたぐ三角形を、境界で正確に切り取るかどうかです。
+        /// true にすると、隣り合う範囲で抽出した結果が境界で重複もすき間もなく接します。
+        /// </summary>
+        [MarshalAs(UnmanagedType.U1)] public bool ClipPolygonsToExtent;
+
+        /// <summary>
+        /// 抽出する主要地物の種類です。このマスクに含まれない種類の主要地物は、ジオメトリを読む前に除外されます。
+        /// </summary>
+        public CityObjectType CityObjectTypeMask;
+
+        /// <summary>
+        /// 主要地物を属性で絞り込むときの比較方法です。
+        /// <see cref="PolygonMesh.AttributeFilterComparison.None"/> のとき属性では絞り込みません。
+        /// </summary>
+        public AttributeFilterComparison AttributeFilterComparison;
+
+        /// <summary>
+        /// 主要地物を属性で絞り込むときの属性名です。
+        /// C#とC++でマーシャリングする関係上、charの固定長配列である必要があります。
+        /// 配列長を変更する場合、C++の mesh_extract_options.h にも変更を加える必要があります。
+        /// </summary>
+        [MarshalAs(UnmanagedType.ByValTStr, SizeConst = 256)]
+        private string attributeFilterKey;
+
+        public string AttributeFilterKey
+        {
+            get => this.attributeFilterKey;
+            set => this.attributeFilterKey = value ?? "";
+        }
+
+        /// <summary>
+        /// 主要地物を属性で絞り込むときに、属性値と比較する値です。
+        /// C#とC++でマーシャリングする関係上、charの固定長配列である必要があります。
+        /// </summary>
+        [MarshalAs(UnmanagedType.ByValTStr, SizeConst = 256)]
+        private string attributeFilterValue;
+
+        public string AttributeFilterValue
+        {
+            get => this.attributeFilterValue;
+            set => this.attributeFilterValue = value ?? "";
+        }
+
+        /// <summary>
+        /// 抽出後に、各メッシュの三角形をマテリアルごとに並べ替えて SubMesh を1つにまとめるかどうかです。
+        /// SubMesh の数、すなわち描画呼び出しの数を減らします。頂点と UV4 の CityObjectIndex は変わりません。
+        /// </summary>
+        [MarshalAs(UnmanagedType.U1)] public bool CoalesceSubMeshesByMaterial;
+
+        /// <summary>
+        /// 暗黙的ジオメトリ(街路樹や道路標識など、同じ形状を繰り返し配置するもの)を、インスタンス化できる形で出力するかどうかです。
+        /// true のとき、形状は <see cref="Model.GetInstancePrototypeAt"/> に、配置は <see cref="Model.GetMeshInstanceAt"/> に出力されます。
+        /// false のとき、暗黙的ジオメトリは出力しません。
+        /// </summary>
+        [MarshalAs(UnmanagedType.U1)] public bool ExtractImplicitGeometryAsInstances;
+
+        /// <summary>
+        /// 地形の TIN を、等間隔の格子による地形メッシュに変換して出力するかどうかです。
+        /// true のとき、各LODの地形は <see cref="ReliefRasterCellSize"/> 間隔の格子状のメッシュ1つに置き換わります。
+        /// 元の TIN のテクスチャは引き継ぎませんが、地図タイルは格子状のメッシュに貼り付けます。
+        /// </summary>
+        [MarshalAs(UnmanagedType.U1)] public bool RasterizeRelief;
+
+        /// <summary>
+        /// <see cref="RasterizeRelief"/> が true のときの、格子の間隔です。単位はメートルです。
+        /// </summary>
+        public float ReliefRasterCellSize;
+
+        /// <summary>
+        /// <see cref="RasterizeRelief"/> が true のとき、地形を何メートル四方のチャンクに分けるかです。 0 のときは分けません。
+        /// チャンクごとに "relief_chunk_{x}_{y}" という名前のノードになり、個別に読み込み・破棄できます。
+        /// </summary>
+        public float ReliefChunkSize;
+
+        /// <summary>
+        /// チャンクの外周に加える垂直な面(スカート)の高さです。単位はメートルで、 0 のときはスカートを付けません。
+        /// 隣り合うチャンクの解像度が異なるときに、継ぎ目に隙間が見えるのを防ぎます。
+        /// </summary>
+        public float ReliefSkirtHeight;
+
+        /// <summary>
+        /// メッシュ結合単位が地域単位のときのみ有効です。
+        /// true のとき、LODごとのノードの代わりに、グリッドを葉とする4分木のノード "HLOD" を出力します。
+        /// 葉は詳細なメッシュを、それ以外のノードは子孫のグリッドを LOD1 (なければ LOD0) の形状で結合した粗いメッシュを持ちます。
+        /// 各ノードの範囲と切り替えの距離は <see cref="Node.TryGetHlodInfo"/> で取得できます。
+        /// </summary>
+        [MarshalAs(UnmanagedType.U1)] public bool BuildHlod;
+
+        /// <summary>
+        /// <see cref="BuildHlod"/> が true のとき、各ノードの切り替えの距離を、ノードの範囲の外接球の半径の何倍にするかです。
+        /// </summary>
+        public float HlodSwitchDistanceFactor;
+
+        /// <summary>
+        /// 抽出の最後に、各メッシュについて地物ごとの三角形の範囲と AABB の表を作るかどうかです。
+        /// 表は <see cref="Mesh.GetCityObjectRanges"/> で取得できます。
+        /// </summary>
+        [MarshalAs(UnmanagedType.U1)] public bool BuildCityObjectRanges;
+
         /// <summary> デフォルト値の設定を返します。 </summary>
         internal static MeshExtractOptions DefaultValue()
         {
@@ -26,6 +26,18 @@ namespace PLATEAU.PolygonMesh
             DLLUtil.CheckDllError(result);
         }
 
+        /// <summary>
+        /// <see cref="Extract(ref Model, CityModel, MeshExtractOptions)"/> の進捗通知と中断に対応した版です。
+        /// <paramref name="progress"/> の <see cref="ExtractProgress.Cancel"/> で中断すると <see cref="OperationCanceledException"/> を投げます。
+        /// </summary>
+        public static void Extract(ref Model outModel, CityModel cityModel, MeshExtractOptions options, ExtractProgress progress)
+        {
+            var result = NativeMethods.plateau_mesh_extractor_extract_with_progress(
+                cityModel.Handle, options, progress.Handle, outModel.Handle
+            );
+            DLLUtil.CheckDllError(result);
+        }
+
 
         /// <summary>
         /// <see cref="CityModel"/> から範囲内の <see cref="Model"/> を抽出します。
@@ -46,6 +58,64 @@ namespace PLATEAU.PolygonMesh
             DLLUtil.CheckDllError(result);
         }
 
+        /// <summary>
+        /// <see cref="ExtractInExtents(ref Model, CityModel, MeshExtractOptions, List{Extent})"/> の進捗通知と中断に対応した版です。
+        /// <paramref name="progress"/> の <see cref="ExtractProgress.Cancel"/> で中断すると <see cref="OperationCanceledException"/> を投げます。
+        /// </summary>
+        public static void ExtractInExtents(ref Model outModel, CityModel cityModel, MeshExtractOptions options, List<Extent> extents, ExtractProgress progress)
+        {
+            var nativeExtents = NativeVectorExtent.Create();
+            foreach (var extent in extents)
+            {
+                nativeExtents.Add(extent);
+            }
+
+            var result = NativeMethods.plateau_mesh_extractor_extract_in_extents_with_progress(
+                cityModel.Handle, options, nativeExtents.Handle, progress.Handle, outModel.Handle
+            );
+            DLLUtil.CheckDllError(result);
+        }
+
+        /// <summary>
+        /// 抽出が終わったノードを受け取るコールバックの型です。
+        /// </summary>
+        public delegate void ExtractedNodeCallbackFuncType(uint lod, IntPtr nodePtr);
+
+        /// <summary>
+        /// <see cref="CityModel"/> から範囲内の <see cref="Model"/> を1つにまとめずに抽出し、
+        /// 構築が終わったノードから順に <paramref name="onNodeExtracted"/> に渡します。
+        /// 渡されるのは LODノードの子となるノードと、そのLODです。
+        /// 渡された <see cref="Node"/> はコールバックから戻ると破棄されるため、必要な情報はコールバックの中で読み取ってください。
+        /// </summary>
+        public static void ExtractInExtentsStreaming(CityModel cityModel, MeshExtractOptions options, List<Extent> extents, Action<uint, Node> onNodeExtracted)
+        {
+            ExtractInExtentsStreaming(cityModel, options, extents, onNodeExtracted, null);
+        }
+
+        /// <summary>
+        /// <see cref="ExtractInExtentsStreaming(CityModel, MeshExtractOptions, List{Extent}, Action{uint, Node})"/> の進捗通知と中断に対応した版です。
+        /// 通知されるのは <see cref="ExtractStage.Geometry"/> 段階の進捗のみです。
+        /// <paramref name="progress"/> は null でも構いません。
+        /// <see cref="ExtractProgress.Cancel"/> で中断すると <see cref="OperationCanceledException"/> を投げます。
+        /// </summary>
+        public static void ExtractInExtentsStreaming(CityModel cityModel, MeshExtractOptions options, List<Extent> extents, Action<uint, Node> onNodeExtracted, ExtractProgress progress)
+        {
+            var nativeExtents = NativeVectorExtent.Create();
+            foreach (var extent in extents)
+            {
+                nativeExtents.Add(extent);
+            }
+
+            ExtractedNodeCallbackFuncType callback = (lod, nodePtr) => onNodeExtracted(lod, new Node(nodePtr));
+            var result = NativeMethods.plateau_mesh_extractor_extract_in_extents_streaming(
+                cityModel.Handle, options, nativeExtents.Handle, Marshal.GetFunctionPointerForDelegate(callback),
+                progress == null ? IntPtr.Zero : progress.Handle
+            );
+            // ネイティブ側の処理が終わるまで delegate が回収されないようにします。
+            GC.KeepAlive(callback);
+            DLLUtil.CheckDllError(result);
+        }
+
         private static class NativeMethods
         {
             [DllImport(DLLUtil.DllName)]
@@ -54,12 +124,35 @@ namespace PLATEAU.PolygonMesh
                 MeshExtractOptions options,
                 [In] IntPtr outModelPtr);
 
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_mesh_extractor_extract_with_progress(
+                [In] IntPtr cityModelPtr,
+                MeshExtractOptions options,
+                [In] IntPtr progressPtr,
+                [In] IntPtr outModelPtr);
+
             [DllImport(DLLUtil.DllName)]
             internal static extern APIResult plateau_mesh_extractor_extract_in_extents(
                 [In] IntPtr cityModelPtr,
                 MeshExtractOptions options,
                 [In] IntPtr extentsPtr,
                 [In] IntPtr outModelPtr);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_mesh_extractor_extract_in_extents_with_progress(
+                [In] IntPtr cityModelPtr,
+                MeshExtractOptions options,
+                [In] IntPtr extentsPtr,
+                [In] IntPtr progressPtr,
+                [In] IntPtr outModelPtr);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_mesh_extractor_extract_in_extents_streaming(
+                [In] IntPtr cityModelPtr,
+                MeshExtractOptions options,
+                [In] IntPtr extentsPtr,
+                [In] IntPtr callbackPtr,
+                [In] IntPtr progressPtr);
         }
     }
 }
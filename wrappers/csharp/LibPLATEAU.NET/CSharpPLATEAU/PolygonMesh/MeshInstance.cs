@@ -0,0 +1,31 @@
+﻿namespace PLATEAU.PolygonMesh
+{
+    /// <summary>
+    /// 暗黙的ジオメトリの1つの配置です。
+    /// <see cref="Model.GetInstancePrototypeAt"/> で得られる形状を、 <see cref="Transform"/> の変換行列で配置します。
+    /// </summary>
+    public class MeshInstance
+    {
+        /// <summary> 配置する形状の、 <see cref="Model.GetInstancePrototypeAt"/> における番号です。 </summary>
+        public int PrototypeIndex { get; }
+
+        /// <summary>
+        /// 形状の頂点座標を配置後の座標に変換する 4×4 の変換行列です。
+        /// 行優先で16個の要素を格納し、頂点を列ベクトル (x, y, z, 1) として左から掛けます。
+        /// </summary>
+        public double[] Transform { get; }
+
+        /// <summary> この配置を持つ都市オブジェクトの gml:id です。 </summary>
+        public string GmlID { get; }
+
+        public int Lod { get; }
+
+        public MeshInstance(int prototypeIndex, double[] transform, string gmlID, int lod)
+        {
+            PrototypeIndex = prototypeIndex;
+            Transform = transform;
+            GmlID = gmlID;
+            Lod = lod;
+        }
+    }
+}
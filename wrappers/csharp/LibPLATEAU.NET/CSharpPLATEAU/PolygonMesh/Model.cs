@@ -1,5 +1,6 @@
 ﻿using System;
 using System.Runtime.InteropServices;
+using PLATEAU.Geometries;
 using PLATEAU.Interop;
 using PLATEAU.Native;
 using PLATEAU.Util;
@@ -68,6 +69,57 @@ namespace PLATEAU.PolygonMesh
             return new Node(nodePtr);
         }
 
+        /// <summary>
+        /// 暗黙的ジオメトリの配置で共有される形状(インスタンスプロトタイプ)の数です。
+        /// </summary>
+        public int InstancePrototypeCount
+        {
+            get
+            {
+                return DLLUtil.GetNativeValue<int>(Handle,
+                    NativeMethods.plateau_model_get_instance_prototype_count);
+            }
+        }
+
+        /// <summary>
+        /// <paramref name="index"/> 番目のインスタンスプロトタイプのメッシュを返します。
+        /// 頂点は配置の基準点を原点とするローカル座標です。
+        /// </summary>
+        public Mesh GetInstancePrototypeAt(int index)
+        {
+            var meshPtr = DLLUtil.GetNativeValue<IntPtr>(
+                Handle, index,
+                NativeMethods.plateau_model_get_instance_prototype_at_index);
+            return new Mesh(meshPtr);
+        }
+
+        /// <summary>
+        /// インスタンスプロトタイプの配置の数です。
+        /// </summary>
+        public int MeshInstanceCount
+        {
+            get
+            {
+                return DLLUtil.GetNativeValue<int>(Handle,
+                    NativeMethods.plateau_model_get_mesh_instance_count);
+            }
+        }
+
+        /// <summary>
+        /// <paramref name="index"/> 番目の配置を返します。
+        /// </summary>
+        public MeshInstance GetMeshInstanceAt(int index)
+        {
+            var transform = new double[16];
+            var result = NativeMethods.plateau_model_get_mesh_instance_at_index(
+                Handle, index, out int prototypeIndex, out int lod, transform);
+            DLLUtil.CheckDllError(result);
+            result = NativeMethods.plateau_model_get_mesh_instance_gml_id(
+                Handle, out var strPtr, out int strLength, index);
+            DLLUtil.CheckDllError(result);
+            return new MeshInstance(prototypeIndex, transform, DLLUtil.ReadUtf8Str(strPtr, strLength), lod);
+        }
+
         /// <summary>
         /// ルートにノードを加えます。
         /// 取扱注意:
@@ -82,6 +134,50 @@ namespace PLATEAU.PolygonMesh
             node.MarkInvalid();
         }
 
+        /// <summary>
+        /// 全メッシュの頂点を、 <paramref name="from"/> で抽出した座標から <paramref name="to"/> で抽出した場合の座標に変換します。
+        /// 抽出後に基準点、座標軸、単位だけを変更したい場合に、再抽出の代わりに利用できます。
+        /// <see cref="Node"/> の Transform は変更しません。
+        /// </summary>
+        public void Reproject(GeoReference from, GeoReference to, uint threadCount = 1)
+        {
+            var result = NativeMethods.plateau_model_reproject(
+                Handle, from.Handle, to.Handle, threadCount);
+            DLLUtil.CheckDllError(result);
+        }
+
+        /// <summary> <see cref="Batch"/> の頂点数の上限の既定値です。16ビットのインデックスで表せる頂点数です。 </summary>
+        public const uint DefaultBatchMaxVertexCount = 65535;
+
+        /// <summary>
+        /// ノードをまたいでメッシュをマテリアルごとに結合した <see cref="Model"/> を新しく作って返します。
+        /// 結合はルートノード(LOD)ごとに行い、1つのメッシュの頂点数が <paramref name="maxVertexCount"/> を超える場合は複数に分けます。
+        /// 0 のときは頂点数を制限しません。
+        /// 結合後のメッシュでも UV4 と CityObjectList により地物ごとの選択や非表示ができます。
+        /// </summary>
+        public Model Batch(uint maxVertexCount = DefaultBatchMaxVertexCount)
+        {
+            var result = NativeMethods.plateau_model_batch(
+                Handle, out IntPtr outModelPtr, maxVertexCount);
+            DLLUtil.CheckDllError(result);
+            return new Model(outModelPtr);
+        }
+
+        /// <summary>
+        /// 各ルートノード(LOD)の下の地形の TIN を、 <paramref name="cellSize"/> メートル間隔の格子状のメッシュに置き換えた
+        /// <see cref="Model"/> を新しく作って返します。 <paramref name="geoReference"/> は抽出時と同じものを渡します。
+        /// 格子状のメッシュの頂点は南の行から順に、行の中では西から順に並びます。
+        /// <paramref name="chunkSize"/> が正のときは、そのメートル四方のチャンクごとのメッシュに分け、
+        /// 外周に <paramref name="skirtHeight"/> メートルの垂直な面(スカート)を付けます。
+        /// </summary>
+        public Model RasterizeRelief(GeoReference geoReference, double cellSize, double chunkSize = 0, double skirtHeight = 0)
+        {
+            var result = NativeMethods.plateau_model_rasterize_relief(
+                Handle, geoReference.Handle, out IntPtr outModelPtr, cellSize, chunkSize, skirtHeight);
+            DLLUtil.CheckDllError(result);
+            return new Model(outModelPtr);
+        }
+
         protected override void DisposeNative()
         {
             NativeMethods.plateau_delete_model(Handle);
@@ -137,6 +233,59 @@ namespace PLATEAU.PolygonMesh
             internal static extern APIResult plateau_model_add_node_by_std_move(
                 [In] IntPtr modelPtr,
                 [In] IntPtr nodePtr);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_model_reproject(
+                [In] IntPtr modelPtr,
+                [In] IntPtr fromGeoReferencePtr,
+                [In] IntPtr toGeoReferencePtr,
+                uint threadCount);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_model_get_instance_prototype_count(
+                [In] IntPtr handle,
+                out int outCount);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_model_get_instance_prototype_at_index(
+                [In] IntPtr handle,
+                out IntPtr outMesh,
+                int index);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_model_get_mesh_instance_count(
+                [In] IntPtr handle,
+                out int outCount);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_model_get_mesh_instance_at_index(
+                [In] IntPtr handle,
+                int index,
+                out int outPrototypeIndex,
+                out int outLod,
+                [Out] double[] outTransform);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_model_get_mesh_instance_gml_id(
+                [In] IntPtr handle,
+                out IntPtr outStrPtr,
+                out int strLength,
+                int index);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_model_rasterize_relief(
+                [In] IntPtr srcModel,
+                [In] IntPtr geoReference,
+                out IntPtr outModel,
+                double cellSize,
+                double chunkSize,
+                double skirtHeight);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_model_batch(
+                [In] IntPtr srcModelPtr,
+                out IntPtr outModelPtr,
+                uint maxVertexCount);
         }
     }
 }
@@ -94,6 +94,24 @@ namespace PLATEAU.PolygonMesh
             }
         }
 
+        /// <summary>
+        /// HLOD の階層を構成するノードであれば、子孫も含めたメッシュを囲む範囲と、子ノードに切り替える距離を取得して true を返します。
+        /// カメラから範囲までの距離が <paramref name="switchDistance"/> より小さいときは、このノードのメッシュの代わりに子ノードを表示します。
+        /// HLOD の階層のノードでなければ false を返します。
+        /// </summary>
+        public bool TryGetHlodInfo(out PlateauVector3d boundsMin, out PlateauVector3d boundsMax, out double switchDistance)
+        {
+            ThrowIfInvalid();
+            var result = NativeMethods.plateau_node_get_hlod_info(
+                this.Handle, out boundsMin, out boundsMax, out switchDistance);
+            if (result == APIResult.ErrorValueNotFound)
+            {
+                return false;
+            }
+            DLLUtil.CheckDllError(result);
+            return true;
+        }
+
         public bool IsActive
         {
             get
@@ -320,6 +338,13 @@ namespace PLATEAU.PolygonMesh
             internal static extern APIResult plateau_node_get_mesh(
                 [In] IntPtr nodeHandle,
                 out IntPtr outMeshPtr);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_node_get_hlod_info(
+                [In] IntPtr nodeHandle,
+                out PlateauVector3d outBoundsMin,
+                out PlateauVector3d outBoundsMax,
+                out double outSwitchDistance);
         
             [DllImport(DLLUtil.DllName)]
             internal static extern APIResult plateau_node_set_mesh_by_std_move(
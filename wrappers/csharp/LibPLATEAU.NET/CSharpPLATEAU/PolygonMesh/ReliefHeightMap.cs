@@ -0,0 +1,113 @@
+﻿using System;
+using System.Runtime.InteropServices;
+using PLATEAU.Geometries;
+using PLATEAU.Interop;
+using PLATEAU.Native;
+
+namespace PLATEAU.PolygonMesh
+{
+    /// <summary>
+    /// 地形の TIN を平面上の等間隔の格子で標本化した高さの表(ハイトマップ)です。
+    /// 標本点は東方向に <see cref="ColumnCount"/> 個、北方向に <see cref="RowCount"/> 個並び、
+    /// 位置は基準点から <see cref="CellSize"/> の整数倍となるため、隣り合う地形の格子は継ぎ目で一致します。
+    /// </summary>
+    public class ReliefHeightMap : PInvokeDisposable
+    {
+        private ReliefHeightMap(IntPtr handle) : base(handle)
+        {
+        }
+
+        /// <summary>
+        /// <paramref name="node"/> 以下の地形を <paramref name="cellSize"/> メートル間隔の格子で標本化します。
+        /// <paramref name="geoReference"/> は抽出時と同じものを渡します。
+        /// </summary>
+        public static ReliefHeightMap Rasterize(Node node, GeoReference geoReference, double cellSize)
+        {
+            var result = NativeMethods.plateau_relief_rasterizer_rasterize(
+                node.Handle, geoReference.Handle, cellSize, out IntPtr outHeightMapPtr);
+            DLLUtil.CheckDllError(result);
+            return new ReliefHeightMap(outHeightMapPtr);
+        }
+
+        /// <summary> 東方向の標本点の数です。 </summary>
+        public int ColumnCount =>
+            DLLUtil.GetNativeValue<int>(Handle, NativeMethods.plateau_relief_height_map_get_column_count);
+
+        /// <summary> 北方向の標本点の数です。 </summary>
+        public int RowCount =>
+            DLLUtil.GetNativeValue<int>(Handle, NativeMethods.plateau_relief_height_map_get_row_count);
+
+        /// <summary> 南西の角の標本点の東方向の座標です。 </summary>
+        public double OriginEast =>
+            DLLUtil.GetNativeValue<double>(Handle, NativeMethods.plateau_relief_height_map_get_origin_east);
+
+        /// <summary> 南西の角の標本点の北方向の座標です。 </summary>
+        public double OriginNorth =>
+            DLLUtil.GetNativeValue<double>(Handle, NativeMethods.plateau_relief_height_map_get_origin_north);
+
+        /// <summary> 標本点の間隔です。単位はメッシュの頂点と同じです。 </summary>
+        public double CellSize =>
+            DLLUtil.GetNativeValue<double>(Handle, NativeMethods.plateau_relief_height_map_get_cell_size);
+
+        /// <summary>
+        /// 各標本点の高さを、南の行から順に、行の中では西から順に並べた配列を返します。
+        /// TIN の三角形に覆われていない標本点は NaN です。
+        /// </summary>
+        public float[] GetHeights()
+        {
+            var heights = new float[ColumnCount * RowCount];
+            var result = NativeMethods.plateau_relief_height_map_get_heights(Handle, heights);
+            DLLUtil.CheckDllError(result);
+            return heights;
+        }
+
+        protected override void DisposeNative()
+        {
+            NativeMethods.plateau_delete_relief_height_map(Handle);
+        }
+
+        private static class NativeMethods
+        {
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_relief_rasterizer_rasterize(
+                [In] IntPtr node,
+                [In] IntPtr geoReference,
+                double cellSize,
+                out IntPtr outHeightMap);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_delete_relief_height_map(
+                [In] IntPtr handle);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_relief_height_map_get_column_count(
+                [In] IntPtr handle,
+                out int outCount);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_relief_height_map_get_row_count(
+                [In] IntPtr handle,
+                out int outCount);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_relief_height_map_get_origin_east(
+                [In] IntPtr handle,
+                out double outValue);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_relief_height_map_get_origin_north(
+                [In] IntPtr handle,
+                out double outValue);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_relief_height_map_get_cell_size(
+                [In] IntPtr handle,
+                out double outValue);
+
+            [DllImport(DLLUtil.DllName)]
+            internal static extern APIResult plateau_relief_height_map_get_heights(
+                [In] IntPtr handle,
+                [Out] float[] outHeights);
+        }
+    }
+}